@@ -0,0 +1,51 @@
+#ifndef YUNDB_BENCHMARK_BENCH_UTIL_H
+#define YUNDB_BENCHMARK_BENCH_UTIL_H
+// Header guard standardized to YUNDB_BENCHMARK_BENCH_UTIL_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace bench
+{
+
+inline uint64_t nowNanos()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Collect per operation latency and report percentiles
+class Latency
+{
+ public:
+  void add(uint64_t nanos) { _samples.push_back(nanos); }
+
+  void clear() { _samples.clear(); }
+
+  size_t count() const { return _samples.size(); }
+
+  // p in [0, 100]
+  double percentile(double p)
+  {
+    if (_samples.empty()) return 0;
+    std::sort(_samples.begin(), _samples.end());
+    size_t index = static_cast<size_t>(p / 100.0 * (_samples.size() - 1));
+    return static_cast<double>(_samples[index]);
+  }
+
+  void report(const char* name)
+  {
+    std::printf("%-24s ops=%-9zu p50=%10.1f ns  p99=%10.1f ns\n",
+                name, count(), percentile(50), percentile(99));
+  }
+
+ private:
+  std::vector<uint64_t> _samples;
+};
+
+}
+
+#endif // YUNDB_BENCHMARK_BENCH_UTIL_H
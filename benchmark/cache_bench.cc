@@ -0,0 +1,69 @@
+// Multi-threaded Cache lookup throughput.
+//
+// Every thread looks up random keys and releases them, the way readers hit
+// the table cache. "shards=1" is a single lock for the whole cache.
+#include "util/cache.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "yundb/options.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void runLookups(yundb::Cache* cache, int keyNum, int ops, uint32_t seed)
+{
+  yundb::Random rand(seed);
+  char buf[sizeof(uint64_t)];
+  for (int i = 0; ops > i; i++)
+  {
+    yundb::EncodeFixed64(buf, rand.Uniform(keyNum));
+    yundb::Slice key(buf, sizeof(buf));
+    if (cache->lookup(key) != nullptr) {
+      cache->unRef(key);
+    }
+  }
+}
+
+static double measure(int shardBits, int threadNum)
+{
+  constexpr int KeyNum = 4096;
+  constexpr int OpsPerThread = 200000;
+
+  yundb::Cache cache(KeyNum, shardBits);
+  char buf[sizeof(uint64_t)];
+  for (int i = 0; KeyNum > i; i++)
+  {
+    yundb::EncodeFixed64(buf, i);
+    cache.insert(yundb::Slice(buf, sizeof(buf)), reinterpret_cast<void*>(i + 1), 1,
+                 nullptr);
+    cache.unRef(yundb::Slice(buf, sizeof(buf)));
+  }
+
+  std::vector<std::thread> threads;
+  uint64_t start = bench::nowNanos();
+  for (int t = 0; threadNum > t; t++) {
+    threads.emplace_back(runLookups, &cache, KeyNum, OpsPerThread, 1000 + t);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double seconds = static_cast<double>(bench::nowNanos() - start) / 1e9;
+  return static_cast<double>(OpsPerThread) * threadNum / seconds;
+}
+
+int main()
+{
+  yundb::Options options;
+
+  std::printf("%-8s %18s %18s\n", "threads", "shards=1 ops/s", "sharded ops/s");
+  for (int threads = 1; threads <= 64; threads *= 2)
+  {
+    double single = measure(0, threads);
+    double sharded = measure(options.cache_shard_bits, threads);
+    std::printf("%-8d %18.0f %18.0f\n", threads, single, sharded);
+  }
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Point read latency while flushes and compactions write new tables.
+//
+// A hot key set is loaded, compacted and read once so its table pages are
+// in the page cache. A background thread then writes a large amount of
+// other data. Buffered table writes fill the page cache and push the hot
+// pages out, so reads go to disk again. With direct I/O for flush and
+// compaction outputs the new tables bypass the page cache.
+#include "yundb/db.h"
+#include "yundb/comparator.h"
+#include "yundb/options.h"
+#include "bench_util.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+static constexpr int HotKeys = 100000;
+static constexpr int ColdWrites = 400000;
+
+static std::string hotKey(int i) { return "hot" + std::to_string(1000000 + i); }
+
+static void runWrites(yundb::DB* db, std::atomic<bool>* done)
+{
+  yundb::WriteOptions writeOptions;
+  std::string value(1000, 'c');
+  for (int i = 0; ColdWrites > i; i++)
+  {
+    db->Put(writeOptions, "cold" + std::to_string(i * 7919 % ColdWrites), value);
+  }
+  done->store(true, std::memory_order_release);
+}
+
+static void measure(bool directIo)
+{
+  std::string dbName = std::string(BENCH_TEMP_DIR) + "/direct_io_bench";
+
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  options.create_if_missing = true;
+  options.write_buffer_size = 1024 * 1024;
+  options.use_direct_io_for_flush_and_compaction = directIo;
+  yundb::DestroyDB(dbName, options);
+
+  yundb::DB* dbptr = nullptr;
+  if (!yundb::DB::Open(options, dbName, &dbptr)) return;
+  std::unique_ptr<yundb::DB> db(dbptr);
+
+  yundb::WriteOptions writeOptions;
+  std::string value(200, 'h');
+  for (int i = 0; HotKeys > i; i++) {
+    db->Put(writeOptions, hotKey(i), value);
+  }
+  db->CompactRange(nullptr, nullptr);
+
+  yundb::ReadOptions readOptions;
+  std::string result;
+  for (int i = 0; HotKeys > i; i++) {
+    db->Get(readOptions, hotKey(i), &result);
+  }
+
+  std::atomic<bool> done(false);
+  std::thread writer(runWrites, db.get(), &done);
+  std::mt19937 rand(301);
+  bench::Latency latency;
+  while (!done.load(std::memory_order_acquire))
+  {
+    std::string key = hotKey(static_cast<int>(rand() % HotKeys));
+    uint64_t start = bench::nowNanos();
+    db->Get(readOptions, key, &result);
+    latency.add(bench::nowNanos() - start);
+  }
+  writer.join();
+  latency.report(directIo ? "get, direct io writes" : "get, buffered writes");
+
+  db.reset();
+  yundb::DestroyDB(dbName, options);
+}
+
+int main()
+{
+  measure(false);
+  measure(true);
+  return 0;
+}
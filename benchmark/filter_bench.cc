@@ -0,0 +1,63 @@
+// False positive rate and probe cost of the filter policies.
+//
+// Builds one filter per policy over a large key set, so the filter does
+// not fit in cache, then reports the false positive rate of absent keys
+// and the ns per probe of keyMayMatch and of batched keysMayMatch.
+#include "yundb/filter_policy.h"
+#include "util/coding.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+static constexpr int KeyNum = 4 * 1000 * 1000;
+static constexpr int ProbeNum = 4 * 1000 * 1000;
+
+static void run(const yundb::FilterPolicy* policy)
+{
+  std::vector<std::string> buffers(KeyNum);
+  std::vector<yundb::Slice> keys;
+  for (int i = 0; KeyNum > i; i++)
+  {
+    yundb::PutFixed32(&buffers[i], static_cast<uint32_t>(i) * 0x9e3779b9u);
+    keys.push_back(buffers[i]);
+  }
+  std::string filter;
+  policy->createFilter(keys.data(), KeyNum, &filter);
+
+  // Absent keys, so every positive is a false positive
+  std::vector<std::string> probeBuffers(ProbeNum);
+  std::vector<yundb::Slice> probes;
+  for (int i = 0; ProbeNum > i; i++)
+  {
+    yundb::PutFixed32(&probeBuffers[i], static_cast<uint32_t>(i) * 0x9e3779b9u + 1);
+    yundb::PutFixed32(&probeBuffers[i], 0);
+    probes.push_back(probeBuffers[i]);
+  }
+
+  int positives = 0;
+  uint64_t start = bench::nowNanos();
+  for (const auto& probe : probes) {
+    if (policy->keyMayMatch(probe, filter)) positives++;
+  }
+  double single = static_cast<double>(bench::nowNanos() - start) / ProbeNum;
+
+  std::unique_ptr<bool[]> results(new bool[ProbeNum]);
+  start = bench::nowNanos();
+  policy->keysMayMatch(probes.data(), ProbeNum, filter, results.get());
+  double batched = static_cast<double>(bench::nowNanos() - start) / ProbeNum;
+
+  std::printf("%-22s %9.3f%% %12.1f %12.1f %10zu\n", policy->Name(),
+              100.0 * positives / ProbeNum, single, batched, filter.size());
+}
+
+int main()
+{
+  std::printf("%-22s %10s %12s %12s %10s\n",
+              "policy", "fp rate", "ns/probe", "batched ns", "bytes");
+  run(yundb::bloomPolicyFilter());
+  run(yundb::blockedBloomPolicyFilter());
+  return 0;
+}
@@ -0,0 +1,102 @@
+// IndexBlockIterator::seek cost over index blocks of 16 to 64K entries.
+//
+// "linear" decodes index entries from the start of the block until the
+// first key greater than target, which is what seek used to do.
+// "binary" is IndexBlockIterator::seek over the restart array.
+#include "db/block_builder.h"
+#include "db/block_reader.h"
+#include "db/table_format.h"
+#include "db/dbformat.h"
+#include "util/coding.h"
+#include "util/random.h"
+#include "yundb/comparator.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static std::string internalKey(int i)
+{
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "key%010d", i);
+  std::string key(buf);
+  yundb::PutFixed64(&key, yundb::packSeqAndType(1, yundb::TypeValue));
+  return key;
+}
+
+// Return index of the last entry whose user key is not greater than target
+static int linearSeek(const std::string& block, const yundb::Slice& target,
+                      const yundb::Comparator* cmp)
+{
+  const char* start = block.data();
+  const char* end = start + block.size();
+  const uint32_t restartNum = yundb::DecodeFixed32(end - 4);
+  const char* limit = end - (restartNum + 1) * sizeof(uint32_t);
+  const yundb::Slice userTarget(target.data(), target.size() - yundb::KeyTagSize);
+
+  int index = -1;
+  const char* entry = start;
+  while (entry < limit)
+  {
+    const char* key = nullptr, *value = nullptr, *next = nullptr;
+    uint64_t keyLen = 0, valueLen = 0;
+    if (!yundb::decodeIndexEntry(entry, limit, &key, &keyLen, &value, &valueLen, &next)) {
+      return -1;
+    }
+    if (cmp->cmp(yundb::Slice(key, keyLen - yundb::KeyTagSize), userTarget) > 0) {
+      break;
+    }
+    entry = next;
+    index++;
+  }
+  return index;
+}
+
+int main()
+{
+  constexpr int Seeks = 200000;
+
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  options.block_restart_interval = 1;
+  yundb::BlockHandle handleBuilder;
+
+  std::printf("%-8s %14s %14s\n", "entries", "linear ns/op", "binary ns/op");
+  for (int n = 16; n <= 64 * 1024; n *= 4)
+  {
+    yundb::DataBlockBuilder builder(options);
+    for (int i = 0; n > i; i++) {
+      builder.put(internalKey(i * 2), handleBuilder.encode(i * 4096, 4096));
+    }
+    std::string block = builder.finish();
+
+    std::vector<std::string> targets;
+    yundb::Random rand(301);
+    for (int i = 0; 1024 > i; i++) {
+      targets.push_back(internalKey(rand.Uniform(n * 2)));
+    }
+
+    // Linear scan touches every entry, keep its op count bounded
+    const int linearSeeks = Seeks / (n / 16);
+    uint64_t sink = 0;
+    uint64_t start = bench::nowNanos();
+    for (int i = 0; linearSeeks > i; i++) {
+      sink += linearSeek(block, targets[i & 1023], options.comparator);
+    }
+    double linearNs = static_cast<double>(bench::nowNanos() - start) / linearSeeks;
+
+    yundb::IndexBlockIterator iter(block.data(), block.data() + block.size(), options);
+    start = bench::nowNanos();
+    for (int i = 0; Seeks > i; i++) {
+      iter.seek(targets[i & 1023]);
+      sink += iter.index();
+    }
+    double binaryNs = static_cast<double>(bench::nowNanos() - start) / Seeks;
+
+    std::printf("%-8d %14.1f %14.1f\n", n, linearNs, binaryNs);
+    if (sink == 0) std::printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,68 @@
+// Multi-threaded MemTable insert throughput.
+//
+// Compares writers that serialize MemTable::add behind one mutex, which
+// is what a single write leader amounts to, with writers that all call
+// MemTable::addConcurrently.
+#include "db/memtable.h"
+#include "yundb/comparator.h"
+#include "yundb/options.h"
+#include "util/arena.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static constexpr int TotalOps = 800000;
+
+static void runAdds(yundb::MemTable* mem, std::mutex* mu, int id, int threadNum)
+{
+  char key[32];
+  std::string value(100, 'v');
+  for (int i = id; TotalOps > i; i += threadNum)
+  {
+    // Scatter the keys so threads do not append to the same spot
+    std::snprintf(key, sizeof(key), "%016llx",
+                  static_cast<unsigned long long>(i) * 0x9e3779b97f4a7c15ull);
+    if (mu != nullptr) {
+      std::lock_guard<std::mutex> lock(*mu);
+      mem->add(i, yundb::TypeValue, key, value);
+    } else {
+      mem->addConcurrently(i, yundb::TypeValue, key, value);
+    }
+  }
+}
+
+static double measure(bool concurrent, int threadNum)
+{
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  yundb::MemTable mem(std::make_shared<yundb::Arena>(), options);
+  std::mutex mu;
+
+  std::vector<std::thread> threads;
+  uint64_t start = bench::nowNanos();
+  for (int t = 0; threadNum > t; t++) {
+    threads.emplace_back(runAdds, &mem, concurrent ? nullptr : &mu, t, threadNum);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double seconds = static_cast<double>(bench::nowNanos() - start) / 1e9;
+  return TotalOps / seconds;
+}
+
+int main()
+{
+  std::printf("%-8s %18s %18s\n", "threads", "mutex ops/s", "concurrent ops/s");
+  for (int threads = 1; threads <= 32; threads *= 2)
+  {
+    double serialized = measure(false, threads);
+    double concurrent = measure(true, threads);
+    std::printf("%-8d %18.0f %18.0f\n", threads, serialized, concurrent);
+  }
+  return 0;
+}
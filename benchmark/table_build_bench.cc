@@ -0,0 +1,69 @@
+// SstableBuilder throughput by number of compression threads.
+//
+// Builds a table of compressible entries with every
+// compression_parallel_threads setting and reports the MB of raw entries
+// written per second.
+#include "db/sstable_builder.h"
+#include "db/dbformat.h"
+#include "yundb/comparator.h"
+#include "yundb/en.h"
+#include "yundb/options.h"
+#include "util/coding.h"
+#include "util/file_name.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <string>
+
+static constexpr int TotalEntries = 400000;
+
+static double measure(int threadNum)
+{
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  options.compression_parallel_threads = threadNum;
+  const std::string fileName = yundb::generateTableFileName(777777, BENCH_TEMP_DIR);
+
+  yundb::WritableFile* file = nullptr;
+  options.env->newWritableFile(fileName, &file);
+  if (file == nullptr) {
+    std::fprintf(stderr, "create %s fail\n", fileName.c_str());
+    return 0;
+  }
+
+  char userKey[32];
+  std::string key;
+  // Repeating value, so snappy has work to do
+  std::string value;
+  for (int i = 0; 200 > i; i++) {
+    value.push_back(static_cast<char>('a' + i % 7));
+  }
+
+  uint64_t bytes = 0;
+  uint64_t start = bench::nowNanos();
+  {
+    yundb::SstableBuilder builder(options, file);
+    for (int i = 0; TotalEntries > i; i++)
+    {
+      std::snprintf(userKey, sizeof(userKey), "%016d", i);
+      key = userKey;
+      yundb::PutFixed64(&key, yundb::packSeqAndType(i, yundb::TypeValue));
+      builder.add(key, value);
+      bytes += key.size() + value.size();
+    }
+    builder.finish();
+  }
+  double seconds = static_cast<double>(bench::nowNanos() - start) / 1e9;
+
+  options.env->removeFile(fileName);
+  return bytes / seconds / (1024 * 1024);
+}
+
+int main()
+{
+  std::printf("%-8s %12s\n", "threads", "MB/s");
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    std::printf("%-8d %12.1f\n", threads, measure(threads));
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// Point lookup latency of TableCache.
+//
+// "reopen" parses footer, filter block and index block on every Get, which
+// is what TableCache::lookup used to do. "cached" goes through the
+// SstableReader pinned in the table cache and only reads the data block.
+#include "db/sstable_builder.h"
+#include "db/table_cache.h"
+#include "db/memtable.h"
+#include "db/dbformat.h"
+#include "util/coding.h"
+#include "util/file_name.h"
+#include "yundb/comparator.h"
+#include "bench_util.h"
+#include "../test/test_util.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+int main()
+{
+  constexpr int Reads = 20000;
+  constexpr uint64_t FileNumber = 777777;
+
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  std::string fileName = yundb::generateTableFileName(FileNumber, BENCH_TEMP_DIR);
+
+  auto arena = std::make_shared<yundb::Arena>();
+  yundb::MemTable memTable(arena, options);
+  StringGenerater generater(0xdeadbeef, 64);
+  std::map<std::string, std::string> kvMap;
+  yundb::SequenceNumber seq = 0;
+
+  while (memTable.getMemoryUsage() <= options.max_file_size) {
+    std::string key = generater.getRandString();
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable.add(seq++, yundb::TypeValue, key, value);
+  }
+
+  yundb::WritableFile* writeFile;
+  options.env->newWritableFile(fileName, &writeFile);
+  {
+    yundb::SstableBuilder builder(options, writeFile);
+    builder.build(&memTable);
+  }
+
+  uint64_t fileSize = 0;
+  options.env->getFileSize(fileName, &fileSize);
+
+  std::vector<std::string> keys;
+  for (const auto& kv : kvMap) {
+    std::string key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(yundb::MaxSequenceNumber,
+                                                   yundb::TypeForSeek));
+    keys.push_back(key);
+  }
+
+  yundb::Random rand(301);
+  bench::Latency latency;
+  std::string value;
+  yundb::ReadOptions readOptions;
+
+  // Reopen the table on every lookup
+  for (int i = 0; Reads > i; i++) {
+    const std::string& key = keys[rand.Uniform(keys.size())];
+    uint64_t start = bench::nowNanos();
+    yundb::TableCache tableCache(BENCH_TEMP_DIR, options,
+                                 std::make_shared<yundb::Cache>(options.max_cache_size,
+                                                              options.cache_shard_bits));
+    tableCache.lookup(readOptions, FileNumber, fileSize, key, &value);
+    latency.add(bench::nowNanos() - start);
+  }
+  latency.report("reopen");
+  latency.clear();
+
+  // Reader is pinned in cache
+  yundb::TableCache tableCache(BENCH_TEMP_DIR, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size,
+                                                              options.cache_shard_bits));
+  for (int i = 0; Reads > i; i++) {
+    const std::string& key = keys[rand.Uniform(keys.size())];
+    uint64_t start = bench::nowNanos();
+    tableCache.lookup(readOptions, FileNumber, fileSize, key, &value);
+    latency.add(bench::nowNanos() - start);
+  }
+  latency.report("cached");
+  latency.clear();
+
+  // Reader and uncompressed data blocks are pinned in cache
+  yundb::TableCache blockCachedTable(BENCH_TEMP_DIR, options,
+                                     std::make_shared<yundb::Cache>(options.max_cache_size,
+                                                                    options.cache_shard_bits),
+                                     std::make_shared<yundb::Cache>(options.block_cache_size,
+                                                                    options.cache_shard_bits));
+  for (int i = 0; Reads > i; i++) {
+    const std::string& key = keys[rand.Uniform(keys.size())];
+    uint64_t start = bench::nowNanos();
+    blockCachedTable.lookup(readOptions, FileNumber, fileSize, key, &value);
+    latency.add(bench::nowNanos() - start);
+  }
+  latency.report("block cached");
+
+  options.env->removeFile(fileName);
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Multi-threaded DB::Put throughput.
+//
+// Every thread writes its own keys. Concurrent writers are merged by the
+// write leader into one log record, so with sync=true the fsync cost is
+// shared by the group.
+#include "yundb/db.h"
+#include "yundb/comparator.h"
+#include "yundb/options.h"
+#include "bench_util.h"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void runPuts(yundb::DB* db, bool sync, int id, int ops)
+{
+  yundb::WriteOptions writeOptions;
+  writeOptions.sync = sync;
+  std::string value(100, 'v');
+  for (int i = 0; ops > i; i++)
+  {
+    db->Put(writeOptions, std::to_string(id) + "_" + std::to_string(i), value);
+  }
+}
+
+static double measure(bool sync, int threadNum)
+{
+  const int opsPerThread = sync ? 2000 : 50000;
+  std::string dbName = std::string(BENCH_TEMP_DIR) + "/write_bench";
+
+  yundb::Options options;
+  options.comparator = yundb::BytewiseCmp();
+  options.create_if_missing = true;
+  yundb::DestroyDB(dbName, options);
+
+  yundb::DB* dbptr = nullptr;
+  if (!yundb::DB::Open(options, dbName, &dbptr)) return 0;
+  std::unique_ptr<yundb::DB> db(dbptr);
+
+  std::vector<std::thread> threads;
+  uint64_t start = bench::nowNanos();
+  for (int t = 0; threadNum > t; t++) {
+    threads.emplace_back(runPuts, db.get(), sync, t, opsPerThread);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  double seconds = static_cast<double>(bench::nowNanos() - start) / 1e9;
+
+  db.reset();
+  yundb::DestroyDB(dbName, options);
+  return static_cast<double>(opsPerThread) * threadNum / seconds;
+}
+
+int main()
+{
+  std::printf("%-8s %18s %18s\n", "threads", "sync=0 ops/s", "sync=1 ops/s");
+  for (int threads = 1; threads <= 32; threads *= 2)
+  {
+    double noSync = measure(false, threads);
+    double sync = measure(true, threads);
+    std::printf("%-8d %18.0f %18.0f\n", threads, noSync, sync);
+  }
+  return 0;
+}
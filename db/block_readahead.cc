@@ -0,0 +1,77 @@
+#include "block_readahead.h"
+#include "util/error_print.h"
+
+#include <algorithm>
+
+namespace yundb
+{
+
+constexpr size_t BlockReadahead::InitialSize;
+
+BlockReadahead::BlockReadahead(const RandomAccessFile* file, uint64_t fileSize,
+                               size_t fixedSize, size_t maxSize)
+    : _file(file),
+      _fileSize(fileSize),
+      _fixedSize(fixedSize),
+      _maxSize(maxSize),
+      _readaheadSize(fixedSize > 0 ? fixedSize : std::min(InitialSize, maxSize)),
+      _sequentialReads(0),
+      _lastEnd(0),
+      _windowOffset(0),
+      _scratchSize(0) {}
+
+bool BlockReadahead::read(const PosAndSize& p, Slice* result, bool forward)
+{
+  const bool sequential = (p.first == _lastEnd);
+  _lastEnd = p.first + p.second;
+
+  if (windowHolds(p)) {
+    *result = Slice(_window.data() + (p.first - _windowOffset), p.second);
+    return true;
+  }
+
+  if (sequential && forward) {
+    _sequentialReads++;
+  } else {
+    _sequentialReads = 0;
+    if (_fixedSize == 0) _readaheadSize = std::min(InitialSize, _maxSize);
+  }
+
+  if (!forward || (_fixedSize == 0 && (_maxSize == 0 || _sequentialReads < 2))) {
+    // Not a scan yet, read the block alone
+    _window = Slice();
+    return readInto(p.first, p.second, result);
+  }
+
+  uint64_t bytes = std::max<uint64_t>(_readaheadSize, p.second);
+  if (p.first < _fileSize) bytes = std::max<uint64_t>(p.second, std::min(bytes, _fileSize - p.first));
+  if (!readInto(p.first, bytes, &_window) || _window.size() < p.second) {
+    _window = Slice();
+    printError("BlockReadahead: read window error");
+    return false;
+  }
+  _windowOffset = p.first;
+  *result = Slice(_window.data(), p.second);
+
+  if (_fixedSize == 0) _readaheadSize = std::min(_readaheadSize * 2, _maxSize);
+  // Let the file system fetch the next window while this one is used
+  const uint64_t next = _windowOffset + _window.size();
+  if (next < _fileSize) {
+    _file->prefetch(next, std::min<uint64_t>(_readaheadSize, _fileSize - next));
+  }
+  return true;
+}
+
+bool BlockReadahead::readInto(uint64_t offset, uint64_t bytes, Slice* result)
+{
+  // A mapped file hands out its mapping, the window is never copied
+  if (_file->isMemoryMapped()) return _file->read(offset, result, nullptr, bytes);
+
+  if (bytes > _scratchSize) {
+    _scratch.reset(new char[bytes]);
+    _scratchSize = bytes;
+  }
+  return _file->read(offset, result, _scratch.get(), bytes);
+}
+
+}
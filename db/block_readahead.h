@@ -0,0 +1,70 @@
+#ifndef YUNDB_DB_BLOCK_READAHEAD_H
+#define YUNDB_DB_BLOCK_READAHEAD_H
+
+#include "yundb/en.h"
+#include "yundb/slice.h"
+#include "table_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace yundb
+{
+
+// Reads ahead of a scan over the blocks of one table file. A read that
+// starts where the previous one ended is sequential. With a fixed size
+// every read fills a window of that size; otherwise the readahead starts
+// after two sequential reads at InitialSize and doubles on every refill up
+// to maxSize. A read that is not sequential starts over. The file is asked
+// to prefetch the window after each one. Reads of a backward scan only
+// read their block, the window never reaches the blocks before it.
+//
+// Not thread-safe, every iterator owns its own.
+class BlockReadahead
+{
+ public:
+  static constexpr size_t InitialSize = 8 * 1024;
+
+  BlockReadahead(const RandomAccessFile* file, uint64_t fileSize,
+                 size_t fixedSize, size_t maxSize);
+
+  BlockReadahead(const BlockReadahead&) = delete;
+  BlockReadahead& operator=(const BlockReadahead&) = delete;
+
+  // Set *result to the bytes of block p, taken from the window when it
+  // holds them. forward is false when the reader moves to the blocks
+  // before p. *result is valid until the next call.
+  // Return false on read error
+  bool read(const PosAndSize& p, Slice* result, bool forward = true);
+
+ private:
+  bool windowHolds(const PosAndSize& p) const
+  {
+    return p.first >= _windowOffset &&
+           p.first + p.second <= _windowOffset + _window.size();
+  }
+
+  // Read [offset, offset + bytes) into the scratch buffer or point at the
+  // bytes of a mapped file
+  bool readInto(uint64_t offset, uint64_t bytes, Slice* result);
+
+  const RandomAccessFile* const _file;
+  const uint64_t _fileSize;
+  const size_t _fixedSize;
+  const size_t _maxSize;
+  // Size of the next window
+  size_t _readaheadSize;
+  // Sequential reads since the last one that was not
+  int _sequentialReads;
+  // End of the last block read
+  uint64_t _lastEnd;
+  uint64_t _windowOffset;
+  Slice _window;
+  std::unique_ptr<char[]> _scratch;
+  size_t _scratchSize;
+};
+
+}
+
+#endif // YUNDB_DB_BLOCK_READAHEAD_H
@@ -2,244 +2,396 @@
 #include "util/coding.h"
 #include "yundb/comparator.h"
 #include "dbformat.h"
+#include "table_format.h"
 #include <utility>
 
 namespace yundb
 {
 
-DataBlockReader::DataBlockReader(const Options& options)
-    : _options(options) {}
+// Return the start of restart array
+static const char* entryLimit(const char* start, const char* end)
+{
+  if (start == nullptr || end == nullptr || end - start < 4) {
+    return nullptr;
+  }
 
- DataBlockReader::Iter::Iter() 
-      : _blockStart(nullptr),
-        _restartEntry(nullptr),
-        _headRestartEntry(nullptr),
-        _tailRestartEntry(nullptr),
-        _sharedKeyLen(0){}
+  const uint32_t restartNum = DecodeFixed32(end - 4);
+  const size_t restartBytes = static_cast<size_t>(restartNum + 1) * sizeof(uint32_t);
+  if (static_cast<size_t>(end - start) < restartBytes) {
+    return nullptr;
+  }
+
+  return end - restartBytes;
+}
 
-DataBlockReader::Iter::Iter(const char* blockStart, const char* restartEntry,
-                            const char* headEntry, const char* tailEntry)
-      : _blockStart(blockStart),
-        _restartEntry(restartEntry),
-        _headRestartEntry(headEntry),
-        _tailRestartEntry(tailEntry),
-        _sharedKeyLen(0)
+IndexBlockIterator::IndexBlockIterator(const char* start, const char* end,
+                                       const Options& options)
+      : _start(start),
+        _end(end),
+        _cur(start),
+        _limit(entryLimit(start, end)),
+        _comparator(options.comparator),
+        _restartNum(0),
+        _index(0),
+        _valid(start != nullptr && end != nullptr && start < end && _limit != nullptr)
 {
-  if (_restartEntry >= _headRestartEntry && _restartEntry <= _tailRestartEntry) {
-    uint32_t offset = DecodeFixed32(_restartEntry);
-    decodeEntry(blockStart + offset);
+  if (_valid) _restartNum = DecodeFixed32(_end - 4);
+  seekToFirst();
+}
+
+void IndexBlockIterator::seekToFirst()
+{
+  if (_limit == nullptr) return;
+
+  const char* key = nullptr;
+  const char* value = nullptr;
+  const char* next = nullptr;
+  uint64_t keyLen = 0;
+  uint64_t valueLen = 0;
+  if (_restartNum == 0 ||
+      !decodeIndexEntry(_start, _limit, &key, &keyLen, &value, &valueLen, &next)) {
+    _index = -1;
+    _cur = _start;
+    _valid = false;
+    return;
   }
-  _headKey = _keyDelta;
+
+  _index = 0;
+  _cur = _start;
+  _valid = true;
 }
 
-std::string DataBlockReader::Iter::getValue()
-{ return _value; }
+int IndexBlockIterator::cmp(const char* key1, size_t key1Len,
+                            const char* key2, size_t key2Len) const
+{
+  int rs = _comparator->cmp(
+    Slice(key1, key1Len - KeyTagSize),
+    Slice(key2, key2Len - KeyTagSize)
+  );
+
+  if (rs == 0) {
+    SequenceNumber seq1, seq2;
+    decodeSeqAndType(key1 + key1Len - KeyTagSize, &seq1, NULL);
+    decodeSeqAndType(key2 + key2Len - KeyTagSize, &seq2, NULL);
+    if (seq1 > seq2) {
+      return 1;
+    } else {
+      return -1;
+    }
+  } else {
+    return rs;
+  }
+}
 
-std::string DataBlockReader::Iter::getKey()
+void IndexBlockIterator::seek(const Slice& target)
 {
-  if (_sharedKeyLen == 0) return _keyDelta;
-  std::string key;
-  key.reserve(_sharedKeyLen + _keyDelta.size());
-  key.append(_headKey, 0, _sharedKeyLen);
-  key.append(_keyDelta);
-  return key;
+  if (_limit == nullptr || _restartNum == 0) return;
+
+  // Find the first restart point whose key is greater than target
+  uint32_t left = 0;
+  uint32_t right = _restartNum;
+  while (left < right)
+  {
+    uint32_t mid = left + (right - left) / 2;
+    const char* key = nullptr, *value = nullptr, *next = nullptr;
+    uint64_t keyLen = 0, valueLen = 0;
+
+    if (!decodeIndexEntry(restartPoint(mid), _limit, &key, &keyLen,
+                          &value, &valueLen, &next)) {
+      _index = -1;
+      _cur = _start;
+      _valid = false;
+      return;
+    }
+
+    if (this->cmp(key, keyLen, target.data(), target.size()) > 0) {
+      right = mid;
+    } else {
+      left = mid + 1;
+    }
+  }
+
+  if (left == 0) {
+    // All keys are greater than target
+    _index = -1;
+    _cur = _start;
+    _valid = false;
+    return;
+  }
+
+  _index = static_cast<int>(left - 1);
+  _cur = restartPoint(left - 1);
+  _valid = true;
 }
 
-bool DataBlockReader::Iter::operator<(const Iter& other)
-{return _restartEntry < other._restartEntry;}
+void IndexBlockIterator::next()
+{
+  if (!_valid) return;
+
+  // Every index entry is a restart point
+  if (static_cast<uint32_t>(_index + 1) >= _restartNum) {
+    _index = -1;
+    _cur = _start;
+    _valid = false;
+    return;
+  }
 
-bool DataBlockReader::Iter::operator>(const Iter& other)
-{return _restartEntry > other._restartEntry;}
+  _index++;
+  _cur = restartPoint(static_cast<uint32_t>(_index));
+}
 
+Slice IndexBlockIterator::key() const
+{
+  if (!_valid) return Slice();
+
+  const char* key = nullptr;
+  const char* value = nullptr;
+  const char* next = nullptr;
+  uint64_t keyLen = 0;
+  uint64_t valueLen = 0;
+  if (!decodeIndexEntry(_cur, _limit, &key, &keyLen, &value, &valueLen, &next)) {
+    return Slice();
+  }
+
+  return Slice(key, static_cast<size_t>(keyLen));
+}
 
-bool DataBlockReader::Iter::operator<=(const Iter& other)
-{return !this->operator>(other);}
+Slice IndexBlockIterator::value() const
+{
+  if (!_valid) return Slice();
+
+  const char* key = nullptr;
+  const char* value = nullptr;
+  const char* next = nullptr;
+  uint64_t keyLen = 0;
+  uint64_t valueLen = 0;
+  if (!decodeIndexEntry(_cur, _limit, &key, &keyLen, &value, &valueLen, &next)) {
+    return Slice();
+  }
 
-bool DataBlockReader::Iter::operator>=(const Iter& other)
-{return !this->operator<(other);}
+  return Slice(value, static_cast<size_t>(valueLen));
+}
 
-DataBlockReader::Iter DataBlockReader::Iter::operator+(ptrdiff_t number)
+BlockIterator::BlockIterator(const Comparator* comparator, const Slice& block)
+      : _comparator(comparator),
+        _data(block.data()),
+        _restarts(0),
+        _restartNum(0),
+        _current(0),
+        _restartIndex(0)
 {
-  const char* newRestartPtr = _restartEntry + number * 4;
-  if (newRestartPtr > _tailRestartEntry || newRestartPtr < _headRestartEntry) {
-    return Iter();
+  if (block.size() >= sizeof(uint32_t))
+  {
+    _restartNum = DecodeFixed32(block.data() + block.size() - sizeof(uint32_t));
+    const size_t restartBytes = (static_cast<size_t>(_restartNum) + 1) * sizeof(uint32_t);
+    if (restartBytes <= block.size()) {
+      _restarts = static_cast<uint32_t>(block.size() - restartBytes);
+    } else {
+      printError("BlockIterator: bad restart number");
+      _restartNum = 0;
+    }
   }
-  return Iter(_blockStart, newRestartPtr, _headRestartEntry, _tailRestartEntry);
+
+  // Invalid until seek
+  _current = _restarts;
 }
 
-DataBlockReader::Iter DataBlockReader::Iter::operator-(ptrdiff_t number)
-{return this->operator+(-number);}
+void BlockIterator::markInvalid()
+{
+  _current = _restarts;
+  _restartIndex = _restartNum;
+  _key.clear();
+  // Keep parseNextEntry() at the end of block
+  _value = Slice(_data + _restarts, 0);
+}
 
-inline bool DataBlockReader::Iter::empty() const
-{return _restartEntry == nullptr;}
+void BlockIterator::seekToRestartPoint(uint32_t index)
+{
+  _restartIndex = index;
+  _key.clear();
+  // parseNextEntry() starts at the end of _value
+  _value = Slice(_data + getRestartPoint(index), 0);
+}
 
-bool DataBlockReader::Iter::next()
+bool BlockIterator::parseNextEntry()
 {
-  Iter tmp = *this;
-  if (_nextDataEntry == _headRestartEntry) {
+  _current = nextEntryOffset();
+  if (_current >= _restarts) {
+    markInvalid();
     return false;
   }
 
-  if (!decodeEntry(_nextDataEntry)) {
-    *this = tmp;
+  const char* p = _data + _current;
+  const char* limit = _data + _restarts;
+  uint32_t shared = 0, unshared = 0, valueLen = 0;
+  p = GetVarint32Ptr(p, limit, &shared);
+  if (p != nullptr) p = GetVarint32Ptr(p, limit, &unshared);
+  if (p != nullptr) p = GetVarint32Ptr(p, limit, &valueLen);
+
+  if (p == nullptr || static_cast<uint32_t>(limit - p) < unshared + valueLen) {
+    printError("BlockIterator: bad entry");
+    markInvalid();
     return false;
   }
 
+  while (_restartIndex + 1 < _restartNum &&
+         getRestartPoint(_restartIndex + 1) <= _current) {
+    ++_restartIndex;
+  }
+
+  if (shared == 0) {
+    _key = Slice(p, unshared);
+  } else {
+    if (shared > _restartKey.size()) {
+      printError("BlockIterator: shared key longer than restart key");
+      markInvalid();
+      return false;
+    }
+    _keyBuffer.assign(_restartKey.data(), shared);
+    _keyBuffer.append(p, unshared);
+    _key = Slice(_keyBuffer);
+  }
+
+  if (_current == getRestartPoint(_restartIndex)) {
+    _restartKey = _key;
+  }
+
+  _value = Slice(p + unshared, valueLen);
   return true;
 }
 
-bool DataBlockReader::Iter::seek(const Slice& key, const Comparator* comparator,
-                                 int restartInterval, std::string* result)
+void BlockIterator::seekToFirst()
 {
-  bool found = false;
-  std::string curResult;
-  const char* keyPtr = key.data();
-  const Slice userKey(keyPtr, key.size() - KeyTagSize);
-  SequenceNumber keySeq;
-  decodeSeqAndType(keyPtr + key.size() - KeyTagSize, &keySeq, nullptr);
-
-  for (int i = 0; restartInterval > i; i++)
-  {
-    const std::string cur = getKey();
-    const char* curPtr = cur.data();
-    const Slice curUserKey(curPtr, cur.size() - KeyTagSize);
-
-    if (comparator->cmp(userKey, curUserKey) == 0) {
-      SequenceNumber curKeySeq;
-      ValueType type;
-      decodeSeqAndType(curPtr + cur.size() - KeyTagSize, &curKeySeq, &type);
-      if (keySeq > curKeySeq) {
-        found = true;
-        curResult = getValue();
-      }
-    }
-    
-    if (!next()) break;
+  if (_restartNum == 0) {
+    markInvalid();
+    return;
   }
+  seekToRestartPoint(0);
+  parseNextEntry();
+}
 
-  if (!curResult.empty()) {
-    result->append(std::move(curResult));
+void BlockIterator::seekToLast()
+{
+  if (_restartNum == 0) {
+    markInvalid();
+    return;
+  }
+  seekToRestartPoint(_restartNum - 1);
+  while (parseNextEntry() && nextEntryOffset() < _restarts) {
+    // Keep skipping
   }
-  
-  return found;
 }
 
-DataBlockReader::Iter mid(const DataBlockReader::Iter& left,
-                          const DataBlockReader::Iter& right)
+void BlockIterator::seekToRestartPointBefore(const Slice& target)
 {
-  if (left._restartEntry > right._restartEntry) {
-    printError("DataBlockReader: error left and right Iter");
-    return DataBlockReader::Iter();
-  }
+  uint32_t left = 0;
+  uint32_t right = _restartNum - 1;
+
+  while (left < right)
+  {
+    uint32_t mid = (left + right + 1) / 2;
+    const char* p = _data + getRestartPoint(mid);
+    uint32_t shared = 0, unshared = 0, valueLen = 0;
+    p = GetVarint32Ptr(p, _data + _restarts, &shared);
+    if (p != nullptr) p = GetVarint32Ptr(p, _data + _restarts, &unshared);
+    if (p != nullptr) p = GetVarint32Ptr(p, _data + _restarts, &valueLen);
+
+    if (p == nullptr || shared != 0) {
+      printError("BlockIterator: bad restart entry");
+      markInvalid();
+      return;
+    }
 
-  size_t n = (right._restartEntry - left._restartEntry) / 4;
-  const char* newRestartPtr = left._restartEntry + (n / 2) * 4;
-  if (newRestartPtr > right._tailRestartEntry ||
-      newRestartPtr < left._headRestartEntry) {
-    printError("DataBlockReader: error restart ptr");
-    return DataBlockReader::Iter();
+    if (compareInternalKey(_comparator, Slice(p, unshared), target) < 0) {
+      left = mid;
+    } else {
+      right = mid - 1;
+    }
   }
 
-  return DataBlockReader::Iter(
-    left._blockStart,
-    newRestartPtr,
-    left._headRestartEntry,
-    left._tailRestartEntry
-  );
+  seekToRestartPoint(left);
 }
 
-bool DataBlockReader::Iter::decodeEntry(const char* start)
+void BlockIterator::seek(const Slice& target)
 {
-  if (start == nullptr) {
-    printError("DataBlockReader: None start ptr");
-    return false;
+  if (_restartNum == 0) {
+    markInvalid();
+    return;
+  }
+
+  seekToRestartPointBefore(target);
+  while (parseNextEntry())
+  {
+    if (compareInternalKey(_comparator, _key, target) >= 0) {
+      return;
+    }
   }
+}
 
-  uint64_t unsharedKeyLen = 0, valueLen = 0;
-  start = GetVarint64Ptr(start, start + 10, &_sharedKeyLen);
-  start = GetVarint64Ptr(start, start + 10, &unsharedKeyLen);
+void BlockIterator::next()
+{
+  assert(valid());
+  parseNextEntry();
+}
 
-  if (unsharedKeyLen == 0) return false;
+void BlockIterator::prev()
+{
+  assert(valid());
 
-  start = GetVarint64Ptr(start, start + 10, &valueLen);
+  // Scan backwards to a restart point before current
+  const uint32_t original = _current;
+  while (getRestartPoint(_restartIndex) >= original)
+  {
+    if (_restartIndex == 0) {
+      // No more entries
+      markInvalid();
+      return;
+    }
+    _restartIndex--;
+  }
 
-  _keyDelta.assign(start, unsharedKeyLen);
-  _value.assign(start + unsharedKeyLen, valueLen);
-  _nextDataEntry = start + unsharedKeyLen + valueLen;
-  return true;
+  seekToRestartPoint(_restartIndex);
+  // Loop until end of current entry hits the start of original entry
+  while (parseNextEntry() && nextEntryOffset() < original) {
+    // Keep skipping
+  }
 }
 
+DataBlockReader::DataBlockReader(const Options& options)
+    : _options(options) {}
+
 // Key format is | key | seq, type | 
 bool DataBlockReader::queryValue(const Slice& block, const Slice& key, std::string* result)
 {
   if (block.empty() || key.empty() || result == nullptr) {
     printError("DatablockReader: None block, key or result");
+    return false;
   }
 
-  const char* data = block.data();
-  size_t blockSize = block.size();
-  uint32_t restartPtrLen = DecodeFixed32(data + blockSize - 4);
-  const char* headEntry = data + blockSize - 4 * (restartPtrLen + 1);
-  const char* tailEntry = data + blockSize - 8;
-
-  Iter left(data, headEntry, headEntry, tailEntry);
-  Iter right(data, tailEntry, headEntry, tailEntry);
-
-  const Comparator* comparator = _options.comparator;
-  Iter midIter;
-
-  auto cmp = [&](const Slice& key1, const Slice& key2) {
-    const char* key1Ptr = key1.data();
-    const char* key2Ptr = key2.data();
-
-    // Cmp user key
-    Slice userKey1 = key1;
-    userKey1.removeTailfix(KeyTagSize);
-    Slice userKey2 = key2;
-    userKey2.removeTailfix(KeyTagSize);
-    int rs = comparator->cmp(userKey1, userKey2);
-
-    // Cmp seq
-    if (rs == 0)
-    {
-      SequenceNumber key1Seq, key2Seq;
-      decodeSeqAndType(key1Ptr + key1.size() - KeyTagSize, &key1Seq, nullptr);
-      decodeSeqAndType(key2Ptr + key2.size() - KeyTagSize, &key2Seq, nullptr);
-
-      if (key1Seq > key2Seq) {
-        rs = +1;
-      } else if (key1Seq < key2Seq) {
-        rs = -1;
-      }
-    }
-
-    return rs;
-  };
+  BlockIterator iter(_options.comparator, block);
+  if (iter._restartNum == 0) return false;
 
-  Iter seekIter = mid(left, right);
+  const Slice userKey(key.data(), key.size() - KeyTagSize);
+  bool found = false;
+  Slice value;
 
-  while (left <= right)
+  // Entries of one user key are sorted by ascending seq, the wanted entry is
+  // the last one before key
+  iter.seekToRestartPointBefore(key);
+  while (iter.parseNextEntry() && compareInternalKey(_options.comparator, iter.key(), key) < 0)
   {
-    midIter = mid(left, right);
-    if (midIter.empty()) {
-      printError("DataBlockReader: error mid Iter");
-      return false;
-    }
-    int rs = cmp(midIter.getKey(), key);
-
-    if (rs > 0) {
-      right = midIter - 1;
-    } else {
-      seekIter = midIter;
-      left = midIter + 1;
+    const Slice curUserKey(iter.key().data(), iter.key().size() - KeyTagSize);
+    if (_options.comparator->cmp(curUserKey, userKey) == 0) {
+      found = true;
+      value = iter.value();
     }
+  }
 
-    if (left.empty() || right.empty()) {
-      break;
-    }
+  if (found) {
+    result->assign(value.data(), value.size());
   }
 
-  return seekIter.seek(key, comparator, _options.block_restart_interval, result);
+  return found;
 }
 
-}
\ No newline at end of file
+}
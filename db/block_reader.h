@@ -2,81 +2,155 @@
 #define YUNDB_DB_BLOCK_READER_H
 // Header guard standardized to YUNDB_DB_BLOCK_READER_H
 
+#include "yundb/iterator.h"
 #include "yundb/options.h"
 #include "yundb/slice.h"
 #include "util/coding.h"
 
+#include <string>
+
 namespace yundb
 {
 
-class DataBlockReader
+// Iterate the index block, entry format is
+// | 0 | key len | handle len | key | data block handle |
+// Index block is built with block_restart_interval = 1, so every entry
+// is a restart point and seek() is a binary search over the restart array.
+class IndexBlockIterator
 {
- private:
+ public:
+  // Start and end of whole index block
+  IndexBlockIterator(const char* start, const char* end, const Options& options);
+
+  IndexBlockIterator(const IndexBlockIterator&) = delete;
+
+  IndexBlockIterator& operator=(const IndexBlockIterator&) = delete;
+
+  ~IndexBlockIterator() = default;
+
+  bool valid() const { return _valid; }
+
+  void seekToFirst();
+
+  // Position at the last entry whose key is not greater than target,
+  // it is the only data block that may contain target
+  void seek(const Slice& target);
 
-  class Iter
-  {
-  public:
-    Iter(const char* blockStart, const char* restartEntry,
-         const char* headEntry, const char* tailEntry);
+  // Move to the next entry, the iterator is invalid after the last one
+  void next();
 
-    Iter(const Iter& other) = default;
+  // First internal key of the data block
+  Slice key() const;
 
-    Iter();
+  // Get data block handle
+  Slice value() const;
 
-    ~Iter() = default;
+  size_t index() const { return _index; }
 
-    Iter& operator=(const Iter& other) = default;
+  uint32_t entryNum() const { return _restartNum; }
 
-    bool operator<(const Iter& other);
+  const char* blockStart() const { return _start; }
 
-    bool operator>(const Iter& other);
+  const char* blockEnd() const { return _end; }
+ private:
+  int cmp(const char* key1, size_t key1Len, const char* key2, size_t key2Len) const;
+
+  // Return the entry of restart point index
+  const char* restartPoint(uint32_t index) const
+  { return _start + DecodeFixed32(_limit + index * sizeof(uint32_t)); }
+
+  const char* _start;
+  const char* _end;
+  const char* _cur;
+  // Start of restart array
+  const char* _limit;
+  const Comparator* _comparator;
+  uint32_t _restartNum;
+  int _index;
+  bool _valid;
+};
+
+// Iterate a data block, entry format is
+// | shared key len | no shared key len | value len | key delta | value |
+// shared key len refers the key of the entry's restart point.
+//
+// key() and value() point straight into the block: a restart entry key and
+// every value are slices of the block, other keys are rebuilt in one
+// reused buffer. So the block must outlive the iterator.
+class BlockIterator : public Iterator
+{
+ public:
+  // Block is the uncompressed data block without trailer,
+  // comparator is the user key comparator
+  BlockIterator(const Comparator* comparator, const Slice& block);
 
-    bool operator<=(const Iter& other);
+  BlockIterator(const BlockIterator&) = delete;
+  BlockIterator& operator=(const BlockIterator&) = delete;
 
-    bool operator>=(const Iter& other);
+  ~BlockIterator() override = default;
 
-    // Move to another restart ptr entry
-    Iter operator+(ptrdiff_t number);
+  bool valid() const override { return _current < _restarts; }
 
-    Iter operator-(ptrdiff_t number);
+  void seekToFirst() override;
 
-    inline bool empty() const;
+  void seekToLast() override;
 
-    bool seek(const Slice& key, const Comparator* comparator,
-              int restartInterval, std::string* result);
+  void seek(const Slice& target) override;
 
-    inline std::string getValue();
+  void next() override;
 
-    inline std::string getKey();
+  void prev() override;
 
-    inline std::string getUserKey();
+  Slice key() const override { return _key; }
 
-  private:
-    // Get mid Iter for binary search
-    friend Iter mid(const Iter& left, const Iter& right);
-    // Decode the entry and store it inside the object
-    // Return false when decode false
-    bool decodeEntry(const char* start);
-    // Move to next entry, success return true otherwise return false
-    bool next();
-    const char* _blockStart;
-    const char* _restartEntry;
-    const char* _headRestartEntry;
-    const char* _tailRestartEntry;
-    const char* _nextDataEntry;
-    size_t _sharedKeyLen;
-    std::string _headKey;
-    std::string _keyDelta;
-    std::string _value;
-  };
+  Slice value() const override { return _value; }
 
+ private:
+  friend class DataBlockReader;
+
+  uint32_t getRestartPoint(uint32_t index) const
+  { return DecodeFixed32(_data + _restarts + index * sizeof(uint32_t)); }
+
+  // Offset of the entry after current entry
+  uint32_t nextEntryOffset() const
+  { return static_cast<uint32_t>((_value.data() + _value.size()) - _data); }
+
+  void seekToRestartPoint(uint32_t index);
+
+  // Position at the last restart point whose key is less than target,
+  // or the first restart point if there is no such restart point
+  void seekToRestartPointBefore(const Slice& target);
+
+  // Decode the entry at nextEntryOffset(), return false at the end of block
+  bool parseNextEntry();
+
+  void markInvalid();
+
+  const Comparator* const _comparator;
+  const char* const _data;
+  // Offset of restart array
+  uint32_t _restarts;
+  uint32_t _restartNum;
+  // Offset of current entry, _current >= _restarts means invalid
+  uint32_t _current;
+  uint32_t _restartIndex;
+  // Key of _restartIndex restart point
+  Slice _restartKey;
+  // Buffer for keys sharing prefix with their restart point key
+  std::string _keyBuffer;
+  Slice _key;
+  Slice _value;
+};
+
+class DataBlockReader
+{
  public:
   DataBlockReader(const Options& options);
   ~DataBlockReader() = default;
 
+  // Find the newest entry of key's user key whose seq is less than key's seq
   bool queryValue(const Slice& block, const Slice& key, std::string* result);
  private:
-  friend Iter mid(const Iter& left, const Iter& right);
   Options _options;
 };
 
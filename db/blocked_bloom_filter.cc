@@ -0,0 +1,200 @@
+#include "yundb/filter_policy.h"
+#include "util/hash.h"
+#include "util/error_print.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/*
+Filter format:
+|cache line|cache line|....|cache line|probes|
+Every cache line is 64 bytes. A key picks one line from its hash and sets
+probes bits inside it, the bit positions come from multiplying the hash
+by powers of the golden ratio.
+*/
+namespace yundb
+{
+
+static constexpr uint32_t CacheLineBytes = 64;
+static constexpr uint32_t CacheLineBits = CacheLineBytes * 8;
+// Probes a key may set, the SIMD path checks them all at once
+static constexpr uint32_t MaxProbes = 8;
+static constexpr uint32_t GoldenRatio = 0x9e3779b9;
+// Keys hashed and prefetched ahead of probing in keysMayMatch
+static constexpr int BatchSize = 16;
+
+static uint32_t blockedBloomHash(const Slice& key)
+{return hash(key.data(), key.size(), 0xbc9f1d34);}
+
+static constexpr uint32_t goldenRatioPower(int i)
+{return i == 0 ? 1 : GoldenRatio * goldenRatioPower(i - 1);}
+
+// Line of the filter that holds the probes of hash h
+static const char* lineOf(const char* array, uint32_t lines, uint32_t h)
+{
+  return array + static_cast<uint32_t>((static_cast<uint64_t>(h) * lines) >> 32) *
+                 CacheLineBytes;
+}
+
+#ifdef __AVX2__
+static bool lineMayMatch(const char* line, uint32_t h, uint32_t probes)
+{
+  // Lane i computes probe i of the scalar loop below
+  const __m256i powers = _mm256_setr_epi32(
+    goldenRatioPower(1), goldenRatioPower(2), goldenRatioPower(3), goldenRatioPower(4),
+    goldenRatioPower(5), goldenRatioPower(6), goldenRatioPower(7), goldenRatioPower(8));
+  __m256i bits = _mm256_srli_epi32(
+    _mm256_mullo_epi32(_mm256_set1_epi32(h), powers), 23);
+  // 32 bit word of the line and the bit inside it
+  __m256i words = _mm256_srli_epi32(bits, 5);
+  __m256i masks = _mm256_sllv_epi32(_mm256_set1_epi32(1),
+                                    _mm256_and_si256(bits, _mm256_set1_epi32(31)));
+  // Pick every probed word out of the two halves of the line, which is
+  // cheaper than a gather
+  __m256i lower = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line));
+  __m256i upper = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + 32));
+  __m256i inUpper = _mm256_cmpgt_epi32(words, _mm256_set1_epi32(7));
+  __m256i data = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(lower, words),
+                                    _mm256_permutevar8x32_epi32(upper, words),
+                                    inUpper);
+  // Ignore the lanes past the number of probes
+  __m256i used = _mm256_cmpgt_epi32(_mm256_set1_epi32(probes),
+                                    _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+  __m256i missing = _mm256_and_si256(_mm256_andnot_si256(data, masks), used);
+  return _mm256_testz_si256(missing, missing);
+}
+#else
+static bool lineMayMatch(const char* line, uint32_t h, uint32_t probes)
+{
+  for (uint32_t i = 0; probes > i; i++)
+  {
+    h *= GoldenRatio;
+    const uint32_t bitPos = h >> 23;
+    if (!(line[bitPos / 8] & (1 << (bitPos % 8)))) {
+      return false;
+    }
+  }
+  return true;
+}
+#endif
+
+class BlockedBloomPolicyFilter : public FilterPolicy
+{
+ public:
+  explicit BlockedBloomPolicyFilter(uint32_t bitsPerKey);
+  virtual ~BlockedBloomPolicyFilter(){};
+
+  virtual const char* Name() const override
+  {return "blocked bloom Filter";}
+  // Create filter and append dst
+  virtual int createFilter(const Slice* keys,
+                            int n, std::string* dst) const override;
+  // Return true if the key was
+  // in the list of keys passed to createFilter().
+  virtual bool keyMayMatch(const Slice& key, const Slice& filter) const override;
+  // Hash a batch of keys and prefetch their lines before probing them
+  virtual void keysMayMatch(const Slice* keys, int n, const Slice& filter,
+                            bool* results) const override;
+ private:
+  uint32_t _bitsPerKey;
+};
+
+BlockedBloomPolicyFilter::BlockedBloomPolicyFilter(uint32_t bitsPerKey)
+      : _bitsPerKey(bitsPerKey) {}
+
+int BlockedBloomPolicyFilter::createFilter(const Slice* keys,
+                                           int n, std::string* dst) const
+{
+  if (keys == nullptr || dst == nullptr) {
+    printError("BlockedBloomPolicyFilter: None keys or dst");
+  }
+  if (n <= 0) printError("BlockedBloomPolicyFilter: error n value");
+
+  uint32_t lines = (static_cast<uint32_t>(_bitsPerKey * n) + CacheLineBits - 1) /
+                   CacheLineBits;
+  uint32_t probes = static_cast<uint32_t>(_bitsPerKey * 0.69); // ln(2) ≈ 0.69
+
+  if (lines < 1) lines = 1;
+  if (probes < 1) probes = 1;
+  if (probes > MaxProbes) probes = MaxProbes;
+
+  // Expand capacity
+  const size_t initSize = dst->size();
+  dst->resize(initSize + lines * CacheLineBytes, 0);
+  // Push probes
+  dst->push_back(static_cast<char>(probes));
+  char* array = &(*dst)[initSize];
+
+  for (int i = 0; n > i; i++)
+  {
+    uint32_t h = blockedBloomHash(keys[i]);
+    char* line = const_cast<char*>(lineOf(array, lines, h));
+    for (uint32_t j = 0; probes > j; j++)
+    {
+      h *= GoldenRatio;
+      const uint32_t bitPos = h >> 23;
+      line[bitPos / 8] |= (1 << (bitPos % 8));
+    }
+  }
+
+  return static_cast<int>(dst->size() - initSize);
+}
+
+bool BlockedBloomPolicyFilter::keyMayMatch(const Slice& key, const Slice& filter) const
+{
+  if (key.empty() || filter.empty()) return false;
+
+  const uint32_t arrayBytes = static_cast<uint32_t>(filter.size() - 1);
+  const uint32_t probes = static_cast<uint8_t>(filter[arrayBytes]);
+  // Treat a filter this build can not read as a match
+  if (arrayBytes == 0 || arrayBytes % CacheLineBytes != 0 || probes > MaxProbes) {
+    return true;
+  }
+
+  const uint32_t h = blockedBloomHash(key);
+  return lineMayMatch(lineOf(filter.data(), arrayBytes / CacheLineBytes, h), h, probes);
+}
+
+void BlockedBloomPolicyFilter::keysMayMatch(const Slice* keys, int n, const Slice& filter,
+                                            bool* results) const
+{
+  const uint32_t arrayBytes = filter.empty() ? 0 : static_cast<uint32_t>(filter.size() - 1);
+  const uint32_t probes = filter.empty() ? 0 : static_cast<uint8_t>(filter[arrayBytes]);
+  if (arrayBytes == 0 || arrayBytes % CacheLineBytes != 0 || probes > MaxProbes) {
+    for (int i = 0; n > i; i++) {
+      results[i] = keyMayMatch(keys[i], filter);
+    }
+    return;
+  }
+
+  const uint32_t lines = arrayBytes / CacheLineBytes;
+  uint32_t hashes[BatchSize];
+  const char* linePtrs[BatchSize];
+  for (int start = 0; n > start; start += BatchSize)
+  {
+    const int count = n - start < BatchSize ? n - start : BatchSize;
+    for (int i = 0; count > i; i++)
+    {
+      hashes[i] = blockedBloomHash(keys[start + i]);
+      linePtrs[i] = lineOf(filter.data(), lines, hashes[i]);
+#ifdef __GNUC__
+      // The filter is not aligned, so a line may span two cache lines
+      __builtin_prefetch(linePtrs[i]);
+      __builtin_prefetch(linePtrs[i] + CacheLineBytes - 1);
+#endif
+    }
+    for (int i = 0; count > i; i++) {
+      results[start + i] = !keys[start + i].empty() &&
+                           lineMayMatch(linePtrs[i], hashes[i], probes);
+    }
+  }
+}
+
+FilterPolicy* blockedBloomPolicyFilter()
+{
+  static FilterPolicy* policy = new class BlockedBloomPolicyFilter(10);
+  return policy;
+}
+
+}
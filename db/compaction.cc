@@ -0,0 +1,109 @@
+#include "compaction.h"
+
+namespace yundb
+{
+
+// Stop building a single file in a level->level+1 compaction when it
+// overlaps this many bytes of level+2
+static int64_t maxGrandParentOverlapBytes(const Options* options)
+{ return 10 * static_cast<int64_t>(options->max_file_size); }
+
+Compaction::Cursor::Cursor()
+      : grandparentIndex(0),
+        seenKey(false),
+        overlappedBytes(0)
+{
+  for (int i = 0; MaxFileLevel > i; i++) {
+    levelPtrs[i] = 0;
+  }
+}
+
+Compaction::Compaction(const Options* options, int level)
+      : _compactionLevel(level),
+        _maxOutputFileSize(options->max_file_size),
+        _inputVersion(nullptr) {}
+
+Compaction::~Compaction()
+{
+  if (_inputVersion != nullptr) _inputVersion->unRef();
+}
+
+bool Compaction::isTrivialMove() const
+{
+  int64_t grandparentBytes = 0;
+  for (const auto& f : _grandparents) {
+    grandparentBytes += f->fileSize;
+  }
+
+  // Avoid a move if there is lots of overlapping grandparent data.
+  // Otherwise, the move could create a parent file that will require
+  // a very expensive merge later on.
+  return (numInputFiles(0) == 1 && numInputFiles(1) == 0 &&
+          grandparentBytes <= maxGrandParentOverlapBytes(&_inputVersion->_versionSet->_options));
+}
+
+void Compaction::addInputDeletions(VersionEdit* edit)
+{
+  for (int which = 0; 2 > which; which++)
+  {
+    for (const auto& f : _inputs[which]) {
+      edit->deleteFile(_compactionLevel + which, f->number);
+    }
+  }
+}
+
+bool Compaction::isBaseLevelForKey(const Slice& userKey, Cursor* cursor) const
+{
+  // Maybe use binary search to find right entry instead of linear search?
+  const Comparator* ucmp = _inputVersion->_versionSet->_comparator;
+  for (int level = _compactionLevel + 2; MaxFileLevel > level; level++)
+  {
+    const auto& files = _inputVersion->_files[level];
+    while (cursor->levelPtrs[level] < files.size())
+    {
+      const auto& f = files[cursor->levelPtrs[level]];
+      if (ucmp->cmp(userKey, f->largest->getUserKey()) <= 0) {
+        // We've advanced far enough
+        if (ucmp->cmp(userKey, f->smallest->getUserKey()) >= 0) {
+          // Key falls in this file's range, so definitely not base level
+          return false;
+        }
+        break;
+      }
+      cursor->levelPtrs[level]++;
+    }
+  }
+  return true;
+}
+
+bool Compaction::shouldStopBefore(const Slice& userKey, Cursor* cursor) const
+{
+  const Comparator* ucmp = _inputVersion->_versionSet->_comparator;
+  // Scan to find earliest grandparent file that contains key.
+  while (cursor->grandparentIndex < _grandparents.size() &&
+         ucmp->cmp(userKey, _grandparents[cursor->grandparentIndex]->largest->getUserKey()) > 0)
+  {
+    if (cursor->seenKey) {
+      cursor->overlappedBytes += _grandparents[cursor->grandparentIndex]->fileSize;
+    }
+    cursor->grandparentIndex++;
+  }
+  cursor->seenKey = true;
+
+  if (cursor->overlappedBytes > maxGrandParentOverlapBytes(&_inputVersion->_versionSet->_options)) {
+    // Too much overlap for current output; start new output
+    cursor->overlappedBytes = 0;
+    return true;
+  }
+  return false;
+}
+
+void Compaction::releaseInputs()
+{
+  if (_inputVersion != nullptr) {
+    _inputVersion->unRef();
+    _inputVersion = nullptr;
+  }
+}
+
+}
@@ -6,17 +6,92 @@
 namespace yundb
 {
 
+// A Compaction encapsulates information about a compaction,
+// the files of "level" and "level+1" are merged into "level+1"
 class Compaction
 {
  public:
-  Compaction(Version* v);
+  // Position of one merge in the key space of the compaction. Every
+  // thread that merges a key range of the compaction keeps its own,
+  // keys passed with the same cursor must be increasing.
+  struct Cursor
+  {
+    Cursor();
+
+    // Index in _grandparents
+    size_t grandparentIndex;
+    // Some output key has been seen
+    bool seenKey;
+    // Bytes of overlap between current output and grandparent files
+    int64_t overlappedBytes;
+
+    // levelPtrs holds indices into _inputVersion->_files: our state
+    // is that we are positioned at one of the file ranges for each
+    // higher level than the ones involved in this compaction (i.e. for
+    // all L >= _compactionLevel + 2).
+    size_t levelPtrs[MaxFileLevel];
+  };
+
   ~Compaction();
   Compaction(const Compaction& other) = delete;
   Compaction& operator=(const Compaction& other) = delete;
+
+  // Return the level that is being compacted.  Inputs from "level"
+  // and "level+1" will be merged to produce a set of "level+1" files.
+  int level() const { return _compactionLevel; }
+
+  // Return the object that holds the edits to the descriptor done
+  // by this compaction.
+  VersionEdit* edit() { return &_edit; }
+
+  // "which" must be either 0 or 1
+  int numInputFiles(int which) const { return static_cast<int>(_inputs[which].size()); }
+
+  // Return the ith input file at "level()+which" ("which" must be 0 or 1).
+  const std::shared_ptr<FileMeta>& input(int which, int i) const { return _inputs[which][i]; }
+
+  // Maximum size of files to build during this compaction.
+  uint64_t maxOutputFileSize() const { return _maxOutputFileSize; }
+
+  // Is this a trivial compaction that can be implemented by just
+  // moving a single input file to the next level (no merging or splitting)
+  bool isTrivialMove() const;
+
+  // Add all inputs to this compaction as delete operations to *edit.
+  void addInputDeletions(VersionEdit* edit);
+
+  // Returns true if the information we have available guarantees that
+  // the compaction is producing data in "level+1" for which no data exists
+  // in levels greater than "level+1".
+  bool isBaseLevelForKey(const Slice& userKey, Cursor* cursor) const;
+
+  // Returns true iff we should stop building the current output
+  // before processing the user key.
+  bool shouldStopBefore(const Slice& userKey, Cursor* cursor) const;
+
+  // Release the input version for the compaction, once the compaction
+  // is successful.
+  void releaseInputs();
+
  private:
+  friend class Version;
+  friend class VersionSet;
+
+  Compaction(const Options* options, int level);
+
   int _compactionLevel;
+  uint64_t _maxOutputFileSize;
+  Version* _inputVersion;
+  VersionEdit _edit;
+
+  // Each compaction reads inputs from "_compactionLevel" and "_compactionLevel+1"
+  std::vector<std::shared_ptr<FileMeta>> _inputs[2];
+
+  // State used to check for number of overlapping grandparent files
+  // (parent == _compactionLevel + 1, grandparent == _compactionLevel + 2)
+  std::vector<std::shared_ptr<FileMeta>> _grandparents;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif // YUNDB_DB_COMPACTION_H
@@ -0,0 +1,1566 @@
+#include "db_impl.h"
+
+#include "compaction.h"
+#include "db_iter.h"
+#include "log_reader.h"
+#include "merging_iterator.h"
+#include "sstable_builder.h"
+#include "version_set.h"
+#include "write_batch_internal.h"
+#include "util/cache.h"
+#include "util/coding.h"
+#include "util/error_print.h"
+#include "util/file_name.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace yundb
+{
+
+// A write waiting in the writer queue
+struct DBImpl::Writer
+{
+  explicit Writer(sync::Mutex* mu)
+        : batch(nullptr), sync(false), mem(nullptr), done(false), ok(false), cv(mu) {}
+
+  WriteBatch* batch;
+  bool sync;
+  // Set by the leader when this writer inserts its own batch into mem
+  MemTable* mem;
+  // Set by the leader which wrote this batch
+  bool done;
+  bool ok;
+  sync::CondVar cv;
+};
+
+// Information for a manual compaction
+struct DBImpl::ManualCompaction
+{
+  int level;
+  bool done;
+  // nullptr means beginning or end of key range
+  const Slice* begin;
+  const Slice* end;
+  // Where the next round of the compaction should start
+  std::string tmpStorage;
+  Slice tmpBegin;
+};
+
+// A user key range of the compaction merged by one thread
+struct DBImpl::Subcompaction
+{
+  // Files produced by compaction
+  struct Output
+  {
+    uint64_t number;
+    uint64_t fileSize;
+    std::string smallest;
+    std::string largest;
+  };
+
+  Subcompaction(DBImpl* db, CompactionState* compact,
+                const std::string* begin, const std::string* end)
+        : db(db), compact(compact), begin(begin), end(end), input(nullptr),
+          task(nullptr), success(true) {}
+
+  DBImpl* const db;
+  CompactionState* const compact;
+  // Range is [*begin, *end), nullptr means unbounded
+  const std::string* begin;
+  const std::string* end;
+  Iterator* input;
+  // Pending task on the low priority pool, guarded by _mutex. Reset by
+  // whichever thread claims the range first.
+  SubcompactionTask* task;
+  Compaction::Cursor cursor;
+  // Outputs in key order
+  std::vector<Output> outputs;
+  // Builds the last output, nullptr when no output is open
+  std::unique_ptr<SstableBuilder> builder;
+  bool success;
+};
+
+struct DBImpl::CompactionState
+{
+  CompactionState(Compaction* c, sync::Mutex* mu)
+        : compaction(c), smallestSnapshot(0), runningSubcompactions(0),
+          subcompactionsDone(mu) {}
+
+  Compaction* const compaction;
+  // Sequence numbers < smallestSnapshot are not significant since we
+  // will never have to service a snapshot below smallestSnapshot.
+  // Therefore if we have seen a sequence number S <= smallestSnapshot,
+  // we can drop all entries for the same key with sequence numbers < S.
+  SequenceNumber smallestSnapshot;
+  // Subcompactions cover disjoint ranges in key order
+  std::vector<std::string> boundaries;
+  std::vector<Subcompaction> subcompactions;
+  // Subcompactions running on other threads, guarded by _mutex
+  int runningSubcompactions;
+  sync::CondVar subcompactionsDone;
+};
+
+// Owned by the env queue, so a task that lost its range to the
+// compaction thread can still be popped safely after the
+// CompactionState is gone
+struct DBImpl::SubcompactionTask
+{
+  DBImpl* db;
+  // nullptr once the range has been claimed
+  Subcompaction* sub;
+};
+
+// Arena blocks follow the write buffer, so a full memtable takes a
+// few large blocks instead of many small ones
+static std::shared_ptr<Arena> newArena(const Options& options)
+{
+  size_t blockSize = options.arena_block_size;
+  if (blockSize == 0) blockSize = options.write_buffer_size / 8;
+  return std::make_shared<Arena>(blockSize, options.arena_huge_page);
+}
+
+Snapshot::~Snapshot() = default;
+
+DB::~DB() = default;
+
+DBImpl::DBImpl(const Options& options, const std::string& dbname)
+      : _options(options),
+        _dbname(dbname),
+        _tableCache(std::make_shared<TableCache>(
+          dbname, options,
+          std::make_shared<Cache>(options.max_cache_size, options.cache_shard_bits),
+          std::make_shared<Cache>(options.block_cache_size, options.cache_shard_bits))),
+        _dbLock(nullptr),
+        _shuttingDown(false),
+        _backgroundWorkFinishedSignal(&_mutex),
+        _mem(std::make_shared<MemTable>(newArena(options), options)),
+        _logFileNumber(0),
+        _firstOwnLogNumber(0),
+        _runningMemTableWriters(0),
+        _backgroundFlushScheduled(false),
+        _backgroundCompactionScheduled(false),
+        _scheduledSubcompactionTasks(0),
+        _manifestWriting(false),
+        _manifestWriteSignal(&_mutex),
+        _manualCompaction(nullptr),
+        _versions(new VersionSet(dbname, options, _tableCache)),
+        _bgError(false) {}
+
+DBImpl::~DBImpl()
+{
+  // Wait for background work to finish
+  _mutex.Lock();
+  _shuttingDown.store(true, std::memory_order_release);
+  while (_backgroundFlushScheduled || _backgroundCompactionScheduled ||
+         _scheduledSubcompactionTasks > 0)
+  {
+    _backgroundWorkFinishedSignal.wait();
+  }
+  _mutex.unlock();
+
+  _versions.reset();
+  _log.reset();
+  if (_dbLock != nullptr) _options.env->unlockFile(_dbLock);
+}
+
+bool DB::Open(const Options& options, const std::string& name, DB** dbptr)
+{
+  *dbptr = nullptr;
+
+  // Give every subcompaction range a compaction thread
+  Env* env = options.env;
+  if (env->getBackgroundThreads(Env::LowPriority) < options.max_subcompactions) {
+    env->setBackgroundThreads(options.max_subcompactions, Env::LowPriority);
+  }
+
+  DBImpl* impl = new DBImpl(options, name);
+  impl->_mutex.Lock();
+  bool success = impl->recover();
+  if (success) {
+    impl->deleteObsoleteFiles();
+    impl->maybeScheduleFlushOrCompaction();
+  }
+  impl->_mutex.unlock();
+
+  if (!success) {
+    delete impl;
+    return false;
+  }
+
+  *dbptr = impl;
+  return true;
+}
+
+bool DBImpl::newDB()
+{
+  VersionEdit newDb;
+  newDb.setComparatorName(_options.comparator->name());
+  newDb.setLogNumber(0);
+  newDb.setNextFileNumber(2);
+  newDb.setLastSequence(0);
+
+  const std::string manifest = generateDescriptorFileName(1, _dbname);
+  WritableFile* file = nullptr;
+  _options.env->newWritableFile(manifest, &file);
+  if (file == nullptr) {
+    printError("DBImpl: create manifest ", manifest, " error");
+    return false;
+  }
+
+  {
+    // The writer owns file
+    log::Writer log(file);
+    std::string record;
+    newDb.encode(&record);
+    log.appendRecord(record);
+    log.sync();
+  }
+
+  if (!setCurrentFile(_options.env, _dbname, 1)) {
+    _options.env->removeFile(manifest);
+    return false;
+  }
+  return true;
+}
+
+bool DBImpl::recover()
+{
+  Env* env = _options.env;
+  if (!env->fileExists(_dbname)) env->createDir(_dbname);
+
+  if (!env->lockFile(generateLockFileName(_dbname), &_dbLock)) {
+    return false;
+  }
+
+  if (!env->fileExists(currentFileName(_dbname))) {
+    if (!_options.create_if_missing) {
+      printError("DBImpl: ", _dbname, " does not exist");
+      return false;
+    }
+    if (!newDB()) return false;
+  } else if (_options.error_if_exists) {
+    printError("DBImpl: ", _dbname, " exists");
+    return false;
+  }
+
+  if (!_versions->resume()) return false;
+
+  std::vector<std::string> children;
+  if (!env->getChildren(_dbname, &children)) {
+    printError("DBImpl: list ", _dbname, " error");
+    return false;
+  }
+
+  // Logs older than the log number of the current version are
+  // already in tables
+  const uint64_t minLog = _versions->getLogNumber();
+  const uint64_t prevLog = _versions->getPreLogNumber();
+  std::vector<uint64_t> logs;
+  for (const auto& child : children)
+  {
+    uint64_t number;
+    FileType type;
+    if (parseFileName(child, &number, &type) && type == LogFile &&
+        (number >= minLog || number == prevLog)) {
+      logs.push_back(number);
+    }
+  }
+
+  // Replay in the order the logs were written
+  std::sort(logs.begin(), logs.end());
+  VersionEdit edit;
+  SequenceNumber maxSequence = 0;
+  for (uint64_t number : logs)
+  {
+    if (!replayLogFile(number, &edit, &maxSequence)) return false;
+    // The previous incarnation may not have written any MANIFEST
+    // records after allocating this log number
+    _versions->markFileNumberUsed(number);
+  }
+
+  if (_versions->getLastSequence() < maxSequence) {
+    _versions->setLastSequence(maxSequence);
+  }
+
+  _logFileNumber = _versions->getNewFileNumber();
+  _firstOwnLogNumber = _logFileNumber;
+  WritableFile* logFile = newLogFile(_logFileNumber);
+  if (logFile == nullptr) return false;
+  _log.reset(new log::Writer(logFile, _logFileNumber, _options.recycle_log_file_num > 0));
+
+  // The replayed logs are no longer needed once the edit is applied
+  edit.setPreLogNumber(0);
+  edit.setLogNumber(_logFileNumber);
+  return logAndApply(&edit);
+}
+
+WritableFile* DBImpl::newLogFile(uint64_t number)
+{
+  const std::string fileName = generateLogFileName(number, _dbname);
+  WritableFile* file = nullptr;
+  if (!_logsToRecycle.empty())
+  {
+    const uint64_t oldNumber = _logsToRecycle.front();
+    _logsToRecycle.pop_front();
+    _options.env->reuseWritableFile(generateLogFileName(oldNumber, _dbname), fileName, &file);
+  }
+  else
+  {
+    _options.env->newWritableFile(fileName, &file);
+  }
+  if (file == nullptr) {
+    printError("DBImpl: create log file ", number, " error");
+    return nullptr;
+  }
+
+  size_t preallocateSize = _options.log_preallocate_size;
+  if (preallocateSize == 0) {
+    preallocateSize = _options.write_buffer_size + _options.write_buffer_size / 10;
+  }
+  file->preallocate(preallocateSize);
+  return file;
+}
+
+bool DBImpl::replayLogFile(uint64_t number, VersionEdit* edit, SequenceNumber* maxSequence)
+{
+  SequentialFile* file = nullptr;
+  _options.env->newSequentialFile(generateLogFileName(number, _dbname), &file);
+  if (file == nullptr) {
+    printError("DBImpl: open log file ", number, " error");
+    return false;
+  }
+
+  log::Reader reader(file, 0, true, number);
+  std::string scratch;
+  Slice record;
+  WriteBatch batch;
+  std::shared_ptr<MemTable> mem;
+
+  while (reader.readRecord(&record, &scratch))
+  {
+    // The record passed its checksum, so the log is corrupt. Applying the
+    // later records without it would lose a write in the middle
+    if (!WriteBatchInternal::setContents(&batch, record)) {
+      printError("DBImpl: log file ", number, " has a broken record");
+      return false;
+    }
+
+    if (mem == nullptr) {
+      mem = std::make_shared<MemTable>(newArena(_options), _options);
+    }
+    SequenceNumber next = WriteBatchInternal::insertInto(&batch, mem.get());
+    if (next - 1 > *maxSequence) *maxSequence = next - 1;
+
+    if (mem->getMemoryUsage() > _options.write_buffer_size) {
+      std::unique_ptr<Iterator> iter(mem->newIterator());
+      if (!writeLevel0Table(iter.get(), edit, nullptr)) return false;
+      mem.reset();
+    }
+  }
+
+  if (mem != nullptr) {
+    std::unique_ptr<Iterator> iter(mem->newIterator());
+    return writeLevel0Table(iter.get(), edit, nullptr);
+  }
+  return true;
+}
+
+bool DBImpl::Put(const WriteOptions& options, const Slice& key, const Slice& value)
+{
+  WriteBatch batch;
+  batch.insert(key, value);
+  return Write(options, &batch);
+}
+
+bool DBImpl::Delete(const WriteOptions& options, const Slice& key)
+{
+  WriteBatch batch;
+  batch.remove(key);
+  return Write(options, &batch);
+}
+
+bool DBImpl::Write(const WriteOptions& options, WriteBatch* updates)
+{
+  if (updates == nullptr) {
+    printError("DBImpl: None batch ptr");
+    return false;
+  }
+  return doWrite(options, updates);
+}
+
+// Writers queue up in _writers. The writer at the front is the leader:
+// it merges the batches queued behind it, writes them with one log
+// record and at most one sync, inserts them into the memtable and then
+// wakes up the followers it wrote for.
+bool DBImpl::doWrite(const WriteOptions& options, WriteBatch* updates)
+{
+  Writer w(&_mutex);
+  w.batch = updates;
+  w.sync = options.sync;
+
+  _mutex.Lock();
+  _writers.push_back(&w);
+  while (!w.done && w.mem == nullptr && &w != _writers.front())
+  {
+    w.cv.wait();
+  }
+
+  if (w.mem != nullptr)
+  {
+    // The leader has logged the group, insert the batch next to the
+    // other writers of the group
+    _mutex.unlock();
+    WriteBatchInternal::insertInto(w.batch, w.mem, true);
+    _mutex.Lock();
+    w.mem = nullptr;
+    if (--_runningMemTableWriters == 0) _writers.front()->cv.signal();
+    while (!w.done)
+    {
+      w.cv.wait();
+    }
+  }
+
+  if (w.done) {
+    _mutex.unlock();
+    return w.ok;
+  }
+
+  // A null batch only asks for a memtable switch
+  bool success = makeRoomForWrite(updates == nullptr);
+  Writer* lastWriter = &w;
+  if (success && updates != nullptr)
+  {
+    WriteBatch* group = buildBatchGroup(&lastWriter);
+    SequenceNumber lastSequence = _versions->getLastSequence();
+    WriteBatchInternal::setSequence(group, lastSequence + 1);
+    lastSequence += WriteBatchInternal::count(group);
+    const bool parallel = _options.allow_concurrent_memtable_write && group != w.batch;
+
+    // Other writers only queue up behind w while it is the leader,
+    // so the log and memtable are written without holding _mutex
+    MemTable* mem = _mem.get();
+    _mutex.unlock();
+    _log->appendRecord(WriteBatchInternal::contents(group));
+    if (w.sync) _log->sync();
+    if (!parallel) WriteBatchInternal::insertInto(group, mem);
+    _mutex.Lock();
+
+    if (parallel)
+    {
+      // Every writer of the group inserts its batch at its place in group
+      SequenceNumber seq = WriteBatchInternal::sequence(group);
+      for (Writer* writer : _writers)
+      {
+        WriteBatchInternal::setSequence(writer->batch, seq);
+        seq += WriteBatchInternal::count(writer->batch);
+        if (writer != &w) {
+          writer->mem = mem;
+          _runningMemTableWriters++;
+          writer->cv.signal();
+        }
+        if (writer == lastWriter) break;
+      }
+
+      _mutex.unlock();
+      WriteBatchInternal::insertInto(w.batch, mem, true);
+      _mutex.Lock();
+      while (_runningMemTableWriters > 0)
+      {
+        w.cv.wait();
+      }
+    }
+
+    _versions->setLastSequence(lastSequence);
+    if (group == &_tmpBatch) _tmpBatch.clear();
+  }
+
+  while (true)
+  {
+    Writer* ready = _writers.front();
+    _writers.pop_front();
+    if (ready != &w) {
+      ready->ok = success;
+      ready->done = true;
+      ready->cv.signal();
+    }
+    if (ready == lastWriter) break;
+  }
+
+  // Notify new head of write queue
+  if (!_writers.empty()) _writers.front()->cv.signal();
+
+  _mutex.unlock();
+  return success;
+}
+
+WriteBatch* DBImpl::buildBatchGroup(Writer** lastWriter)
+{
+  Writer* first = _writers.front();
+  WriteBatch* result = first->batch;
+
+  size_t size = WriteBatchInternal::byteSize(first->batch);
+  // Allow the group to grow up to a maximum size, but if the
+  // original write is small, limit the growth so we do not slow
+  // down the small write too much.
+  size_t maxSize = 1 << 20;
+  if (size <= (128 << 10)) {
+    maxSize = size + (128 << 10);
+  }
+
+  *lastWriter = first;
+  for (auto iter = _writers.begin() + 1; iter != _writers.end(); ++iter)
+  {
+    Writer* w = *iter;
+    // Do not include a sync write into a batch handled by a non-sync write.
+    if (w->sync && !first->sync) break;
+
+    // A memtable switch request is handled by its own leader
+    if (w->batch == nullptr) break;
+
+    size += WriteBatchInternal::byteSize(w->batch);
+    if (size > maxSize) break;
+
+    // Append to _tmpBatch instead of the caller's batch
+    if (result == first->batch) {
+      result = &_tmpBatch;
+      result->append(*first->batch);
+    }
+    result->append(*w->batch);
+    *lastWriter = w;
+  }
+
+  return result;
+}
+
+bool DBImpl::makeRoomForWrite(bool force)
+{
+  bool allowDelay = !force;
+  while (true)
+  {
+    if (_bgError) {
+      return false;
+    } else if (allowDelay && _versions->levelTablesNumber(0) >= L0SlowdownWritesTrigger) {
+      // We are getting close to hitting a hard limit on the number of
+      // L0 files.  Rather than delaying a single write by several
+      // seconds when we hit the hard limit, start delaying each
+      // individual write by 1ms to reduce latency variance.  Also,
+      // this delay hands over some CPU to the compaction thread in
+      // case it is sharing the same core as the writer.
+      _mutex.unlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      // Do not delay a single write more than once
+      allowDelay = false;
+      _mutex.Lock();
+    } else if (!force && _mem->getMemoryUsage() <= _options.write_buffer_size) {
+      // There is room in current memtable
+      break;
+    } else if (static_cast<int>(_imms.size()) + 1 >=
+               std::max(_options.max_write_buffer_number, 2)) {
+      // We have filled up the current memtable, but every other write
+      // buffer is still being flushed, so we wait.
+      _backgroundWorkFinishedSignal.wait();
+    } else if (_versions->levelTablesNumber(0) >= L0StopWritesTrigger) {
+      // There are too many level-0 files.
+      _backgroundWorkFinishedSignal.wait();
+    } else {
+      // Attempt to switch to a new memtable and trigger compaction of old
+      uint64_t newLogNumber = _versions->getNewFileNumber();
+      WritableFile* logFile = newLogFile(newLogNumber);
+      if (logFile == nullptr) {
+        _versions->reuseFileNumber(newLogNumber);
+        return false;
+      }
+
+      _imms.push_back(ImmutableMemTable{_mem, _logFileNumber});
+      _log.reset(new log::Writer(logFile, newLogNumber, _options.recycle_log_file_num > 0));
+      _logFileNumber = newLogNumber;
+      _mem = std::make_shared<MemTable>(newArena(_options), _options);
+      // Do not force another compaction if have room
+      force = false;
+      maybeScheduleFlushOrCompaction();
+    }
+  }
+  return true;
+}
+
+// Build a table from the entries of iter. *meta gets the key range and
+// the file size, fileSize is left 0 when the table can not be written
+static void buildTable(const std::string& dbname, const Options& options,
+                       Iterator* iter, FileMeta* meta)
+{
+  meta->fileSize = 0;
+  iter->seekToFirst();
+  if (!iter->valid()) return;
+
+  const std::string fileName = generateTableFileName(meta->number, dbname);
+  WritableFile* file = nullptr;
+  if (options.use_direct_io_for_flush_and_compaction) {
+    options.env->newDirectWritableFile(fileName, &file);
+  } else {
+    options.env->newWritableFile(fileName, &file);
+  }
+  if (file == nullptr) {
+    printError("DBImpl: create table ", fileName, " error");
+    return;
+  }
+
+  {
+    // The builder owns file and closes it when done
+    SstableBuilder builder(options, file);
+    meta->smallest->setKey(iter->key());
+    for (; iter->valid(); iter->next())
+    {
+      meta->largest->setKey(iter->key());
+      builder.add(iter->key(), iter->value());
+    }
+    builder.finish();
+  }
+
+  uint64_t fileSize = 0;
+  if (!options.env->getFileSize(fileName, &fileSize) || fileSize == 0) {
+    printError("DBImpl: table ", fileName, " is empty");
+    options.env->removeFile(fileName);
+    return;
+  }
+  meta->fileSize = fileSize;
+}
+
+bool DBImpl::writeLevel0Table(Iterator* iter, VersionEdit* edit, Version* base)
+{
+  iter->seekToFirst();
+  if (!iter->valid()) return true;
+
+  FileMeta meta;
+  meta.number = _versions->getNewFileNumber();
+  _pendingOutputs.insert(meta.number);
+
+  _mutex.unlock();
+  buildTable(_dbname, _options, iter, &meta);
+  _mutex.Lock();
+
+  if (meta.fileSize == 0) {
+    _pendingOutputs.erase(meta.number);
+    return false;
+  }
+
+  // Note that if fileSize is zero, the file has been deleted and
+  // should not be added to the manifest.
+  int level = 0;
+  if (base != nullptr) {
+    level = base->pickLevelForMemTableOutput(meta.smallest->getUserKey(),
+                                             meta.largest->getUserKey());
+  }
+  edit->addFile(level, meta.number, meta.fileSize,
+                meta.smallest->internalKey, meta.largest->internalKey);
+  return true;
+}
+
+void DBImpl::compactMemTable()
+{
+  // Everything that is full now goes into one table, newer memtables
+  // keep their logs until the next flush
+  const size_t flushNum = _imms.size();
+  // The memtables are merged while the table is written. The list keeps
+  // them alive, only this flush removes them.
+  std::vector<Iterator*> children;
+  for (const auto& imm : _imms) {
+    children.push_back(imm.mem->newIterator());
+  }
+  std::unique_ptr<Iterator> iter(newMergingIterator(
+    _options.comparator, children.data(), static_cast<int>(children.size())));
+
+  // Save the contents of the memtables as a new Table
+  VersionEdit edit;
+  bool success = writeLevel0Table(iter.get(), &edit, nullptr);
+  iter.reset();
+
+  if (success && _shuttingDown.load(std::memory_order_acquire)) {
+    // Leave the memtables in their logs, they are replayed by the next open
+    return;
+  }
+
+  // Replace immutable memtables with the generated Table
+  if (success) {
+    // Earlier logs no longer needed
+    edit.setPreLogNumber(0);
+    edit.setLogNumber((_imms.size() > flushNum) ? _imms[flushNum].logNumber
+                                                : _logFileNumber);
+    success = logAndApply(&edit);
+  }
+
+  if (success) {
+    _imms.erase(_imms.begin(), _imms.begin() + flushNum);
+    deleteObsoleteFiles();
+  } else {
+    _bgError = true;
+  }
+}
+
+void DBImpl::deleteObsoleteFiles()
+{
+  if (_bgError) {
+    // After a background error, we don't know whether a new version may
+    // or may not have been committed, so we cannot safely garbage collect.
+    return;
+  }
+
+  // Make a set of all of the live files
+  std::set<uint64_t> live = _pendingOutputs;
+  _versions->addLiveFiles(live);
+
+  std::vector<std::string> children;
+  // Ignoring errors on purpose
+  _options.env->getChildren(_dbname, &children);
+  std::vector<std::string> filesToDelete;
+  for (const auto& child : children)
+  {
+    uint64_t number;
+    FileType type;
+    if (!parseFileName(child, &number, &type)) continue;
+    // Another background thread is already deleting it
+    if (_deletingFiles.count(child) != 0) continue;
+
+    bool keep = true;
+    switch (type)
+    {
+      case LogFile:
+        keep = ((number >= _versions->getLogNumber()) ||
+                (number == _versions->getPreLogNumber()));
+        // Keep retired logs of this instance around to be reused
+        if (!keep && number >= _firstOwnLogNumber)
+        {
+          if (std::find(_logsToRecycle.begin(), _logsToRecycle.end(), number) !=
+              _logsToRecycle.end()) {
+            keep = true;
+          } else if (_logsToRecycle.size() < _options.recycle_log_file_num) {
+            _logsToRecycle.push_back(number);
+            keep = true;
+          }
+        }
+        break;
+      case DescriptorFile:
+        // Keep my manifest file, and any newer incarnations'
+        // (in case there is a race that allows other incarnations)
+        keep = (number >= _versions->getManifestFileNumber());
+        break;
+      case TableFile:
+        keep = (live.find(number) != live.end());
+        break;
+      case TempFile:
+        // Any temp files that are currently being written to must
+        // be recorded in _pendingOutputs, which is inserted into "live"
+        keep = (live.find(number) != live.end());
+        break;
+      case CurrentFile:
+      case LockFile:
+      case InfoLogFile:
+        keep = true;
+        break;
+    }
+
+    if (!keep) {
+      filesToDelete.push_back(child);
+      _deletingFiles.insert(child);
+      if (type == TableFile) _tableCache->evict(number);
+    }
+  }
+
+  // While deleting all files unblock other threads. All files being deleted
+  // have unique names which will not collide with newly created files and
+  // are therefore safe to delete while allowing other threads to proceed.
+  _mutex.unlock();
+  for (const auto& fileName : filesToDelete) {
+    _options.env->removeFile(_dbname + "/" + fileName);
+  }
+  _mutex.Lock();
+  for (const auto& fileName : filesToDelete) {
+    _deletingFiles.erase(fileName);
+  }
+}
+
+bool DBImpl::logAndApply(VersionEdit* edit)
+{
+  while (_manifestWriting)
+  {
+    _manifestWriteSignal.wait();
+  }
+  _manifestWriting = true;
+  bool success = _versions->logAndApply(*edit, &_mutex);
+  // Tables of edit are live or obsolete from now on
+  for (const auto& f : edit->newFiles()) {
+    _pendingOutputs.erase(f.second->number);
+  }
+  _manifestWriting = false;
+  _manifestWriteSignal.signalAll();
+  return success;
+}
+
+void DBImpl::maybeScheduleFlushOrCompaction()
+{
+  if (_shuttingDown.load(std::memory_order_acquire)) {
+    // DB is being deleted; no more background work
+    return;
+  }
+  if (_bgError) {
+    // Already got an error; no more changes
+    return;
+  }
+
+  if (!_imms.empty() && !_backgroundFlushScheduled) {
+    _backgroundFlushScheduled = true;
+    _options.env->schedule(&DBImpl::bgFlush, this, Env::HighPriority);
+  }
+  if (!_backgroundCompactionScheduled &&
+      (_manualCompaction != nullptr || _versions->needsCompaction())) {
+    _backgroundCompactionScheduled = true;
+    _options.env->schedule(&DBImpl::bgCompaction, this, Env::LowPriority);
+  }
+}
+
+void DBImpl::bgFlush(void* db)
+{
+  static_cast<DBImpl*>(db)->backgroundFlushCall();
+}
+
+void DBImpl::bgCompaction(void* db)
+{
+  static_cast<DBImpl*>(db)->backgroundCompactionCall();
+}
+
+void DBImpl::backgroundFlushCall()
+{
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  if (!_shuttingDown.load(std::memory_order_acquire) && !_bgError && !_imms.empty()) {
+    compactMemTable();
+  }
+
+  _backgroundFlushScheduled = false;
+
+  // The new level-0 table may call for a compaction
+  maybeScheduleFlushOrCompaction();
+  // Wake up makeRoomForWrite() and flushMemTable()
+  _backgroundWorkFinishedSignal.signalAll();
+}
+
+void DBImpl::backgroundCompactionCall()
+{
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  if (!_shuttingDown.load(std::memory_order_acquire) && !_bgError) {
+    backgroundCompaction();
+  }
+
+  _backgroundCompactionScheduled = false;
+
+  // Previous compaction may have produced too many files in a level,
+  // so reschedule another compaction if needed.
+  maybeScheduleFlushOrCompaction();
+  _backgroundWorkFinishedSignal.signalAll();
+}
+
+void DBImpl::backgroundCompaction()
+{
+  Compaction* c = nullptr;
+  const bool isManual = (_manualCompaction != nullptr);
+  std::string manualEnd;
+  if (isManual)
+  {
+    ManualCompaction* m = _manualCompaction;
+    c = _versions->compactRange(m->level, m->begin, m->end);
+    m->done = (c == nullptr);
+    if (c != nullptr) {
+      // The range may be cut short, continue after the last input
+      const auto& last = c->input(0, c->numInputFiles(0) - 1);
+      manualEnd = last->largest->getUserKey().toString();
+    }
+  } else {
+    c = _versions->pickCompaction();
+  }
+
+  bool success = true;
+  if (c == nullptr) {
+    // Nothing to do
+  } else if (!isManual && c->isTrivialMove()) {
+    // Move file to next level
+    const auto f = c->input(0, 0);
+    c->edit()->deleteFile(c->level(), f->number);
+    c->edit()->addFile(c->level() + 1, f->number, f->fileSize,
+                       f->smallest->internalKey, f->largest->internalKey);
+    success = logAndApply(c->edit());
+    if (!success) _bgError = true;
+  } else {
+    CompactionState* compact = new CompactionState(c, &_mutex);
+    success = doCompactionWork(compact);
+    // A compaction cut short by shutdown is simply redone by the next open
+    if (!success && !_shuttingDown.load(std::memory_order_acquire)) _bgError = true;
+    cleanupCompaction(compact);
+    c->releaseInputs();
+    deleteObsoleteFiles();
+  }
+  delete c;
+
+  if (isManual)
+  {
+    ManualCompaction* m = _manualCompaction;
+    if (!success) {
+      m->done = true;
+    }
+    if (!m->done) {
+      // We only compacted part of the requested range.  Update *m
+      // to the range that is left to be compacted.
+      m->tmpStorage = manualEnd;
+      m->tmpBegin = Slice(m->tmpStorage);
+      m->begin = &m->tmpBegin;
+    }
+    _manualCompaction = nullptr;
+  }
+}
+
+void DBImpl::cleanupCompaction(CompactionState* compact)
+{
+  for (const auto& sub : compact->subcompactions)
+  {
+    for (const auto& out : sub.outputs) {
+      _pendingOutputs.erase(out.number);
+    }
+  }
+  delete compact;
+}
+
+bool DBImpl::finishCompactionOutput(Subcompaction* sub)
+{
+  Subcompaction::Output& out = sub->outputs.back();
+  sub->builder->finish();
+  out.fileSize = sub->builder->fileSize();
+  // Closes the file
+  sub->builder.reset();
+  return out.fileSize != 0;
+}
+
+bool DBImpl::installCompactionResults(CompactionState* compact)
+{
+  // Add compaction outputs
+  compact->compaction->addInputDeletions(compact->compaction->edit());
+  const int level = compact->compaction->level();
+  for (const auto& sub : compact->subcompactions)
+  {
+    for (const auto& out : sub.outputs) {
+      compact->compaction->edit()->addFile(level + 1, out.number, out.fileSize,
+                                           out.smallest, out.largest);
+    }
+  }
+  return logAndApply(compact->compaction->edit());
+}
+
+void DBImpl::subcompactionEntry(void* arg)
+{
+  auto task = static_cast<SubcompactionTask*>(arg);
+  DBImpl* db = task->db;
+  sync::LockGuard<sync::Mutex> lock(db->_mutex);
+  Subcompaction* sub = task->sub;
+  if (sub != nullptr)
+  {
+    sub->task = nullptr;
+    db->_mutex.unlock();
+    db->processSubcompaction(sub);
+    db->_mutex.Lock();
+    sub->compact->runningSubcompactions--;
+    sub->compact->subcompactionsDone.signal();
+  }
+  delete task;
+  db->_scheduledSubcompactionTasks--;
+  db->_backgroundWorkFinishedSignal.signalAll();
+}
+
+// The input iterator yields the entries of a user key from the oldest
+// to the newest, so every user key is gathered first and then filtered
+// from the newest entry down. Output tables are cut between user keys,
+// which keeps the files of a level disjoint by user key.
+void DBImpl::processSubcompaction(Subcompaction* sub)
+{
+  CompactionState* compact = sub->compact;
+  Compaction* c = compact->compaction;
+  const Comparator* ucmp = _options.comparator;
+  struct Entry
+  {
+    SequenceNumber seq;
+    ValueType type;
+    std::string value;
+    bool drop;
+  };
+  std::string internalKey;
+  std::string currentUserKey;
+  std::vector<Entry> entries;
+
+  // Add the entries of currentUserKey that are still visible to the output
+  auto flushUserKey = [&]() -> bool {
+    if (entries.empty()) return true;
+
+    if (sub->builder != nullptr && c->shouldStopBefore(currentUserKey, &sub->cursor)) {
+      if (!finishCompactionOutput(sub)) return false;
+    }
+
+    SequenceNumber lastSequenceForKey = MaxSequenceNumber;
+    for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+    {
+      bool drop = false;
+      if (lastSequenceForKey <= compact->smallestSnapshot) {
+        // Hidden by an newer entry for same user key
+        drop = true;
+      } else if (entry->type == TypeDeletion &&
+                 entry->seq <= compact->smallestSnapshot &&
+                 c->isBaseLevelForKey(currentUserKey, &sub->cursor)) {
+        // For this user key:
+        // (1) there is no data in higher levels
+        // (2) data in lower levels will have larger sequence numbers
+        // (3) data in layers that are being compacted here and have
+        //     smaller sequence numbers will be dropped in the next
+        //     few iterations of this loop (by rule (A) above).
+        // Therefore this deletion marker is obsolete and can be dropped.
+        drop = true;
+      }
+      lastSequenceForKey = entry->seq;
+      entry->drop = drop;
+    }
+
+    // Tables hold the entries of a user key from the oldest
+    for (const auto& entry : entries)
+    {
+      if (entry.drop) continue;
+
+      if (sub->builder == nullptr)
+      {
+        // Open a new output
+        _mutex.Lock();
+        Subcompaction::Output out;
+        out.number = _versions->getNewFileNumber();
+        out.fileSize = 0;
+        _pendingOutputs.insert(out.number);
+        sub->outputs.push_back(out);
+        _mutex.unlock();
+
+        const std::string fileName = generateTableFileName(out.number, _dbname);
+        WritableFile* file = nullptr;
+        if (_options.use_direct_io_for_flush_and_compaction) {
+          _options.env->newDirectWritableFile(fileName, &file);
+        } else {
+          _options.env->newWritableFile(fileName, &file);
+        }
+        if (file == nullptr) {
+          printError("DBImpl: create table ", fileName, " error");
+          return false;
+        }
+        sub->builder.reset(new SstableBuilder(_options, file));
+      }
+
+      internalKey = currentUserKey;
+      PutFixed64(&internalKey, packSeqAndType(entry.seq, entry.type));
+      Subcompaction::Output& out = sub->outputs.back();
+      if (sub->builder->numEntries() == 0) out.smallest = internalKey;
+      out.largest = internalKey;
+      sub->builder->add(internalKey, entry.value);
+    }
+    entries.clear();
+
+    // Close output file if it is big enough
+    if (sub->builder != nullptr && sub->builder->fileSize() >= c->maxOutputFileSize()) {
+      return finishCompactionOutput(sub);
+    }
+    return true;
+  };
+
+  Iterator* input = sub->input;
+  if (sub->begin != nullptr) {
+    // The oldest entry of a user key is its smallest internal key
+    std::string seekKey = *sub->begin;
+    PutFixed64(&seekKey, packSeqAndType(0, TypeDeletion));
+    input->seek(seekKey);
+  } else {
+    input->seekToFirst();
+  }
+
+  bool success = true;
+  for (; input->valid() && success; input->next())
+  {
+    if (_shuttingDown.load(std::memory_order_acquire)) {
+      success = false;
+      break;
+    }
+
+    Slice key = input->key();
+    if (key.size() < KeyTagSize) {
+      printError("DBImpl: compaction input has a broken key");
+      success = false;
+      break;
+    }
+    Slice userKey(key.data(), key.size() - KeyTagSize);
+    if (sub->end != nullptr && ucmp->cmp(userKey, *sub->end) >= 0) break;
+
+    if (entries.empty() || ucmp->cmp(userKey, currentUserKey) != 0) {
+      success = flushUserKey();
+      currentUserKey.assign(userKey.data(), userKey.size());
+    }
+
+    Entry entry;
+    entry.drop = false;
+    decodeSeqAndType(key.data() + userKey.size(), &entry.seq, &entry.type);
+    entry.value.assign(input->value().data(), input->value().size());
+    entries.push_back(std::move(entry));
+  }
+  // An input that failed to read ends like one that is used up,
+  // writing the outputs then would drop the rest of its entries
+  if (success && !input->status()) {
+    printError("DBImpl: compaction input read error");
+    success = false;
+  }
+
+  if (success) success = flushUserKey();
+  if (success && sub->builder != nullptr) success = finishCompactionOutput(sub);
+  if (sub->builder != nullptr) {
+    // The file is not live, so it is deleted with the obsolete files
+    sub->builder->abandon();
+    sub->builder.reset();
+  }
+  sub->success = success;
+}
+
+bool DBImpl::doCompactionWork(CompactionState* compact)
+{
+  Compaction* c = compact->compaction;
+  if (_snapshots.empty()) {
+    compact->smallestSnapshot = _versions->getLastSequence();
+  } else {
+    compact->smallestSnapshot = _snapshots.oldest();
+  }
+
+  // Release mutex while we're actually doing the compaction work
+  _mutex.unlock();
+
+  _versions->splitCompaction(c, _options.max_subcompactions, &compact->boundaries);
+  const auto& boundaries = compact->boundaries;
+  compact->subcompactions.reserve(boundaries.size() + 1);
+  for (size_t i = 0; boundaries.size() >= i; i++)
+  {
+    const std::string* begin = (i == 0) ? nullptr : &boundaries[i - 1];
+    const std::string* end = (i == boundaries.size()) ? nullptr : &boundaries[i];
+    compact->subcompactions.emplace_back(this, compact, begin, end);
+    compact->subcompactions.back().input = _versions->makeInputIterator(c);
+  }
+
+  // Every range but the first is offered to the low priority pool, the
+  // first one runs here. Ranges no idle pool thread has picked up by
+  // then are run here too, so a busy pool only costs parallelism.
+  _mutex.Lock();
+  for (size_t i = 1; compact->subcompactions.size() > i; i++)
+  {
+    Subcompaction* sub = &compact->subcompactions[i];
+    sub->task = new SubcompactionTask{this, sub};
+    _scheduledSubcompactionTasks++;
+    compact->runningSubcompactions++;
+    _options.env->schedule(&DBImpl::subcompactionEntry, sub->task, Env::LowPriority);
+  }
+  _mutex.unlock();
+
+  processSubcompaction(&compact->subcompactions[0]);
+  for (size_t i = 1; compact->subcompactions.size() > i; i++)
+  {
+    Subcompaction* sub = &compact->subcompactions[i];
+    _mutex.Lock();
+    const bool claimed = (sub->task != nullptr);
+    if (claimed) {
+      sub->task->sub = nullptr;
+      sub->task = nullptr;
+      compact->runningSubcompactions--;
+    }
+    _mutex.unlock();
+    if (claimed) processSubcompaction(sub);
+  }
+
+  _mutex.Lock();
+  while (compact->runningSubcompactions > 0)
+  {
+    compact->subcompactionsDone.wait();
+  }
+
+  bool success = true;
+  for (auto& sub : compact->subcompactions)
+  {
+    success = success && sub.success;
+    delete sub.input;
+    sub.input = nullptr;
+  }
+
+  if (_shuttingDown.load(std::memory_order_acquire)) return false;
+  if (success) success = installCompactionResults(compact);
+  if (!success) {
+    printError("DBImpl: compact level ", c->level(), " error");
+  }
+  return success;
+}
+
+bool DBImpl::Get(const ReadOptions& options, const Slice& key, std::string* value)
+{
+  std::shared_ptr<MemTable> mem;
+  std::vector<std::shared_ptr<MemTable>> imms;
+  Version* current = nullptr;
+  SequenceNumber seq;
+  {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    seq = (options.snapshot != nullptr)
+        ? static_cast<const SnapshotImpl*>(options.snapshot)->getSequenceNumber()
+        : _versions->getLastSequence();
+    mem = _mem;
+    // Newest first
+    for (auto imm = _imms.rbegin(); imm != _imms.rend(); ++imm) {
+      imms.push_back(imm->mem);
+    }
+    current = _versions->current();
+    current->ref();
+  }
+
+  // Unlock while reading from files and memtables
+  LookUpKey lookupKey(key, seq);
+  bool found = true;
+  bool result = false;
+  bool haveStatUpdate = false;
+  Version::GetStats stats;
+  bool inMemory = mem->get(lookupKey, value, found);
+  for (size_t i = 0; !inMemory && imms.size() > i; i++) {
+    inMemory = imms[i]->get(lookupKey, value, found);
+  }
+  if (inMemory) {
+    // Done
+    result = found;
+  } else {
+    result = current->get(options, lookupKey.getUserKeyWithSeqAndType(), value, found, &stats) &&
+             found;
+    haveStatUpdate = true;
+  }
+
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  if (haveStatUpdate && current->updateStats(stats)) {
+    maybeScheduleFlushOrCompaction();
+  }
+  current->unRef();
+  return result;
+}
+
+void DBImpl::MultiGet(const ReadOptions& options, const Slice* keys, int n,
+                      std::string* values, bool* found)
+{
+  if (n <= 0) return;
+
+  std::shared_ptr<MemTable> mem;
+  std::vector<std::shared_ptr<MemTable>> imms;
+  Version* current = nullptr;
+  SequenceNumber seq;
+  {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    seq = (options.snapshot != nullptr)
+        ? static_cast<const SnapshotImpl*>(options.snapshot)->getSequenceNumber()
+        : _versions->getLastSequence();
+    mem = _mem;
+    // Newest first
+    for (auto imm = _imms.rbegin(); imm != _imms.rend(); ++imm) {
+      imms.push_back(imm->mem);
+    }
+    current = _versions->current();
+    current->ref();
+  }
+
+  // Look the keys up in user key order, so the keys of one table or
+  // data block are next to each other
+  std::vector<int> order(n);
+  for (int i = 0; n > i; i++) order[i] = i;
+  const Comparator* ucmp = _options.comparator;
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return ucmp->cmp(keys[a], keys[b]) < 0;
+  });
+
+  // Keys not in any memtable, in sorted order
+  std::vector<std::unique_ptr<LookUpKey>> lookupKeys;
+  std::vector<Slice> pendingKeys;
+  std::vector<int> pending;
+  for (int i : order)
+  {
+    lookupKeys.emplace_back(new LookUpKey(keys[i], seq));
+    LookUpKey& lookupKey = *lookupKeys.back();
+    bool valueFound = true;
+    bool inMemory = mem->get(lookupKey, &values[i], valueFound);
+    for (size_t j = 0; !inMemory && imms.size() > j; j++) {
+      inMemory = imms[j]->get(lookupKey, &values[i], valueFound);
+    }
+    if (inMemory) {
+      found[i] = valueFound;
+    } else {
+      pendingKeys.push_back(lookupKey.getUserKeyWithSeqAndType());
+      pending.push_back(i);
+    }
+  }
+
+  bool haveStatUpdate = false;
+  Version::GetStats stats;
+  if (!pending.empty())
+  {
+    const int pendingNum = static_cast<int>(pending.size());
+    std::vector<std::string> pendingValues(pendingNum);
+    std::unique_ptr<bool[]> done(new bool[pendingNum]);
+    std::unique_ptr<bool[]> pendingFound(new bool[pendingNum]);
+    current->multiGet(options, pendingKeys.data(), pendingNum, pendingValues.data(),
+                      done.get(), pendingFound.get(), &stats);
+    for (int j = 0; pendingNum > j; j++)
+    {
+      const int i = pending[j];
+      found[i] = done[j] && pendingFound[j];
+      if (found[i]) values[i].swap(pendingValues[j]);
+    }
+    haveStatUpdate = true;
+  }
+
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  if (haveStatUpdate && current->updateStats(stats)) {
+    maybeScheduleFlushOrCompaction();
+  }
+  current->unRef();
+}
+
+namespace
+{
+
+// Keeps the memtables and the version of an iterator alive
+struct IterState
+{
+  sync::Mutex* mu;
+  Version* version;
+  std::shared_ptr<MemTable> mem;
+  std::vector<std::shared_ptr<MemTable>> imms;
+};
+
+}
+
+static void cleanupIteratorState(void* arg1, void* arg2)
+{
+  (void)arg2;
+  IterState* state = static_cast<IterState*>(arg1);
+  state->mu->Lock();
+  state->version->unRef();
+  state->mu->unlock();
+  delete state;
+}
+
+Iterator* DBImpl::NewIterator(const ReadOptions& options)
+{
+  std::vector<Iterator*> children;
+  SequenceNumber seq;
+  IterState* state = new IterState;
+  {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    seq = (options.snapshot != nullptr)
+        ? static_cast<const SnapshotImpl*>(options.snapshot)->getSequenceNumber()
+        : _versions->getLastSequence();
+
+    // Collect together all needed child iterators
+    state->mu = &_mutex;
+    state->mem = _mem;
+    children.push_back(_mem->newIterator());
+    for (const auto& imm : _imms)
+    {
+      state->imms.push_back(imm.mem);
+      children.push_back(imm.mem->newIterator());
+    }
+    state->version = _versions->current();
+    state->version->addIterators(options, &children);
+    state->version->ref();
+  }
+
+  Iterator* internalIter = newMergingIterator(_options.comparator, children.data(),
+                                              static_cast<int>(children.size()));
+  internalIter->registerCleanup(cleanupIteratorState, state, nullptr);
+  return newDBIterator(_options.comparator, internalIter, seq,
+                       options.prefix_same_as_start ? _options.prefix_extractor : nullptr);
+}
+
+const Snapshot* DBImpl::GetSnapshot()
+{
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  SnapshotImpl* snapshot = new SnapshotImpl(_versions->getLastSequence(), nullptr, nullptr);
+  _snapshots.insert(snapshot);
+  return snapshot;
+}
+
+void DBImpl::ReleaseSnapshot(const Snapshot* snapshot)
+{
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  SnapshotImpl* impl = const_cast<SnapshotImpl*>(static_cast<const SnapshotImpl*>(snapshot));
+  if (_snapshots.remove(impl)) delete impl;
+}
+
+bool DBImpl::GetProperty(const Slice& property, std::string* value)
+{
+  if (value == nullptr) return false;
+
+  const Slice numFilesPrefix("yundb.num-files-at-level");
+  if (property.start_with(numFilesPrefix)) {
+    std::string levelStr(property.data() + numFilesPrefix.size(),
+                         property.size() - numFilesPrefix.size());
+    if (levelStr.empty() ||
+        levelStr.find_first_not_of("0123456789") != std::string::npos) {
+      return false;
+    }
+    int level = std::atoi(levelStr.c_str());
+    if (level >= MaxFileLevel) return false;
+
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    *value = std::to_string(_versions->levelTablesNumber(level));
+    return true;
+  }
+
+  if (property == Slice("yundb.approximate-memory-usage")) {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    size_t usage = _mem->getMemoryUsage();
+    for (const auto& imm : _imms) {
+      usage += imm.mem->getMemoryUsage();
+    }
+    *value = std::to_string(usage);
+    return true;
+  }
+
+  if (property == Slice("yundb.num-immutable-mem-table")) {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    *value = std::to_string(_imms.size());
+    return true;
+  }
+
+  return _tableCache->getProperty(property, value);
+}
+
+void DBImpl::GetApproximateSizes(const Range* range, int n, uint64_t* sizes)
+{
+  Version* current;
+  {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    current = _versions->current();
+    current->ref();
+  }
+
+  // Unlock while reading the index blocks of the tables
+  for (int i = 0; n > i; i++)
+  {
+    // The oldest entry of a user key is its smallest internal key
+    std::string start = range[i].start.toString();
+    PutFixed64(&start, packSeqAndType(0, TypeDeletion));
+    std::string limit = range[i].limit.toString();
+    PutFixed64(&limit, packSeqAndType(0, TypeDeletion));
+
+    sizes[i] = 0;
+    for (int level = 0; MaxFileLevel > level; level++)
+    {
+      std::vector<std::shared_ptr<FileMeta>> inputs;
+      current->getOverlappingInputs(level, &range[i].start, &range[i].limit, inputs);
+      for (const auto& f : inputs)
+      {
+        // limit is exclusive
+        if (_options.comparator->cmp(f->smallest->getUserKey(), range[i].limit) >= 0) continue;
+
+        uint64_t startOffset = _tableCache->approximateOffsetOf(f->number, f->fileSize, start);
+        uint64_t limitOffset = _tableCache->approximateOffsetOf(f->number, f->fileSize, limit);
+        if (limitOffset > startOffset) sizes[i] += limitOffset - startOffset;
+      }
+    }
+  }
+
+  sync::LockGuard<sync::Mutex> lock(_mutex);
+  current->unRef();
+}
+
+bool DBImpl::flushMemTable()
+{
+  // A null batch forces a memtable switch
+  if (!doWrite(WriteOptions(), nullptr)) return false;
+
+  // Wait until the compaction completes
+  _mutex.Lock();
+  while (!_imms.empty() && !_bgError)
+  {
+    _backgroundWorkFinishedSignal.wait();
+  }
+  bool success = !_bgError;
+  _mutex.unlock();
+  return success;
+}
+
+void DBImpl::compactLevelRange(int level, const Slice* begin, const Slice* end)
+{
+  ManualCompaction manual;
+  manual.level = level;
+  manual.done = false;
+  manual.begin = begin;
+  manual.end = end;
+
+  _mutex.Lock();
+  while (!manual.done && !_shuttingDown.load(std::memory_order_acquire) && !_bgError)
+  {
+    if (_manualCompaction == nullptr) {
+      // Idle
+      _manualCompaction = &manual;
+      maybeScheduleFlushOrCompaction();
+    } else {
+      // Running either my compaction or another compaction.
+      _backgroundWorkFinishedSignal.wait();
+    }
+  }
+  // Wait until the background call is done with manual
+  while (_manualCompaction == &manual && _backgroundCompactionScheduled)
+  {
+    _backgroundWorkFinishedSignal.wait();
+  }
+  if (_manualCompaction == &manual) _manualCompaction = nullptr;
+  _mutex.unlock();
+}
+
+void DBImpl::CompactRange(const Slice* begin, const Slice* end)
+{
+  int maxLevelWithFiles = 1;
+  {
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    Version* base = _versions->current();
+    for (int level = 1; MaxFileLevel > level; level++)
+    {
+      if (base->overlapInLevel(level, begin, end)) {
+        maxLevelWithFiles = level;
+      }
+    }
+  }
+
+  flushMemTable();
+  for (int level = 0; maxLevelWithFiles > level; level++) {
+    compactLevelRange(level, begin, end);
+  }
+}
+
+bool DestroyDB(const std::string& name, const Options& options)
+{
+  Env* env = options.env;
+  std::vector<std::string> children;
+  if (!env->fileExists(name) || !env->getChildren(name, &children)) {
+    // Ignore error in case directory does not exist
+    return true;
+  }
+
+  bool result = true;
+  for (const auto& child : children)
+  {
+    uint64_t number;
+    FileType type;
+    if (parseFileName(child, &number, &type)) {
+      result = env->removeFile(name + "/" + child) && result;
+    }
+  }
+  env->removeDir(name);
+  return result;
+}
+
+}
@@ -0,0 +1,204 @@
+#ifndef YUNDB_DB_DB_IMPL_H
+#define YUNDB_DB_DB_IMPL_H
+
+#include "yundb/db.h"
+#include "yundb/write_batch.h"
+#include "dbformat.h"
+#include "log_writer.h"
+#include "memtable.h"
+#include "snapshot.h"
+#include "table_cache.h"
+#include "version_edit.h"
+#include "util/sync.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace yundb
+{
+
+class Compaction;
+class Version;
+class VersionSet;
+
+class DBImpl : public DB
+{
+ public:
+  DBImpl(const Options& options, const std::string& dbname);
+
+  DBImpl(const DBImpl&) = delete;
+  DBImpl& operator=(const DBImpl&) = delete;
+
+  ~DBImpl() override;
+
+  // Implementations of the DB interface
+  bool Put(const WriteOptions& options, const Slice& key, const Slice& value) override;
+  bool Delete(const WriteOptions& options, const Slice& key) override;
+  bool Write(const WriteOptions& options, WriteBatch* updates) override;
+  bool Get(const ReadOptions& options, const Slice& key, std::string* value) override;
+  void MultiGet(const ReadOptions& options, const Slice* keys, int n,
+                std::string* values, bool* found) override;
+  Iterator* NewIterator(const ReadOptions& options) override;
+  const Snapshot* GetSnapshot() override;
+  void ReleaseSnapshot(const Snapshot* snapshot) override;
+  bool GetProperty(const Slice& property, std::string* value) override;
+  void GetApproximateSizes(const Range* range, int n, uint64_t* sizes) override;
+  void CompactRange(const Slice* begin, const Slice* end) override;
+
+ private:
+  friend class DB;
+  struct Writer;
+  struct ManualCompaction;
+  struct CompactionState;
+  struct Subcompaction;
+  struct SubcompactionTask;
+
+  // Write a new MANIFEST for an empty db and point CURRENT at it
+  bool newDB();
+
+  // Create or lock the db dir, load the current version and replay the
+  // log files that are not covered by it. Start a new log file.
+  // REQUIRES: _mutex is held
+  bool recover();
+
+  // Open the log file number for writing, reusing a retired log if
+  // there is one. Return nullptr on failure.
+  // REQUIRES: _mutex is held
+  WritableFile* newLogFile(uint64_t number);
+
+  // Insert every batch of log file number into a memtable, full
+  // memtables are written into level-0 tables recorded in *edit.
+  // *maxSequence is updated to the last sequence in the log.
+  // Return false if a record does not hold a valid batch
+  // REQUIRES: _mutex is held
+  bool replayLogFile(uint64_t number, VersionEdit* edit, SequenceNumber* maxSequence);
+
+  // Queue updates behind the other writers, a null updates only
+  // forces the memtable to be switched
+  bool doWrite(const WriteOptions& options, WriteBatch* updates);
+
+  // Merge the batches of the writers at the front of the queue into one.
+  // *lastWriter is set to the last writer merged.
+  // REQUIRES: _mutex is held, the queue is not empty
+  WriteBatch* buildBatchGroup(Writer** lastWriter);
+
+  // Make sure the memtable has room for a write, switch to a new
+  // memtable and log when it is full. force switches anyway.
+  // REQUIRES: _mutex is held, this thread is the write leader
+  bool makeRoomForWrite(bool force);
+
+  // Build a table file from the entries of iter and add it to *edit.
+  // The table goes to level 0 when base is null, otherwise to the level
+  // picked by base. An empty iter adds no table. The table stays in
+  // _pendingOutputs until *edit is applied.
+  // REQUIRES: _mutex is held
+  bool writeLevel0Table(Iterator* iter, VersionEdit* edit, Version* base);
+
+  // Merge the memtables of _imms into one level-0 table and install it
+  // in a new version. Memtables that fill up meanwhile are left for the
+  // next flush. Flushes run next to compactions, so the table never
+  // skips level 0 where it could overlap the outputs of a running
+  // compaction.
+  // REQUIRES: _mutex is held
+  void compactMemTable();
+
+  // Apply *edit to the current version and drop its new tables from
+  // _pendingOutputs. Flushes and compactions finish on different
+  // threads, this lets one manifest write run at a time.
+  // REQUIRES: _mutex is held
+  bool logAndApply(VersionEdit* edit);
+
+  // Remove files that are not referenced by any live version
+  // REQUIRES: _mutex is held
+  void deleteObsoleteFiles();
+
+  // Schedule a flush of _imm on the high priority pool and a compaction
+  // on the low priority pool if there is work to do
+  // REQUIRES: _mutex is held
+  void maybeScheduleFlushOrCompaction();
+  static void bgFlush(void* db);
+  static void bgCompaction(void* db);
+  void backgroundFlushCall();
+  void backgroundCompactionCall();
+  // REQUIRES: _mutex is held
+  void backgroundCompaction();
+
+  // Merge the inputs of compact->compaction into level+1 tables. The
+  // compaction is split into key ranges that are merged in parallel
+  // when options.max_subcompactions > 1.
+  // REQUIRES: _mutex is held
+  bool doCompactionWork(CompactionState* compact);
+  // Merge the key range of one subcompaction
+  // REQUIRES: _mutex is not held
+  void processSubcompaction(Subcompaction* sub);
+  // Runs a SubcompactionTask on the low priority pool
+  static void subcompactionEntry(void* task);
+  // Finish the output table sub->builder is writing
+  // REQUIRES: _mutex is not held
+  bool finishCompactionOutput(Subcompaction* sub);
+  // REQUIRES: _mutex is held
+  bool installCompactionResults(CompactionState* compact);
+  // REQUIRES: _mutex is held
+  void cleanupCompaction(CompactionState* compact);
+
+  // Force the current memtable into a table and wait until it is written
+  bool flushMemTable();
+  // Compact every file of level that overlaps [begin,end]
+  void compactLevelRange(int level, const Slice* begin, const Slice* end);
+
+  const Options _options;
+  const std::string _dbname;
+  std::shared_ptr<TableCache> _tableCache;
+  FileLock* _dbLock;
+
+  sync::Mutex _mutex;
+  std::atomic<bool> _shuttingDown;
+  // Signalled when background work finishes
+  sync::CondVar _backgroundWorkFinishedSignal;
+  std::shared_ptr<MemTable> _mem;
+  // A full memtable and the log that holds its writes
+  struct ImmutableMemTable
+  {
+    std::shared_ptr<MemTable> mem;
+    uint64_t logNumber;
+  };
+  // Full memtables waiting to be flushed, oldest first. Readers still
+  // find their entries here until the flush is installed.
+  std::deque<ImmutableMemTable> _imms;
+  // Only the leader of a write group touches _log and _tmpBatch
+  std::unique_ptr<log::Writer> _log;
+  uint64_t _logFileNumber;
+  // First log written by this instance. Older logs may be in the old
+  // record format, so they are never reused.
+  uint64_t _firstOwnLogNumber;
+  // Retired logs waiting to be reused, named by their old numbers
+  std::deque<uint64_t> _logsToRecycle;
+  WriteBatch _tmpBatch;
+  std::deque<Writer*> _writers;
+  // Writers of the current group still inserting into the memtable
+  int _runningMemTableWriters;
+  SnapshotList _snapshots;
+
+  // Table files that are being written and must not be deleted
+  std::set<uint64_t> _pendingOutputs;
+  // Obsolete files some thread is removing with _mutex released
+  std::set<std::string> _deletingFiles;
+  bool _backgroundFlushScheduled;
+  bool _backgroundCompactionScheduled;
+  // SubcompactionTasks handed to the env that have not returned yet
+  int _scheduledSubcompactionTasks;
+  // A thread is in VersionSet::logAndApply, the others wait on the signal
+  bool _manifestWriting;
+  sync::CondVar _manifestWriteSignal;
+  ManualCompaction* _manualCompaction;
+  std::unique_ptr<VersionSet> _versions;
+  // Set when a background write failed, later writes fail too
+  bool _bgError;
+};
+
+}
+
+#endif // YUNDB_DB_DB_IMPL_H
@@ -0,0 +1,242 @@
+#include "db_iter.h"
+#include "util/coding.h"
+
+#include <memory>
+#include <string>
+
+namespace yundb
+{
+
+// Entries of one user key come in ascending sequence order from the
+// internal iterator. Moving forward, all entries of a user key are read
+// and the last visible one wins. Moving backward, the first visible one
+// wins. The winner is copied out, so the internal iterator is always
+// parked outside the entries of the current user key:
+//
+// Forward: at the first entry after the current user key
+// Reverse: at the last entry before the current user key
+class DBIter : public Iterator
+{
+ public:
+  DBIter(const Comparator* comparator, Iterator* iter, SequenceNumber seq,
+         const SliceTransform* prefixExtractor)
+        : _comparator(comparator),
+          _iter(iter),
+          _seq(seq),
+          _prefixExtractor(prefixExtractor),
+          _direction(Forward),
+          _valid(false),
+          _hasPrefix(false) {}
+
+  DBIter(const DBIter&) = delete;
+  DBIter& operator=(const DBIter&) = delete;
+
+  ~DBIter() override = default;
+
+  bool valid() const override { return _valid; }
+
+  void seekToFirst() override
+  {
+    _direction = Forward;
+    _iter->seekToFirst();
+    _hasPrefix = false;
+    findNextUserEntry();
+    // The prefix of the first key bounds the iteration
+    if (_valid) setPrefix(Slice(_key));
+  }
+
+  void seekToLast() override
+  {
+    if (_prefixExtractor != nullptr) {
+      setInvalid();
+      return;
+    }
+    _direction = Reverse;
+    _iter->seekToLast();
+    findPrevUserEntry();
+  }
+
+  // Target is a user key
+  void seek(const Slice& target) override
+  {
+    // Sequence 0 is the smallest internal key of target
+    _seekKey.assign(target.data(), target.size());
+    PutFixed64(&_seekKey, packSeqAndType(0, TypeForSeek));
+    _direction = Forward;
+    setPrefix(target);
+    _iter->seek(Slice(_seekKey));
+    findNextUserEntry();
+  }
+
+  void next() override
+  {
+    if (_direction == Reverse) {
+      // Internal iterator is before the current user key,
+      // step over all entries of it
+      if (!_iter->valid()) {
+        _iter->seekToFirst();
+      } else {
+        _iter->next();
+      }
+      while (_iter->valid() && _comparator->cmp(userKey(_iter->key()), Slice(_key)) == 0)
+      {
+        _iter->next();
+      }
+      _direction = Forward;
+    }
+    findNextUserEntry();
+  }
+
+  void prev() override
+  {
+    if (_prefixExtractor != nullptr) {
+      setInvalid();
+      return;
+    }
+    if (_direction == Forward) {
+      // Internal iterator is after the current user key,
+      // step over all entries of it
+      if (!_iter->valid()) {
+        _iter->seekToLast();
+      } else {
+        _iter->prev();
+      }
+      while (_iter->valid() && _comparator->cmp(userKey(_iter->key()), Slice(_key)) == 0)
+      {
+        _iter->prev();
+      }
+      _direction = Reverse;
+    }
+    findPrevUserEntry();
+  }
+
+  Slice key() const override { return Slice(_key); }
+
+  Slice value() const override { return Slice(_value); }
+
+  bool status() const override { return _iter->status(); }
+
+ private:
+  enum Direction { Forward, Reverse };
+
+  static Slice userKey(const Slice& internalKey)
+  { return Slice(internalKey.data(), internalKey.size() - KeyTagSize); }
+
+  // Decode the tag of internal key, return true if it is visible at _seq
+  bool visible(const Slice& internalKey, ValueType* type) const
+  {
+    SequenceNumber seq;
+    decodeSeqAndType(internalKey.data() + internalKey.size() - KeyTagSize, &seq, type);
+    return seq <= _seq;
+  }
+
+  // Bound the iteration to the prefix of key, if it has one
+  void setPrefix(const Slice& key)
+  {
+    _hasPrefix = _prefixExtractor != nullptr && _prefixExtractor->inDomain(key);
+    if (_hasPrefix) {
+      Slice prefix = _prefixExtractor->transform(key);
+      _prefix.assign(prefix.data(), prefix.size());
+    }
+  }
+
+  bool outOfPrefix(const Slice& userKey) const
+  {
+    return _hasPrefix && (!_prefixExtractor->inDomain(userKey) ||
+                          _prefixExtractor->transform(userKey) != Slice(_prefix));
+  }
+
+  void setInvalid()
+  {
+    _valid = false;
+    _key.clear();
+    _value.clear();
+  }
+
+  void findNextUserEntry()
+  {
+    while (_iter->valid())
+    {
+      if (outOfPrefix(userKey(_iter->key()))) break;
+      _key.assign(userKey(_iter->key()).data(), userKey(_iter->key()).size());
+      bool found = false;
+      ValueType type = TypeDeletion;
+
+      for (; _iter->valid() && _comparator->cmp(userKey(_iter->key()), Slice(_key)) == 0;
+           _iter->next())
+      {
+        ValueType entryType;
+        if (visible(_iter->key(), &entryType)) {
+          found = true;
+          type = entryType;
+          if (type == TypeValue) {
+            Slice v = _iter->value();
+            _value.assign(v.data(), v.size());
+          }
+        }
+      }
+
+      if (found && type == TypeValue) {
+        _valid = true;
+        return;
+      }
+    }
+
+    _valid = false;
+    _key.clear();
+    _value.clear();
+  }
+
+  void findPrevUserEntry()
+  {
+    while (_iter->valid())
+    {
+      _key.assign(userKey(_iter->key()).data(), userKey(_iter->key()).size());
+      bool found = false;
+      ValueType type = TypeDeletion;
+
+      for (; _iter->valid() && _comparator->cmp(userKey(_iter->key()), Slice(_key)) == 0;
+           _iter->prev())
+      {
+        if (!found && visible(_iter->key(), &type)) {
+          found = true;
+          if (type == TypeValue) {
+            Slice v = _iter->value();
+            _value.assign(v.data(), v.size());
+          }
+        }
+      }
+
+      if (found && type == TypeValue) {
+        _valid = true;
+        return;
+      }
+    }
+
+    _valid = false;
+    _key.clear();
+    _value.clear();
+  }
+
+  const Comparator* const _comparator;
+  std::unique_ptr<Iterator> _iter;
+  const SequenceNumber _seq;
+  const SliceTransform* const _prefixExtractor;
+  Direction _direction;
+  bool _valid;
+  // Keys without _prefix end the iteration
+  bool _hasPrefix;
+  std::string _prefix;
+  // Current user key and value
+  std::string _key;
+  std::string _value;
+  std::string _seekKey;
+};
+
+Iterator* newDBIterator(const Comparator* userComparator, Iterator* internalIter,
+                        SequenceNumber seq, const SliceTransform* prefixExtractor)
+{
+  return new DBIter(userComparator, internalIter, seq, prefixExtractor);
+}
+
+}
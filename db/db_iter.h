@@ -0,0 +1,26 @@
+#ifndef YUNDB_DB_DB_ITER_H
+#define YUNDB_DB_DB_ITER_H
+
+#include "yundb/comparator.h"
+#include "yundb/iterator.h"
+#include "yundb/slice_transform.h"
+#include "dbformat.h"
+
+namespace yundb
+{
+
+// Return an iterator that converts internal keys (yielded by
+// internalIter) that were live at the specified sequence number
+// into appropriate user keys. Every user key is yielded once with its
+// newest value whose sequence is not greater than seq, deleted keys
+// are skipped. Takes ownership of internalIter.
+// With prefixExtractor, the iterator ends after the keys with the prefix
+// of the key it was positioned on by seek() or seekToFirst(), and prev()
+// and seekToLast() make it invalid.
+Iterator* newDBIterator(const Comparator* userComparator, Iterator* internalIter,
+                        SequenceNumber seq,
+                        const SliceTransform* prefixExtractor = nullptr);
+
+}
+
+#endif // YUNDB_DB_DB_ITER_H
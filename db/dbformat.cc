@@ -59,6 +59,28 @@ std::string uncompressBlock(const Slice& block, CompressionType type)
   return result;
 }
 
+int compareInternalKey(const Comparator* userCmp, const Slice& key1, const Slice& key2)
+{
+  const size_t key1Len = key1.size(), key2Len = key2.size();
+  int rs = userCmp->cmp(Slice(key1.data(), key1Len - KeyTagSize),
+                        Slice(key2.data(), key2Len - KeyTagSize));
+
+  if (rs == 0)
+  {
+    SequenceNumber key1Seq, key2Seq;
+    decodeSeqAndType(key1.data() + key1Len - KeyTagSize, &key1Seq, nullptr);
+    decodeSeqAndType(key2.data() + key2Len - KeyTagSize, &key2Seq, nullptr);
+
+    if (key1Seq > key2Seq) {
+      rs = +1;
+    } else if (key1Seq < key2Seq) {
+      rs = -1;
+    }
+  }
+
+  return rs;
+}
+
 InternalComparator::InternalComparator(const Options& options)
       : _options(options){}
 
@@ -99,35 +121,7 @@ const char* InternalComparator::name() const
 
 int InternalComparator::cmp(const Slice& key1, const Slice& key2) const 
 {
-
-  Slice decodedKey1 = decodeKey(key1);
-  Slice decodedKey2 = decodeKey(key2);
-
-  size_t decodedKey1Len = decodedKey1.size(), decodedKey2Len = decodedKey2.size();
-
-  // Cmp user key
-  int rs = _options.comparator->cmp(
-    Slice(decodedKey1.data(), decodedKey1Len - KeyTagSize),
-    Slice(decodedKey2.data(), decodedKey2Len - KeyTagSize)
-  );
-
-  // Cmp seq
-  if (rs == 0)
-  {
-    SequenceNumber key1Seq, key2Seq;
-    decodeSeqAndType(decodedKey1.data() + decodedKey1Len - KeyTagSize, 
-                     &key1Seq, nullptr);
-    decodeSeqAndType(decodedKey2.data() + decodedKey2Len - KeyTagSize,
-                     &key2Seq, nullptr);
-
-    if (key1Seq > key2Seq) {
-      rs = +1;
-    } else if (key1Seq < key2Seq) {
-      rs = -1;
-    }
-  }
-
-  return rs;
+  return compareInternalKey(_options.comparator, decodeKey(key1), decodeKey(key2));
 }
 
 LookUpKey::LookUpKey(const Slice& key, SequenceNumber seq)
@@ -65,6 +65,10 @@ CompressionType checkBlock(const Slice& block);
 // Remove trailer and uncompress block if needed
 std::string uncompressBlock(const Slice& block, CompressionType type);
 
+// Compare keys of format | user key | seq, type |,
+// user key by userCmp first, then the bigger seq is the bigger key
+int compareInternalKey(const Comparator* userCmp, const Slice& key1, const Slice& key2);
+
 // Decode format | key | seq, type |
 Slice decodeKey(const Slice& entry);
 
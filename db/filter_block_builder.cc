@@ -4,25 +4,50 @@
 namespace yundb
 {
 
-FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy)
-      : _policy(policy) {}
+FilterBlockBuilder::FilterBlockBuilder(const FilterPolicy* policy,
+                                       const SliceTransform* prefixExtractor)
+      : _policy(policy),
+        _prefixExtractor(prefixExtractor) {}
 
 FilterBlockBuilder::~FilterBlockBuilder() {}
 
 void FilterBlockBuilder::addKey(const Slice& key)
 {
   if (key.empty()) printError("FilterBlockBuilder: None key");
-  _tmpKeys.push_back(key);
+  // The versions of a user key come one after another
+  addEntry(key, &_lastKey);
+  if (_prefixExtractor != nullptr && _prefixExtractor->inDomain(key))
+  {
+    Slice prefix = _prefixExtractor->transform(key);
+    if (!prefix.empty()) addEntry(prefix, &_lastPrefix);
+  }
+}
+
+void FilterBlockBuilder::addEntry(const Slice& entry, std::string* last)
+{
+  if (!_keyStarts.empty() && Slice(*last) == entry) return;
+  last->assign(entry.data(), entry.size());
+  _keyStarts.push_back(_keys.size());
+  _keys.append(entry.data(), entry.size());
 }
 
 void FilterBlockBuilder::generateFilter()
 {
-  if (_tmpKeys.empty()) printError("FilterBlockBuilder: None keys");
+  if (_keyStarts.empty()) printError("FilterBlockBuilder: None keys");
+  _keyStarts.push_back(_keys.size());
+  _tmpKeys.resize(_keyStarts.size() - 1);
+  for (size_t i = 0; _tmpKeys.size() > i; i++) {
+    _tmpKeys[i] = Slice(_keys.data() + _keyStarts[i], _keyStarts[i + 1] - _keyStarts[i]);
+  }
   auto offset = _result.size();
   auto writeSize = _policy->createFilter(&_tmpKeys[0], _tmpKeys.size(), &_result);
   _filterOffsets.push_back(offset);
   _filterDataSizes.push_back(writeSize);
   _tmpKeys.clear();
+  _keys.clear();
+  _keyStarts.clear();
+  _lastKey.clear();
+  _lastPrefix.clear();
 }
 
 
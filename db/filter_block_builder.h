@@ -3,6 +3,7 @@
 // Header guard standardized to YUNDB_DB_FILTER_BLOCK_BUILDER_H
 
 #include "yundb/filter_policy.h"
+#include "yundb/slice_transform.h"
 
 #include <string>
 #include <vector>
@@ -19,21 +20,36 @@ Filter data size refer end of all filter data.
 class FilterBlockBuilder
 {
  public:
-  FilterBlockBuilder(const FilterPolicy* policy);
+  // With prefixExtractor, the prefix of every key is added too
+  FilterBlockBuilder(const FilterPolicy* policy,
+                     const SliceTransform* prefixExtractor = nullptr);
   FilterBlockBuilder(const FilterBlockBuilder& other) = delete;
   FilterBlockBuilder& operator=(const FilterBlockBuilder& ohter) = delete;
   ~FilterBlockBuilder();
 
   // Generater a filter
   void generateFilter();
-  // Add key to tmp keys
+  // Add key and its prefix to tmp keys, they are copied. A key or prefix
+  // equal to the one added just before is skipped.
   void addKey(const Slice& key);
 
+  // Return true if no key was added since the last filter
+  bool empty() const { return _keyStarts.empty(); }
+
   const Slice finish();
  private:
+  void addEntry(const Slice& entry, std::string* last);
+
   const FilterPolicy* _policy;
+  const SliceTransform* _prefixExtractor;
+  // Last key and prefix added to the next filter
+  std::string _lastKey;
+  std::string _lastPrefix;
   // Computed filter data
   std::string _result;
+  // Flattened keys of the next filter and the offset of each key
+  std::string _keys;
+  std::vector<size_t> _keyStarts;
   // For filter->createFilter() argument
   std::vector<Slice> _tmpKeys;
   std::vector<uint32_t> _filterOffsets;
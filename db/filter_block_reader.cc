@@ -47,6 +47,21 @@ bool FilterBlockReader::keyMayMatch(uint32_t filterIndex, const Slice& key) cons
 	return _policy->keyMayMatch(key, Slice(_filterData + start, size));
 }
 
+void FilterBlockReader::keysMayMatch(uint32_t filterIndex, const Slice* keys, int n,
+																		 bool* results) const
+{
+	if (_policy == nullptr || _filterNum == 0 || filterIndex >= _filterNum)	{
+		printError("FilterBlockReader: filter index out of range");
+		for (int i = 0; n > i; i++) results[i] = false;
+		return;
+	}
+
+	auto start = getFilterOffset(filterIndex);
+	auto size = getFilterSize(filterIndex);
+
+	_policy->keysMayMatch(keys, n, Slice(_filterData + start, size), results);
+}
+
 uint32_t FilterBlockReader::getFilterOffset(uint32_t filterIndex) const
 { return DecodeFixed32(_filterOffsets + filterIndex * 4); }
 
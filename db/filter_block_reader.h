@@ -22,6 +22,9 @@ class FilterBlockReader
 
   bool keyMayMatch(uint32_t filterIndex, const Slice& key) const;
 
+  // Set results[i] to keyMayMatch(filterIndex, keys[i]) for every i < n
+  void keysMayMatch(uint32_t filterIndex, const Slice* keys, int n, bool* results) const;
+
  private:
   uint32_t getFilterOffset(uint32_t filterIndex) const;
 
@@ -12,7 +12,9 @@ namespace log
 {
 
 constexpr size_t recordBlockSize = 32768; /* 32k */
-constexpr size_t recordHeadSize = 3; /*length(2byte), type(1byte) */
+constexpr size_t recordHeadSize = 7; /* checksum(4byte), length(2byte), type(1byte) */
+/* recordHeadSize + log number(4byte) */
+constexpr size_t recyclableRecordHeadSize = recordHeadSize + 4;
 
 enum RecordType
 {
@@ -22,10 +24,16 @@ enum RecordType
   /* For fragments */
   FirstType = 2,
   MiddleType = 3,
-  LastType = 4
+  LastType = 4,
+  /* Same as above, the header also holds the log number. Records left
+     over from the earlier life of a reused file have an older number */
+  RecyclableFullType = 5,
+  RecyclableFirstType = 6,
+  RecyclableMiddleType = 7,
+  RecyclableLastType = 8
 };
 
-constexpr size_t maxRecordType = LastType;
+constexpr size_t maxRecordType = RecyclableLastType;
 
 }
 
@@ -19,15 +19,19 @@ enum {
   BadRecord = maxRecordType + 2
 };
 
-Reader::Reader(SequentialFile* file, size_t initialOffset, bool checksum)
+Reader::Reader(SequentialFile* file, size_t initialOffset, bool checksum,
+               uint64_t logNumber)
     : _file(file),
       _initialOffset(initialOffset),
       _lastRecordOffset(0),
       _endOfBufferOffset(0),
       _data(new char[recordBlockSize]),
+      _lastHeadSize(recordHeadSize),
+      _logNumber(static_cast<uint32_t>(logNumber)),
       _checksum(checksum),
       _eof(false),
-      _resyncing(initialOffset > 0) {}
+      _resyncing(initialOffset > 0),
+      _recycled(false) {}
 
 Reader::~Reader()
 {delete[] _data;}
@@ -55,7 +59,7 @@ bool Reader::readRecord(Slice* record, std::string* scratch)
     // internal buffer. Calculate the offset of the next physical record now
     // that it has returned, properly accounting for its header size.
     uint64_t physicalRecordOffset =
-        _endOfBufferOffset - _readBuf.size() - recordHeadSize - fragment.size();
+        _endOfBufferOffset - _readBuf.size() - _lastHeadSize - fragment.size();
 
     if (_resyncing)
     {
@@ -204,13 +208,15 @@ unsigned int Reader::readPhysicalRecord(Slice* result)
     const char* header = _readBuf.data();
     const uint32_t a = static_cast<uint32_t>(header[4]) & 0xff;
     const uint32_t b = static_cast<uint32_t>(header[5]) & 0xff;
-    const unsigned int type = header[6];
+    unsigned int type = static_cast<unsigned char>(header[6]);
     const uint32_t length = a | (b << 8);
+    const bool recyclable = type >= RecyclableFullType && type <= RecyclableLastType;
+    const size_t headSize = recyclable ? recyclableRecordHeadSize : recordHeadSize;
 
-    if (recordHeadSize + length > _readBuf.size())
+    if (headSize + length > _readBuf.size())
     {
       _readBuf.clear();
-      if (!_eof) {
+      if (!_eof && !_recycled) {
         printError("log::Reader: bad record length");
         return BadRecord;
       }
@@ -226,25 +232,45 @@ unsigned int Reader::readPhysicalRecord(Slice* result)
     if (_checksum)
     {
       uint32_t expectedCrc = crc32c::Unmask(DecodeFixed32(header));
-      uint32_t actualCrc = crc32c::Value(header + 6, length + 1);
+      uint32_t actualCrc = crc32c::Value(header + 6, headSize - 6 + length);
       if (actualCrc != expectedCrc)
       {
         _readBuf.clear();
+        // A torn write over the old contents of a reused file
+        if (_recycled) return Eof;
         printError("log::Reader: checksum mismatch");
         return BadRecord;
       }
     }
 
-    _readBuf.removePrefix(recordHeadSize + length);
+    if (recyclable)
+    {
+      if (DecodeFixed32(header + recordHeadSize) != _logNumber) {
+        // Written before the file was reused
+        _readBuf.clear();
+        return Eof;
+      }
+      _recycled = true;
+      type -= RecyclableFullType - FullType;
+    }
+    else if (_recycled)
+    {
+      // Left over from a log in the old format
+      _readBuf.clear();
+      return Eof;
+    }
+
+    _readBuf.removePrefix(headSize + length);
+    _lastHeadSize = headSize;
 
     // Skip physical record that started before initial_offset_
-    if (_endOfBufferOffset - _readBuf.size() - recordHeadSize - length <
+    if (_endOfBufferOffset - _readBuf.size() - headSize - length <
         _initialOffset) {
       result->clear();
       return BadRecord;
     }
 
-    *result = Slice(header + recordHeadSize, length);
+    *result = Slice(header + headSize, length);
     return type;
   }
 }
@@ -18,7 +18,11 @@ class Reader
   Reader() = default;
   Reader(Reader& other) = delete;
   Reader& operator=(Reader& other) = delete;
-  explicit Reader(SequentialFile* file, size_t initialOffset, bool checksum);
+  // Records of the recyclable types must carry logNumber, a record of
+  // another log is left over from an earlier use of the file and ends
+  // the log.
+  explicit Reader(SequentialFile* file, size_t initialOffset, bool checksum,
+                  uint64_t logNumber = 0);
   ~Reader();
 
   size_t lastRecordOffset() const;
@@ -37,10 +41,16 @@ class Reader
   char* _data;
   // Need parse data buffer
   Slice _readBuf;
+  // Header size of the last physical record read
+  size_t _lastHeadSize;
+  uint32_t _logNumber;
   // Used to check data integrity
   bool _checksum;
   bool _eof;
   bool _resyncing;
+  // A record of the recyclable types has been read, so the file may be
+  // reused and anything that does not parse is the stale tail
+  bool _recycled;
 };
 
 }
@@ -23,23 +23,26 @@ void Writer::appendRecord(const Slice& record)
 {
   const char* data = record.data();
   size_t write_size = record.size();
+  const size_t headSize = _recycleLog ? recyclableRecordHeadSize : recordHeadSize;
 
+  // Emit at least one physical record, even if record is empty
   bool begin = true;
-  while (write_size > 0)
+  do
   {
-    size_t available_block_size =  recordBlockSize - _block_offset;
-    size_t fragment_size = 
-      (available_block_size < write_size) ? available_block_size : write_size; 
-
-    /* need a new block to storage */
-    if (fragment_size <= recordHeadSize)
+    size_t leftover = recordBlockSize - _block_offset;
+    /* need a new block to storage, fill the trailer with zero */
+    if (leftover < headSize)
     {
-      _dest->append(Slice("\x00\x00\x00", fragment_size));
+      if (leftover > 0) {
+        _dest->append(Slice("\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", leftover));
+      }
       _block_offset = 0;
-      available_block_size = recordBlockSize - _block_offset;
-      fragment_size = (available_block_size < write_size) ? available_block_size : write_size;
     }
 
+    size_t available_block_size = recordBlockSize - _block_offset - headSize;
+    size_t fragment_size = 
+      (available_block_size < write_size) ? available_block_size : write_size; 
+
     bool end = (write_size == fragment_size);
     RecordType type;
     
@@ -55,34 +58,43 @@ void Writer::appendRecord(const Slice& record)
     
     emitPhysicalRecord(data, type, fragment_size);
 
-    _block_offset += (recordHeadSize + fragment_size);
     data += fragment_size;
     write_size -= fragment_size;
     begin = false;
-  }
+  } while (write_size > 0);
 }
 
 void Writer::emitPhysicalRecord(const char* data, RecordType type, size_t length)
 {
+  const size_t headSize = _recycleLog ? recyclableRecordHeadSize : recordHeadSize;
   assert(length <= 0xffff);  // Must fit in two bytes
-  assert(_block_offset + recordHeadSize + length <= recordBlockSize);
+  assert(_block_offset + headSize + length <= recordBlockSize);
+
+  if (_recycleLog) {
+    type = static_cast<RecordType>(type + RecyclableFullType - FullType);
+  }
 
   // Format the header, start 4 bytes for crc
-  char buf[recordHeadSize];
+  char buf[recyclableRecordHeadSize];
   buf[4] = static_cast<char>(length & 0xff);
   buf[5] = static_cast<char>(length >> 8);
   buf[6] = static_cast<char>(type);
 
-  // Compute the crc of the record type and the payload.
-  uint32_t crc = crc32c::Extend(_type_crc[type], data, length);
+  // Compute the crc of the record type, the log number and the payload.
+  uint32_t crc = _type_crc[type];
+  if (_recycleLog) {
+    EncodeFixed32(buf + recordHeadSize, _logNumber);
+    crc = crc32c::Extend(crc, buf + recordHeadSize, 4);
+  }
+  crc = crc32c::Extend(crc, data, length);
   crc = crc32c::Mask(crc);  // Adjust for storage
   EncodeFixed32(buf, crc);
 
   // Write the header and the payload
-  _dest->append(Slice(buf, recordHeadSize));
+  _dest->append(Slice(buf, headSize));
   _dest->append(Slice(data, length));
   _dest->flush();
-  _block_offset += recordHeadSize + length;
+  _block_offset += headSize + length;
 }
 
 }
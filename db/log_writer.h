@@ -7,8 +7,6 @@
 #include "yundb/en.h"
 #include "db/log_format.h"
 
-class WritableFile;
-
 namespace yundb
 {
 
@@ -21,17 +19,29 @@ class Writer
   Writer() = default;
   Writer(Writer& other) = delete;
   Writer& operator=(Writer& other) = delete;
+  // Take the ownership of file
   explicit Writer(WritableFile* file, size_t block_offset) 
-      : _dest(file), _block_offset(block_offset) {}
+      : _dest(file), _block_offset(block_offset) { initTypeCrc(); }
   explicit Writer(WritableFile* file)
-      : _dest(file), _block_offset(0) {}
+      : _dest(file), _block_offset(0) { initTypeCrc(); }
+  // Records carry the low 32 bits of logNumber if recycleLog is set, so
+  // a reader can tell them from stale records of a reused file
+  Writer(WritableFile* file, uint64_t logNumber, bool recycleLog)
+      : _dest(file),
+        _block_offset(0),
+        _logNumber(static_cast<uint32_t>(logNumber)),
+        _recycleLog(recycleLog) { initTypeCrc(); }
   ~Writer() = default;
   void appendRecord(const Slice& record);
+  // Sync appended records to disk
+  void sync() { _dest->sync(); }
  private:
   void emitPhysicalRecord(const char* data, RecordType type, size_t length);
   void initTypeCrc();
   std::unique_ptr<WritableFile> _dest;
   size_t _block_offset;
+  uint32_t _logNumber = 0;
+  bool _recycleLog = false;
   uint32_t _type_crc[maxRecordType + 1];
 };
 
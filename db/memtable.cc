@@ -2,21 +2,67 @@
 
 namespace yundb
 {
+
+class MemTableIterator : public Iterator
+{
+ public:
+  explicit MemTableIterator(const SkipList<Slice, InternalComparator>* skiplist)
+        : _iter(skiplist) {}
+
+  MemTableIterator(const MemTableIterator&) = delete;
+  MemTableIterator& operator=(const MemTableIterator&) = delete;
+
+  ~MemTableIterator() override = default;
+
+  bool valid() const override { return _iter.valid(); }
+
+  void seekToFirst() override { _iter.seekToFirst(); }
+
+  void seekToLast() override { _iter.seekToLast(); }
+
+  // Skiplist keys are | VarintKeySize | key | seq, type |
+  void seek(const Slice& target) override
+  {
+    _target.clear();
+    PutVarint64(&_target, target.size() - KeyTagSize);
+    _target.append(target.data(), target.size());
+    _iter.seek(Slice(_target));
+  }
+
+  void next() override { _iter.next(); }
+
+  void prev() override { _iter.prev(); }
+
+  Slice key() const override { return decodeKey(_iter.key()); }
+
+  Slice value() const override { return decodeValue(_iter.key()); }
+
+ private:
+  SkipList<Slice, InternalComparator>::Iterator _iter;
+  // Encoded seek target
+  std::string _target;
+};
+
+Iterator* MemTable::newIterator() const
+{
+  return new MemTableIterator(&_skiplist);
+}
+
 // The Node data format is | VarintKeySize | key | seq, type | VarintValueSize | Value |
 // but Node just refer | VarintKeySize |key| seq, type |
 
-void MemTable::add(SequenceNumber seq, ValueType type,
-                   const Slice& key, const Slice& value)
+size_t MemTable::encodedLength(const Slice& key, const Slice& value)
+{
+  return VarintLength(key.size()) + key.size() + KeyTagSize +
+      VarintLength(value.size()) + value.size();
+}
+
+Slice MemTable::encode(char* buf, SequenceNumber seq, ValueType type,
+                       const Slice& key, const Slice& value)
 {
-  countData(key, value);
-  /* Compute this need size and allocate */
   size_t keySize = key.size();
   size_t valueSize = value.size();
-  size_t valueVarintSize = VarintLength(valueSize);
   size_t keyVarintSize = VarintLength(keySize);
-  size_t needSize =  keyVarintSize + keySize + KeyTagSize +
-      valueVarintSize + valueSize;
-  char* buf = _arena->allocateAligned(needSize);
   char* keyStart = buf;
   /* Put key size */
   buf = EncodeVarint64(buf, keySize);
@@ -29,7 +75,23 @@ void MemTable::add(SequenceNumber seq, ValueType type,
   buf = EncodeVarint64(buf, valueSize);
   /* Put value */
   memcpy(buf, value.data(), valueSize);
-  _skiplist.insert(Slice(keyStart, keyVarintSize + keySize + KeyTagSize));
+  return Slice(keyStart, keyVarintSize + keySize + KeyTagSize);
+}
+
+void MemTable::add(SequenceNumber seq, ValueType type,
+                   const Slice& key, const Slice& value)
+{
+  countData(key, value);
+  char* buf = _arena->allocateAligned(encodedLength(key, value));
+  _skiplist.insert(encode(buf, seq, type, key, value));
+}
+
+void MemTable::addConcurrently(SequenceNumber seq, ValueType type,
+                               const Slice& key, const Slice& value)
+{
+  countData(key, value);
+  char* buf = _arena->allocateAlignedConcurrent(encodedLength(key, value));
+  _skiplist.insertConcurrently(encode(buf, seq, type, key, value));
 }
 
 bool MemTable::get(LookUpKey& key, std::string* value, bool& found)
@@ -38,12 +100,20 @@ bool MemTable::get(LookUpKey& key, std::string* value, bool& found)
     printError("found not true");
     return false;
   }
-  /* Find key */
+  /* Entries of one user key are in ascending seq order, find the
+     newest one whose seq is not greater than key's seq */
   Slice findKey = key.getKey();
-  Slice result = _skiplist.contains(findKey);
+  SkipList<Slice, InternalComparator>::Iterator iter(&_skiplist);
+  iter.seek(findKey);
+  if (!iter.valid()) {
+    iter.seekToLast();
+  } else if (_skiplist._comparator.cmp(iter.key(), findKey) > 0) {
+    iter.prev();
+  }
 
-  if (result.empty()) return false;
+  if (!iter.valid()) return false;
 
+  Slice result = iter.key();
   Slice decodedKey = decodeKey(result);
   size_t decodedKeyLen = decodedKey.size();
 
@@ -58,7 +128,7 @@ bool MemTable::get(LookUpKey& key, std::string* value, bool& found)
 
   switch (t)
   {
-    case TypeForSeek:
+    case TypeValue:
     {
       Slice v = decodeValue(result);
       value->assign(v.data(),v.size());
@@ -74,4 +144,4 @@ bool MemTable::get(LookUpKey& key, std::string* value, bool& found)
   return true;
 }
 
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 #define YUNDB_DB_MEMTABLE_H
 // Header guard standardized to YUNDB_DB_MEMTABLE_H
 
+#include "yundb/iterator.h"
 #include "yundb/slice.h"
 #include "yundb/comparator.h"
 #include "yundb/options.h"
@@ -98,6 +99,10 @@ class Iter
   // Typically value will be empty if type==kTypeDeletion.
   void add(SequenceNumber seq, ValueType type, 
            const Slice& key, const Slice& value);
+  // Same as add, but several threads may call it at the same time.
+  // Must not overlap with add.
+  void addConcurrently(SequenceNumber seq, ValueType type,
+                       const Slice& key, const Slice& value);
   // If memtable contains a value for key, store it in *value and return true.
   // If memtable contains a deletion for key, set flase for found
   // and return true. Else, return false.
@@ -114,6 +119,9 @@ class Iter
   // Get the level 0 iter
   Iter iter() const
   {return Iter(&_skiplist);}
+  // Return an iterator over the memtable, keys are internal keys.
+  // The memtable must outlive the iterator
+  Iterator* newIterator() const;
   int getKvCount() const
   {return _kv_count.load(std::memory_order_relaxed);}
   size_t getKvSize() const
@@ -127,6 +135,10 @@ class Iter
     _kv_count.fetch_add(1, std::memory_order_relaxed);
     _kv_size.fetch_add(key.size() + value.size(), std::memory_order_relaxed);
   }
+  static size_t encodedLength(const Slice& key, const Slice& value);
+  // Encode the entry into buf, return the part the skiplist refers
+  static Slice encode(char* buf, SequenceNumber seq, ValueType type,
+                      const Slice& key, const Slice& value);
   Options _options;
   std::atomic<int> _ref;
   std::atomic<int> _kv_count;
@@ -0,0 +1,176 @@
+#include "merging_iterator.h"
+#include "dbformat.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace yundb
+{
+
+// Keep the valid children in a binary heap ordered by their current key,
+// a min heap when moving forward and a max heap when moving backward.
+// The top of the heap is the current child, so next() and prev() cost
+// O(log n) comparisons instead of a scan over all children.
+class MergingIterator : public Iterator
+{
+ public:
+  MergingIterator(const Comparator* comparator, Iterator** children, int n)
+        : _comparator(comparator),
+          _children(children, children + n),
+          _current(nullptr),
+          _direction(Forward)
+  {
+    _heap.reserve(n);
+  }
+
+  MergingIterator(const MergingIterator&) = delete;
+  MergingIterator& operator=(const MergingIterator&) = delete;
+
+  ~MergingIterator() override
+  {
+    for (Iterator* child : _children) delete child;
+  }
+
+  bool valid() const override { return _current != nullptr; }
+
+  void seekToFirst() override
+  {
+    for (Iterator* child : _children) child->seekToFirst();
+    _direction = Forward;
+    buildHeap();
+  }
+
+  void seekToLast() override
+  {
+    for (Iterator* child : _children) child->seekToLast();
+    _direction = Reverse;
+    buildHeap();
+  }
+
+  void seek(const Slice& target) override
+  {
+    for (Iterator* child : _children) child->seek(target);
+    _direction = Forward;
+    buildHeap();
+  }
+
+  void next() override
+  {
+    // Ensure that all children are positioned after key().
+    // If we are moving in the forward direction, it is already
+    // true for all of the non-current children since current is
+    // the smallest child and key() == current->key().  Otherwise,
+    // we explicitly position the non-current children.
+    if (_direction != Forward) {
+      for (Iterator* child : _children)
+      {
+        if (child == _current) continue;
+        child->seek(key());
+        if (child->valid() && compareInternalKey(_comparator, key(), child->key()) == 0) {
+          child->next();
+        }
+      }
+      _direction = Forward;
+      _current->next();
+      buildHeap();
+      return;
+    }
+
+    advanceCurrent(&Iterator::next);
+  }
+
+  void prev() override
+  {
+    // Ensure that all children are positioned before key().
+    if (_direction != Reverse) {
+      for (Iterator* child : _children)
+      {
+        if (child == _current) continue;
+        child->seek(key());
+        if (child->valid()) {
+          // Child is at first entry >= key().  Step back one to be < key()
+          child->prev();
+        } else {
+          // Child has no entries >= key().  Position at last entry.
+          child->seekToLast();
+        }
+      }
+      _direction = Reverse;
+      _current->prev();
+      buildHeap();
+      return;
+    }
+
+    advanceCurrent(&Iterator::prev);
+  }
+
+  Slice key() const override { return _current->key(); }
+
+  Slice value() const override { return _current->value(); }
+
+  bool status() const override
+  {
+    for (const Iterator* child : _children)
+    {
+      if (!child->status()) return false;
+    }
+    return true;
+  }
+
+ private:
+  enum Direction { Forward, Reverse };
+
+  // Heap order, the top of the heap is the child that comes
+  // first in current direction
+  bool heapLess(const Iterator* a, const Iterator* b) const
+  {
+    int rs = compareInternalKey(_comparator, a->key(), b->key());
+    return _direction == Forward ? rs > 0 : rs < 0;
+  }
+
+  void buildHeap()
+  {
+    _heap.clear();
+    for (Iterator* child : _children)
+    {
+      if (child->valid()) _heap.push_back(child);
+    }
+
+    auto less = [this](const Iterator* a, const Iterator* b) { return heapLess(a, b); };
+    std::make_heap(_heap.begin(), _heap.end(), less);
+    _current = _heap.empty() ? nullptr : _heap.front();
+  }
+
+  // Move the top child one step in current direction and sift it back
+  void advanceCurrent(void (Iterator::*move)())
+  {
+    auto less = [this](const Iterator* a, const Iterator* b) { return heapLess(a, b); };
+    std::pop_heap(_heap.begin(), _heap.end(), less);
+    (_current->*move)();
+    if (_current->valid()) {
+      std::push_heap(_heap.begin(), _heap.end(), less);
+    } else {
+      _heap.pop_back();
+    }
+    _current = _heap.empty() ? nullptr : _heap.front();
+  }
+
+  const Comparator* const _comparator;
+  std::vector<Iterator*> _children;
+  // Valid children
+  std::vector<Iterator*> _heap;
+  Iterator* _current;
+  Direction _direction;
+};
+
+Iterator* newMergingIterator(const Comparator* comparator, Iterator** children, int n)
+{
+  if (n == 0) {
+    return newEmptyIterator();
+  } else if (n == 1) {
+    return children[0];
+  }
+  return new MergingIterator(comparator, children, n);
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef YUNDB_DB_MERGING_ITERATOR_H
+#define YUNDB_DB_MERGING_ITERATOR_H
+
+#include "yundb/comparator.h"
+#include "yundb/iterator.h"
+
+namespace yundb
+{
+
+// Return an iterator that provides the union of the data in
+// children[0,n-1]. Children yield internal keys and comparator is the
+// user key comparator. Takes ownership of the child iterators and
+// will delete them when the result iterator is deleted.
+//
+// The result does no duplicate suppression.  I.e., if a particular
+// key is present in K child iterators, it will be yielded K times.
+Iterator* newMergingIterator(const Comparator* comparator, Iterator** children, int n);
+
+}
+
+#endif // YUNDB_DB_MERGING_ITERATOR_H
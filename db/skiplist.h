@@ -4,7 +4,9 @@
 
 #include <memory>
 #include <atomic>
+#include <functional>
 #include <string>
+#include <thread>
 
 #include "util/random.h"
 #include "util/arena.h"
@@ -33,8 +35,51 @@ class SkipList
   SkipList& operator=(SkipList& other) = delete;
   /* Insert node */
   void insert(const KeyType& key);
+  /* Insert node, may run at the same time as other insertConcurrently
+     calls and readers but never at the same time as insert().
+     Every level is linked with a compare-and-swap, the arena must
+     only be used through allocateAlignedConcurrent meanwhile. */
+  void insertConcurrently(const KeyType& key);
   /* Find key if in the list */
   KeyType contains(const KeyType& key);
+
+  /* Iterate over the contents of a skiplist in both directions.
+     The skiplist must outlive the iterator */
+  class Iterator
+  {
+   public:
+    explicit Iterator(const SkipList* list) : _list(list), _node(nullptr) {}
+
+    bool valid() const { return _node != nullptr; }
+
+    /* REQUIRES: valid() */
+    KeyType key() const { return _node->getKey(); }
+
+    /* REQUIRES: valid() */
+    void next() { _node = _node->getNext(0); }
+
+    /* REQUIRES: valid() */
+    void prev()
+    {
+      _node = _list->findLessThan(_node->getKey());
+      if (_node == _list->_head) _node = nullptr;
+    }
+
+    /* Position at the first node whose key >= target */
+    void seek(const KeyType& target) { _node = _list->findGreaterOrEqual(target); }
+
+    void seekToFirst() { _node = _list->getFirstNode(); }
+
+    void seekToLast()
+    {
+      _node = _list->findLast();
+      if (_node == _list->_head) _node = nullptr;
+    }
+
+   private:
+    const SkipList* _list;
+    const Node* _node;
+  };
  private:
   /* memory pool */
   std::shared_ptr<yundb::Arena> _arena;
@@ -51,10 +96,28 @@ class SkipList
       );
       return new (node) Node(key);
   }
+  Node* newNodeConcurrently(int height, const KeyType& key)
+  {
+      char* const node = _arena->allocateAlignedConcurrent(
+        sizeof(Node) + sizeof(std::atomic<Node*>) * (height - 1)
+      );
+      return new (node) Node(key);
+  }
   Node* getFirstNode() const
   {return _head->getNext(0);}
   void findNoLessThanNodePre(Node* pre[], const KeyType& key) const;
+  /* Return the first node whose key >= key, nullptr if there is no such node */
+  Node* findGreaterOrEqual(const KeyType& key) const;
+  /* Return the last node whose key < key, _head if there is no such node */
+  Node* findLessThan(const KeyType& key) const;
+  /* Return the last node, _head if list is empty */
+  Node* findLast() const;
+  /* Starting at before, find the nodes of level that key goes between */
+  void findSpliceForLevel(const KeyType& key, Node* before, int level,
+                          Node** pre, Node** next) const;
   int randomHeight();
+  /* randomHeight with a generator per thread */
+  static int randomHeightConcurrently();
   void doInsert(Node* pre[], const KeyType& key);
   int getMaxHeight() const
   {return _max_height.load(std::memory_order_relaxed);}
@@ -91,6 +154,12 @@ class SkipList<KeyType, InternalComparator>::Node
     if (level < 0) printError("level is negative");
     _next[level].store(next, std::memory_order_relaxed);
   }
+  /* Set next only if it is still expected */
+  bool casNext(int level, Node* expected, Node* next)
+  {
+    if (level < 0) printError("level is negative");
+    return _next[level].compare_exchange_strong(expected, next, std::memory_order_acq_rel);
+  }
   KeyType getKey() const
   {return _key;}
  private:
@@ -128,6 +197,18 @@ int SkipList<KeyType, InternalComparator>::randomHeight()
   return height;
 }
 
+template <typename KeyType, typename InternalComparator>
+int SkipList<KeyType, InternalComparator>::randomHeightConcurrently()
+{
+  constexpr int Brancing = 4;
+  static thread_local Random rand(
+    static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+  int height = 1;
+  while (rand.OneIn(Brancing) && height < MaxHeight)
+    height++;
+  return height;
+}
+
 /* Find the node pre that no less than key  */
 template <typename KeyType, typename InternalComparator>
 void SkipList<KeyType, InternalComparator>::findNoLessThanNodePre(
@@ -148,7 +229,7 @@ void SkipList<KeyType, InternalComparator>::findNoLessThanNodePre(
     int rs = _comparator.cmp(key, next->getKey());
 
     if (rs > 0) cur = next;
-    else if (rs < 0)
+    else
     {
       pre[level] = cur;
       level -= 1;
@@ -156,6 +237,83 @@ void SkipList<KeyType, InternalComparator>::findNoLessThanNodePre(
   }
 }
 
+template <typename KeyType, typename InternalComparator>
+typename SkipList<KeyType, InternalComparator>::Node*
+SkipList<KeyType, InternalComparator>::findGreaterOrEqual(const KeyType& key) const
+{
+  Node* cur = _head;
+  int level = getMaxHeight() - 1;
+
+  while (true)
+  {
+    Node* next = cur->getNext(level);
+    if (next != nullptr && _comparator.cmp(next->getKey(), key) < 0) {
+      cur = next;
+    } else if (level == 0) {
+      return next;
+    } else {
+      level -= 1;
+    }
+  }
+}
+
+template <typename KeyType, typename InternalComparator>
+typename SkipList<KeyType, InternalComparator>::Node*
+SkipList<KeyType, InternalComparator>::findLessThan(const KeyType& key) const
+{
+  Node* cur = _head;
+  int level = getMaxHeight() - 1;
+
+  while (true)
+  {
+    Node* next = cur->getNext(level);
+    if (next != nullptr && _comparator.cmp(next->getKey(), key) < 0) {
+      cur = next;
+    } else if (level == 0) {
+      return cur;
+    } else {
+      level -= 1;
+    }
+  }
+}
+
+template <typename KeyType, typename InternalComparator>
+typename SkipList<KeyType, InternalComparator>::Node*
+SkipList<KeyType, InternalComparator>::findLast() const
+{
+  Node* cur = _head;
+  int level = getMaxHeight() - 1;
+
+  while (true)
+  {
+    Node* next = cur->getNext(level);
+    if (next != nullptr) {
+      cur = next;
+    } else if (level == 0) {
+      return cur;
+    } else {
+      level -= 1;
+    }
+  }
+}
+
+template <typename KeyType, typename InternalComparator>
+void SkipList<KeyType, InternalComparator>::findSpliceForLevel(
+    const KeyType& key, Node* before, int level, Node** pre, Node** next) const
+{
+  while (true)
+  {
+    Node* after = before->getNext(level);
+    if (after != nullptr && _comparator.cmp(after->getKey(), key) < 0) {
+      before = after;
+    } else {
+      *pre = before;
+      *next = after;
+      return;
+    }
+  }
+}
+
 /* Do the actually insert */
 template <typename KeyType, typename InternalComparator>
 void SkipList<KeyType, InternalComparator>::doInsert(Node* pre[], const KeyType& key)
@@ -186,6 +344,46 @@ void SkipList<KeyType, InternalComparator>::insert(const KeyType& key)
   doInsert(pre, key);
 }
 
+template <typename KeyType, typename InternalComparator>
+void SkipList<KeyType, InternalComparator>::insertConcurrently(const KeyType& key)
+{
+  const int height = randomHeightConcurrently();
+  Node* node = newNodeConcurrently(height, key);
+
+  /* Readers that see the new height before the head is linked at it
+     just move down from a null next */
+  int maxHeight = getMaxHeight();
+  while (height > maxHeight)
+  {
+    if (_max_height.compare_exchange_weak(maxHeight, height, std::memory_order_relaxed)) {
+      maxHeight = height;
+      break;
+    }
+  }
+
+  Node* pre[MaxHeight];
+  Node* next[MaxHeight];
+  Node* before = _head;
+  for (int level = maxHeight - 1; level >= 0; level--)
+  {
+    findSpliceForLevel(key, before, level, &pre[level], &next[level]);
+    before = pre[level];
+  }
+
+  /* Link bottom up, so the node is reachable at level 0 first. A failed
+     swap means another node went in between, which can only be after
+     pre[level] as nodes are never removed */
+  for (int level = 0; height > level; level++)
+  {
+    while (true)
+    {
+      node->noBarrierSetNext(level, next[level]);
+      if (pre[level]->casNext(level, next[level], node)) break;
+      findSpliceForLevel(key, pre[level], level, &pre[level], &next[level]);
+    }
+  }
+}
+
 template <typename KeyType, typename InternalComparator>
 KeyType SkipList<KeyType, InternalComparator>::contains(const KeyType& key)
 {
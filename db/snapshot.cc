@@ -6,7 +6,7 @@ namespace yundb
 SnapshotImpl::SnapshotImpl(SequenceNumber seq, SnapshotImpl* pre, SnapshotImpl* next)
       : _seq(seq),
         _pre(pre),
-        _next(pre){}
+        _next(next){}
 
 SnapshotImpl::~SnapshotImpl(){}
 
@@ -44,6 +44,7 @@ bool SnapshotList::remove(SnapshotImpl* snapshot)
       snapshot->_next->_pre = snapshot->_pre;
       return true;
     }
+    cur = cur->_pre;
   }
 
   return false;
@@ -12,6 +12,8 @@ class SnapshotImpl : public Snapshot
  public:
   SnapshotImpl(SequenceNumber seq, SnapshotImpl* pre, SnapshotImpl* next);
   ~SnapshotImpl() override;
+
+  SequenceNumber getSequenceNumber() const { return _seq; }
  private:
   friend class SnapshotList;
   SnapshotImpl* _pre;
@@ -30,6 +32,10 @@ class SnapshotList
   bool remove(SnapshotImpl* snapshot);
 
   bool empty();
+
+  // Sequence of the oldest snapshot.
+  // REQUIRES: list is not empty
+  SequenceNumber oldest() const { return _dummy._next->_seq; }
  private:
   // node<->node<->...<->_dummy
   SnapshotImpl _dummy;
@@ -4,15 +4,90 @@
 #include "util/error_print.h"
 #include "dbformat.h"
 #include "util/crc32c.h"
+#include "util/sync.h"
+
+#include <cassert>
+#include <deque>
+#include <thread>
 
 namespace yundb
 {
 
-SstableBuilder::SstableBuilder(Options& options, WritableFile* file)
+// A data block handed to the compression threads
+struct SstableBuilder::BlockRep
+{
+  std::string raw;
+  std::string compressed;
+  // The block to write, refers to raw or compressed once done
+  Slice contents;
+  char trailer[BlockTrailerSize];
+  // Index key of the block
+  std::string minKey;
+  bool done;
+};
+
+struct SstableBuilder::ParallelRep
+{
+  explicit ParallelRep(CompressionType type)
+      : compression(type),
+        workSignal(&mutex),
+        doneSignal(&mutex),
+        shutdown(false) {}
+
+  const CompressionType compression;
+  sync::Mutex mutex;
+  // Signaled when a block is queued or the threads should stop
+  sync::CondVar workSignal;
+  // Signaled when a block is compressed
+  sync::CondVar doneSignal;
+  // Blocks no compression thread has taken yet
+  std::deque<BlockRep*> toCompress;
+  bool shutdown;
+  // Every scheduled block that is not written yet, in file order.
+  // Only touched by the building thread.
+  std::deque<std::unique_ptr<BlockRep>> inFlight;
+  std::vector<std::thread> threads;
+};
+
+// Compress raw with type when that saves enough space. *result refers to
+// the block to write, the returned type is how it is stored.
+static CompressionType compressBlock(CompressionType type, const Slice& raw,
+                                     std::string* compressed, Slice* result)
+{
+  *result = raw;
+  switch (type)
+  {
+    case NoCompression:
+      break;
+    case SnappyCompression:
+    {
+      if (Snappy_Compress(raw.data(), raw.size(), compressed) &&
+          compressed->size() < raw.size() - (raw.size() / 8u)) {
+        *result = *compressed;
+        return SnappyCompression;
+      }
+      break;
+    }
+  }
+  return NoCompression;
+}
+
+static void computeTrailer(const Slice& block, CompressionType type, char* trailer)
+{
+  trailer[0] = type;
+  uint32_t crc = crc32c::Value(block.data(), block.size());
+  crc = crc32c::Extend(crc, trailer, 1);
+  EncodeFixed32(trailer + 1, crc32c::Mask(crc));
+}
+
+SstableBuilder::SstableBuilder(const Options& options, WritableFile* file)
     : _cur_block_position(0),
+      _pending_bytes(0),
+      _num_entries(0),
+      _closed(false),
       _options(options),
       _file(file),
-      _filter_block_builder(options.filter_policy),
+      _filter_block_builder(options.filter_policy, options.prefix_extractor),
       _data_block_builder(options),
       _index_block_builder(options)
 {
@@ -21,50 +96,43 @@ SstableBuilder::SstableBuilder(Options& options, WritableFile* file)
   Options tmpOption = options;
   tmpOption.block_restart_interval = 1;
   _index_block_builder.changeOptions(tmpOption);
+
+  if (options.compression_parallel_threads > 1)
+  {
+    _parallel.reset(new ParallelRep(options.compression));
+    for (int i = 0; options.compression_parallel_threads > i; i++) {
+      _parallel->threads.emplace_back(&SstableBuilder::compressionThreadEntry,
+                                      _parallel.get());
+    }
+  }
 }
 
-SstableBuilder::~SstableBuilder() {}
+SstableBuilder::~SstableBuilder()
+{
+  assert(_closed);
+  if (_parallel != nullptr) stopCompressionThreads();
+}
 
 size_t SstableBuilder::writeBlock(const Slice& block)
 {
-  auto type = _options.compression;
-  std::string compressionBlock;
+  std::string compressed;
   Slice writeData;
-
-  switch (type)
-  {
-    case NoCompression:
-    {
-      writeData = block;
-      break;
-    }
-    case SnappyCompression:
-    {
-      if (Snappy_Compress(block.data(), block.size(), &compressionBlock) && 
-          compressionBlock.size() < block.size() - (block.size() / 8u)) {
-        writeData = compressionBlock; 
-      } else {
-        writeData = block;
-        type = NoCompression;
-      }
-      break;
-    }
-  } 
-
+  CompressionType type = compressBlock(_options.compression, block,
+                                       &compressed, &writeData);
   return writeRawBlock(writeData, type);
 }
 
 size_t SstableBuilder::writeRawBlock(const Slice& block, CompressionType type)
 {
-  // Write blcok
-  _file->append(block);
-  // Init trailer
   char trailer[BlockTrailerSize];
-  trailer[0] = type;
-  uint32_t crc = crc32c::Value(block.data(), block.size());
-  crc = crc32c::Extend(crc, trailer, 1);
-  EncodeFixed32(trailer + 1, crc32c::Mask(crc));
-  // Write trailer
+  computeTrailer(block, type, trailer);
+  return appendBlock(block, trailer);
+}
+
+size_t SstableBuilder::appendBlock(const Slice& block, const char* trailer)
+{
+  // Write blcok and trailer
+  _file->append(block);
   _file->append(Slice(trailer, BlockTrailerSize));
   // Update position
   _cur_block_position += block.size() + BlockTrailerSize;
@@ -75,43 +143,164 @@ void SstableBuilder::flushBlock()
 {
   // Put restart_ptrs
   std::string block = _data_block_builder.finish();
+  std::string minKey = _data_block_builder.getMinKeyAndClear();
+  // Generate filter, a whole table filter is generated by finish()
+  if (!_options.whole_table_filter) _filter_block_builder.generateFilter();
+
+  if (_parallel != nullptr) {
+    scheduleBlock(std::move(block), std::move(minKey));
+    return;
+  }
   auto oldBlockPos = _cur_block_position;
   // Put index entry = | data block min key | position && data block size |
-  _index_block_builder.put(_data_block_builder.getMinKeyAndClear(),
-                           _handle_builder.encode(oldBlockPos, writeBlock(block)));
-  // Generate filter
-  _filter_block_builder.generateFilter();
+  _index_block_builder.put(minKey, _handle_builder.encode(oldBlockPos, writeBlock(block)));
 }
 
-void SstableBuilder::build(const MemTable* memtable)
+void SstableBuilder::scheduleBlock(std::string block, std::string minKey)
 {
-  auto iter = memtable->iter();
+  std::unique_ptr<BlockRep> rep(new BlockRep);
+  rep->raw.swap(block);
+  rep->minKey.swap(minKey);
+  rep->done = false;
+  _pending_bytes += rep->raw.size() + BlockTrailerSize;
+  {
+    sync::LockGuard<sync::Mutex> lock(_parallel->mutex);
+    _parallel->toCompress.push_back(rep.get());
+    _parallel->workSignal.signal();
+  }
+  _parallel->inFlight.push_back(std::move(rep));
+
+  // Bound the memory of the blocks waiting to be written
+  writeCompressedBlocks(2 * _parallel->threads.size());
+}
 
-  while(!iter.empty())
+void SstableBuilder::writeCompressedBlocks(size_t maxInFlight)
+{
+  auto& inFlight = _parallel->inFlight;
+  while (!inFlight.empty())
   {
-    // Trying put key and value
-    if (_data_block_builder.assumeBlockSize(iter.getKey(), iter.getValue()) >=
-        _options.block_size) {
-      flushBlock();
+    BlockRep* rep = inFlight.front().get();
+    {
+      sync::LockGuard<sync::Mutex> lock(_parallel->mutex);
+      while (!rep->done)
+      {
+        if (maxInFlight >= inFlight.size()) return;
+        _parallel->doneSignal.wait();
+      }
     }
-    // Put key value pair
-    _data_block_builder.put(iter.getKey(), iter.getValue());
-    _filter_block_builder.addKey(iter.getUserKey());
-    iter++;
+
+    // The block offsets are only known here, so the index is filled in
+    // as the blocks are written
+    auto oldBlockPos = _cur_block_position;
+    size_t written = appendBlock(rep->contents, rep->trailer);
+    _index_block_builder.put(rep->minKey, _handle_builder.encode(oldBlockPos, written));
+    _pending_bytes -= rep->raw.size() + BlockTrailerSize;
+    inFlight.pop_front();
+  }
+}
+
+void SstableBuilder::stopCompressionThreads()
+{
+  {
+    sync::LockGuard<sync::Mutex> lock(_parallel->mutex);
+    _parallel->shutdown = true;
+    _parallel->workSignal.signalAll();
   }
-  
+  for (auto& thread : _parallel->threads) {
+    thread.join();
+  }
+  _parallel->threads.clear();
+  _parallel->toCompress.clear();
+  _parallel->inFlight.clear();
+  _pending_bytes = 0;
+}
+
+void SstableBuilder::compressionThreadEntry(ParallelRep* rep)
+{
+  rep->mutex.Lock();
+  while (true)
+  {
+    while (!rep->shutdown && rep->toCompress.empty()) {
+      rep->workSignal.wait();
+    }
+    if (rep->shutdown) break;
+
+    BlockRep* block = rep->toCompress.front();
+    rep->toCompress.pop_front();
+    rep->mutex.unlock();
+
+    CompressionType type = compressBlock(rep->compression, block->raw,
+                                         &block->compressed, &block->contents);
+    computeTrailer(block->contents, type, block->trailer);
+
+    rep->mutex.Lock();
+    block->done = true;
+    // Only the building thread waits
+    rep->doneSignal.signal();
+  }
+  rep->mutex.unlock();
+}
+
+void SstableBuilder::add(const Slice& key, const Slice& value)
+{
+  assert(!_closed);
+  // Trying put key and value
+  if (_data_block_builder.getSize() != 0 &&
+      _data_block_builder.assumeBlockSize(key, value) >= _options.block_size) {
+    flushBlock();
+  }
+  // Put key value pair
+  _data_block_builder.put(key, value);
+  _filter_block_builder.addKey(Slice(key.data(), key.size() - KeyTagSize));
+  _num_entries++;
+}
+
+void SstableBuilder::abandon()
+{
+  assert(!_closed);
+  _closed = true;
+  if (_parallel != nullptr) stopCompressionThreads();
+}
+
+void SstableBuilder::build(const MemTable* memtable)
+{
+  for (auto iter = memtable->iter(); !iter.empty(); iter++) {
+    add(iter.getKey(), iter.getValue());
+  }
+  finish();
+}
+
+void SstableBuilder::finish()
+{
+  assert(!_closed);
+  _closed = true;
   if (_data_block_builder.getSize() != 0) {
     flushBlock();
   }
+  if (_parallel != nullptr)
+  {
+    writeCompressedBlocks(0);
+    stopCompressionThreads();
+  }
 
   // Write filter block
+  std::string filterHandle;
+  if (_options.whole_table_filter)
+  {
+    if (!_filter_block_builder.empty()) _filter_block_builder.generateFilter();
+    filterHandle = WholeTableFilterPrefix;
+  }
   size_t oldBlockPos = _cur_block_position;
   Slice filterBlock = _filter_block_builder.finish();
-  std::string filterHandle(_options.filter_policy->Name());
+  filterHandle += _options.filter_policy->Name();
   filterHandle += _handle_builder.encode(oldBlockPos, writeRawBlock(filterBlock, NoCompression));
 
   // Write meta index block
   oldBlockPos = _cur_block_position;
+  if (_options.prefix_extractor != nullptr) {
+    // The filter also holds the prefixes of this extractor
+    PutLengthPrefixedSlice(&filterHandle, _options.prefix_extractor->name());
+  }
   std::string metaIndexHandle =
     _handle_builder.encode(oldBlockPos, writeRawBlock(filterHandle, NoCompression));
 
@@ -126,7 +315,8 @@ void SstableBuilder::build(const MemTable* memtable)
   std::string footerBlock;
   footer.encodeTo(&footerBlock, metaIndexHandle, indexBlockHandle);
   writeRawBlock(footerBlock, NoCompression);
-  _file->flush();
+  // Table files are installed into a version right after they are built
+  _file->sync();
 }
 
 }
\ No newline at end of file
@@ -9,28 +9,76 @@
 #include "block_builder.h"
 #include "table_format.h"
 
+#include <memory>
+
 namespace yundb
 {
 
 class SstableBuilder
 {
  public:
-  SstableBuilder(Options& options, WritableFile* file);
+  SstableBuilder(const Options& options, WritableFile* file);
   SstableBuilder(SstableBuilder& other) = delete;
+  // REQUIRES: Either finish() or abandon() has been called.
   ~SstableBuilder();
-  // Builde sstable
+
+  // Add key,value to the table being constructed. key is an internal key.
+  // REQUIRES: key is after any previously added key in internal key order.
+  // REQUIRES: finish(), abandon() have not been called
+  void add(const Slice& key, const Slice& value);
+
+  // Finish building the table: write the last data block, the filter,
+  // meta index and index blocks and the footer, then sync the file.
+  // REQUIRES: finish(), abandon() have not been called
+  void finish();
+
+  // Indicate that the contents of this builder should be abandoned.
+  // The file is left as it is, the caller is expected to remove it.
+  // REQUIRES: finish(), abandon() have not been called
+  void abandon();
+
+  // Number of calls to add() so far.
+  uint64_t numEntries() const { return _num_entries; }
+
+  // Size of the file generated so far. If invoked after a successful
+  // finish() call, returns the size of the final generated file.
+  // The data block being built is not counted until it is full, blocks
+  // that are still being compressed are counted with their raw size.
+  uint64_t fileSize() const { return _cur_block_position + _pending_bytes; }
+
+  // Add every entry of memtable and finish the table
   void build(const MemTable* memtable);
  private:
+  struct BlockRep;
+  struct ParallelRep;
+
   size_t writeBlock(const Slice& block);
   size_t writeRawBlock(const Slice& block, CompressionType type);
+  // Append a block and its trailer, return the bytes written
+  size_t appendBlock(const Slice& block, const char* trailer);
   void flushBlock();
+  // Hand the data block to the compression threads
+  void scheduleBlock(std::string block, std::string minKey);
+  // Write the compressed blocks at the head of the queue in file order.
+  // Waits until at most maxInFlight scheduled blocks are left unwritten.
+  void writeCompressedBlocks(size_t maxInFlight);
+  // Stop and join the compression threads
+  void stopCompressionThreads();
+  static void compressionThreadEntry(ParallelRep* rep);
   uint64_t _cur_block_position;
+  // Raw bytes of the blocks handed to the compression threads
+  uint64_t _pending_bytes;
+  uint64_t _num_entries;
+  // Either finish() or abandon() has been called.
+  bool _closed;
   Options _options;
   std::unique_ptr<WritableFile> _file;
   BlockHandle _handle_builder;
   FilterBlockBuilder _filter_block_builder;
   DataBlockBuilder _data_block_builder;
   DataBlockBuilder _index_block_builder;
+  // Set when options.compression_parallel_threads > 1
+  std::unique_ptr<ParallelRep> _parallel;
 };
 
 }
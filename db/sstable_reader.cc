@@ -1,19 +1,445 @@
 #include "sstable_reader.h"
 
-#include "util/file_name.h"
 #include "util/error_print.h"
-#include "table_format.h"
+#include "block_reader.h"
+#include "block_readahead.h"
+#include "dbformat.h"
+#include "yundb/comparator.h"
+#include "yundb/filter_policy.h"
+#include "yundb/slice_transform.h"
+#include "util/coding.h"
+
+#include <cstring>
 
 namespace yundb
 {
 
-SstableReader::SstableReader(const Options& options, std::string fileName)
+SstableReader::SstableReader(const Options& options, RandomAccessFile* file,
+                             uint64_t fileSize)
       : _options(options),
-        _fileName(fileName)
+        _fileSize(fileSize),
+        _randomFile(file),
+        _wholeTableFilter(false),
+        _prefixFiltered(false)
 {
- 
+  if (_randomFile == nullptr) printError("SstableReader: file is null");
 }
 
 SstableReader::~SstableReader() {}
 
-}
\ No newline at end of file
+// Iterate a table by walking the index block and the data block its
+// current entry points to. Index block shares the data block format
+// (restart interval 1) so both levels use BlockIterator.
+class TableIterator : public Iterator
+{
+ public:
+  TableIterator(const SstableReader* reader, const Comparator* comparator,
+                bool prefixSameAsStart, size_t fixedReadahead, size_t maxReadahead)
+        : _reader(reader),
+          _comparator(comparator),
+          _prefixSameAsStart(prefixSameAsStart),
+          _indexIter(comparator, reader->indexBlock()),
+          _readahead(reader->file(), reader->fileSize(), fixedReadahead, maxReadahead),
+          _error(false) {}
+
+  TableIterator(const TableIterator&) = delete;
+  TableIterator& operator=(const TableIterator&) = delete;
+
+  ~TableIterator() override = default;
+
+  bool valid() const override { return _dataIter != nullptr && _dataIter->valid(); }
+
+  void seekToFirst() override
+  {
+    _indexIter.seekToFirst();
+    if (initDataBlock()) _dataIter->seekToFirst();
+    skipEmptyDataBlocksForward();
+  }
+
+  void seekToLast() override
+  {
+    _indexIter.seekToLast();
+    if (initDataBlock(false)) _dataIter->seekToLast();
+    skipEmptyDataBlocksBackward();
+  }
+
+  void seek(const Slice& target) override
+  {
+    if (_prefixSameAsStart && !_reader->prefixMayMatch(target)) {
+      // No key of target's prefix, the iterator is only used up to the
+      // end of that prefix
+      _dataIter.reset();
+      return;
+    }
+
+    // Index keys are the min keys of data blocks, so target falls in the
+    // last block whose min key is not greater than target
+    _indexIter.seek(target);
+    if (!_indexIter.valid()) {
+      _indexIter.seekToLast();
+    } else if (compareInternalKey(_comparator, _indexIter.key(), target) > 0) {
+      _indexIter.prev();
+      if (!_indexIter.valid()) _indexIter.seekToFirst();
+    }
+
+    if (initDataBlock()) _dataIter->seek(target);
+    skipEmptyDataBlocksForward();
+  }
+
+  void next() override
+  {
+    _dataIter->next();
+    skipEmptyDataBlocksForward();
+  }
+
+  void prev() override
+  {
+    _dataIter->prev();
+    skipEmptyDataBlocksBackward();
+  }
+
+  Slice key() const override { return _dataIter->key(); }
+
+  Slice value() const override { return _dataIter->value(); }
+
+  bool status() const override { return !_error; }
+
+ private:
+  // Load the data block of current index entry, forward is false when
+  // the iterator moves towards the first block.
+  // Return false at the end of index block or on read error
+  bool initDataBlock(bool forward = true)
+  {
+    if (!_indexIter.valid()) {
+      _dataIter.reset();
+      return false;
+    }
+
+    Slice handleValue = _indexIter.value();
+    if (_dataIter != nullptr && handleValue == Slice(_dataBlockHandle)) {
+      return true;
+    }
+
+    BlockHandle handle;
+    handle.decodeFrom(handleValue.data());
+    _dataIter.reset();
+    Slice contents;
+    if (!_reader->readBlock({handle.getPosition(), handle.getSize()}, &contents,
+                            &_dataBlock, &_readahead, forward)) {
+      printError("TableIterator: read data block error");
+      _error = true;
+      return false;
+    }
+
+    _dataBlockHandle.assign(handleValue.data(), handleValue.size());
+    _dataIter.reset(new BlockIterator(_comparator, contents));
+    return true;
+  }
+
+  void skipEmptyDataBlocksForward()
+  {
+    while (_dataIter != nullptr && !_dataIter->valid())
+    {
+      _indexIter.next();
+      if (!initDataBlock()) return;
+      _dataIter->seekToFirst();
+    }
+  }
+
+  void skipEmptyDataBlocksBackward()
+  {
+    while (_dataIter != nullptr && !_dataIter->valid())
+    {
+      _indexIter.prev();
+      if (!initDataBlock(false)) return;
+      _dataIter->seekToLast();
+    }
+  }
+
+  const SstableReader* const _reader;
+  const Comparator* const _comparator;
+  // Skip the table on seek() when its filter rules out the prefix
+  const bool _prefixSameAsStart;
+  BlockIterator _indexIter;
+  // Handle of the block loaded in _dataIter
+  std::string _dataBlockHandle;
+  // Contents of the block unless they are read from the mapping in place
+  std::string _dataBlock;
+  std::unique_ptr<BlockIterator> _dataIter;
+  BlockReadahead _readahead;
+  // Set once a data block can not be read
+  bool _error;
+};
+
+bool SstableReader::readBlock(const PosAndSize& p, std::string* result) const
+{
+  Slice contents;
+  if (!readBlock(p, &contents, result)) return false;
+  // Copy a block that points into the mapping
+  if (contents.data() != result->data()) result->assign(contents.data(), contents.size());
+  return true;
+}
+
+bool SstableReader::readBlock(const PosAndSize& p, Slice* result, std::string* scratch,
+                              BlockReadahead* readahead, bool forward) const
+{
+  Slice block;
+  if (readahead != nullptr) {
+    if (!readahead->read(p, &block, forward)) {
+      printError("SstableReader: read block error");
+      return false;
+    }
+  } else {
+    // Mapped files do not use the scratch
+    if (!_randomFile->isMemoryMapped()) scratch->resize(p.second);
+    if (!_randomFile->read(p.first, &block, &(*scratch)[0], p.second)) {
+      printError("SstableReader: read block error");
+      return false;
+    }
+  }
+
+  return blockContents(block, result, scratch);
+}
+
+void SstableReader::readBlocks(const PosAndSize* blocks, int n, Slice* results,
+                               std::string* scratches, bool* ok) const
+{
+  const bool mapped = _randomFile->isMemoryMapped();
+  std::vector<ReadRequest> requests(n);
+  for (int i = 0; n > i; i++)
+  {
+    requests[i].offset = blocks[i].first;
+    requests[i].bytes = blocks[i].second;
+    if (!mapped) scratches[i].resize(blocks[i].second);
+    requests[i].scratch = &scratches[i][0];
+  }
+  _randomFile->multiRead(requests.data(), n);
+
+  for (int i = 0; n > i; i++)
+  {
+    ok[i] = requests[i].ok && requests[i].result.size() == blocks[i].second;
+    if (!ok[i]) {
+      printError("SstableReader: read block error");
+      continue;
+    }
+    ok[i] = blockContents(requests[i].result, &results[i], &scratches[i]);
+  }
+}
+
+bool SstableReader::blockContents(const Slice& block, Slice* result, std::string* scratch) const
+{
+  if (block.size() < BlockTrailerSize) {
+    printError("SstableReader: block size less than trailer size");
+    return false;
+  }
+
+  const CompressionType type = checkBlock(block);
+  if (type == NoCompression)
+  {
+    const size_t size = block.size() - BlockTrailerSize;
+    if (block.data() == scratch->data()) {
+      // Read into scratch, drop the trailer in place
+      scratch->resize(size);
+      *result = Slice(*scratch);
+      return true;
+    }
+    if (_randomFile->isMemoryMapped()) {
+      // The mapping lives as long as this reader
+      *result = Slice(block.data(), size);
+      return true;
+    }
+  }
+
+  std::string contents = uncompressBlock(block, type);
+  scratch->swap(contents);
+  *result = Slice(*scratch);
+  return true;
+}
+
+bool SstableReader::readFilterBlock(const Footer& footer)
+{
+  std::string metaIndexBlock;
+  if (!readBlock(footer.getMetaIndexPosAndSize(), &metaIndexBlock)) {
+    printError("SstableReader: read meta index block error");
+    return false;
+  }
+
+  Slice meta(metaIndexBlock);
+  const size_t prefixSize = sizeof(WholeTableFilterPrefix) - 1;
+  if (meta.size() >= prefixSize &&
+      std::memcmp(meta.data(), WholeTableFilterPrefix, prefixSize) == 0) {
+    _wholeTableFilter = true;
+    meta.removePrefix(prefixSize);
+  }
+
+  const char* ptr = _options.filter_policy->Name();
+  size_t filterNameSize = std::strlen(ptr);
+
+  if (meta.size() < filterNameSize ||
+      std::memcmp(meta.data(), ptr, filterNameSize) != 0) {
+    // Built with another filter policy, read the table without a filter
+    _wholeTableFilter = false;
+    return true;
+  }
+
+  BlockHandle filterBlockHandle;
+  const char* handleEnd = filterBlockHandle.decodeFrom(meta.data() + filterNameSize);
+
+  // The name of the prefix extractor whose prefixes are in the filter
+  Slice rest(handleEnd, meta.data() + meta.size() - handleEnd);
+  Slice extractorName;
+  _prefixFiltered = _options.prefix_extractor != nullptr &&
+                    GetLengthPrefixedSlice(&rest, &extractorName) &&
+                    extractorName == Slice(_options.prefix_extractor->name());
+
+  if (!readBlock({filterBlockHandle.getPosition(), filterBlockHandle.getSize()},
+                 &_filterBlock)) {
+    printError("SstableReader: read filter block error");
+    return false;
+  }
+
+  _filter.reset(new FilterBlockReader(_options.filter_policy, Slice(_filterBlock)));
+  return true;
+}
+
+bool SstableReader::open()
+{
+  if (_fileSize < Footer::MaxFooterSize + BlockTrailerSize) {
+    printError("SstableReader: file size less than footer size");
+    return false;
+  }
+
+  std::string footerBlock;
+  if (!readBlock({_fileSize - Footer::MaxFooterSize - BlockTrailerSize,
+                  Footer::MaxFooterSize + BlockTrailerSize}, &footerBlock)) {
+    printError("SstableReader: read footer error");
+    return false;
+  }
+
+  Footer footer(footerBlock);
+
+  if (!readFilterBlock(footer)) {
+    return false;
+  }
+
+  if (!readBlock(footer.getIndexBlockPosAndSize(), &_indexBlock)) {
+    printError("SstableReader: read index block error");
+    return false;
+  }
+
+  return true;
+}
+
+Iterator* SstableReader::newIterator(const ReadOptions& options) const
+{
+  return new TableIterator(this, _options.comparator,
+                           options.prefix_same_as_start && _prefixFiltered,
+                           options.readahead_size, _options.max_auto_readahead_size);
+}
+
+bool SstableReader::prefixMayMatch(const Slice& target) const
+{
+  Slice userKey(target.data(), target.size() - KeyTagSize);
+  if (!_prefixFiltered || !_options.prefix_extractor->inDomain(userKey)) return true;
+
+  Slice prefix = _options.prefix_extractor->transform(userKey);
+  if (prefix.empty()) return true;
+  if (_wholeTableFilter) return _filter->keyMayMatch(0, prefix);
+
+  IndexBlockIterator indexIter(_indexBlock.data(),
+                               _indexBlock.data() + _indexBlock.size(), _options);
+  indexIter.seek(target);
+  // Target is before the first block
+  if (!indexIter.valid()) indexIter.seekToFirst();
+  if (!indexIter.valid()) return true;
+  if (_filter->keyMayMatch(indexIter.index(), prefix)) return true;
+
+  // The first key at or past target may be the first key of the next block
+  indexIter.next();
+  return indexIter.valid() && _filter->keyMayMatch(indexIter.index(), prefix);
+}
+
+bool SstableReader::internalGet(const Slice& key, void* arg,
+                                void (*handleResult)(void* arg, const Slice& k,
+                                                     const Slice& v)) const
+{
+  Slice userKey = key;
+  userKey.removeTailfix(KeyTagSize);
+  if (!tableMayMatch(userKey)) return false;
+
+  IndexBlockIterator indexIter(_indexBlock.data(),
+                               _indexBlock.data() + _indexBlock.size(), _options);
+  indexIter.seek(key);
+  if (!indexIter.valid() || !keyMayMatch(indexIter.index(), userKey)) {
+    return false;
+  }
+
+  BlockHandle handle;
+  handle.decodeFrom(indexIter.value().data());
+  Slice block;
+  std::string scratch;
+  if (!readBlock({handle.getPosition(), handle.getSize()}, &block, &scratch)) {
+    printError("SstableReader: read data block error");
+    return false;
+  }
+
+  // Entries of one user key are in ascending seq order,
+  // the newest visible one is the last entry not greater than key
+  BlockIterator iter(_options.comparator, block);
+  iter.seek(key);
+  if (!iter.valid()) {
+    iter.seekToLast();
+  } else if (compareInternalKey(_options.comparator, iter.key(), key) > 0) {
+    iter.prev();
+  }
+
+  if (!iter.valid()) return false;
+
+  Slice foundUserKey = iter.key();
+  foundUserKey.removeTailfix(KeyTagSize);
+  if (_options.comparator->cmp(foundUserKey, userKey) != 0) return false;
+
+  (*handleResult)(arg, iter.key(), iter.value());
+  return true;
+}
+
+uint64_t SstableReader::approximateOffsetOf(const Slice& key) const
+{
+  IndexBlockIterator indexIter(_indexBlock.data(),
+                               _indexBlock.data() + _indexBlock.size(), _options);
+  indexIter.seek(key);
+
+  // Key is before the first data block
+  if (!indexIter.valid()) return 0;
+
+  BlockHandle handle;
+  handle.decodeFrom(indexIter.value().data());
+
+  // The index only has the first key of every block, so the last block is
+  // read to tell a key inside it from one past the end of the data
+  if (indexIter.index() + 1 == indexIter.entryNum())
+  {
+    Slice block;
+    std::string scratch;
+    if (readBlock({handle.getPosition(), handle.getSize()}, &block, &scratch))
+    {
+      BlockIterator iter(_options.comparator, block);
+      iter.seekToLast();
+      if (iter.valid() && compareInternalKey(_options.comparator, key, iter.key()) > 0) {
+        return handle.getPosition() + handle.getSize();
+      }
+    }
+  }
+  return handle.getPosition();
+}
+
+void SstableReader::dataBlockKeys(std::vector<std::string>* keys) const
+{
+  IndexBlockIterator indexIter(_indexBlock.data(),
+                               _indexBlock.data() + _indexBlock.size(), _options);
+  for (; indexIter.valid(); indexIter.next()) {
+    keys->push_back(indexIter.key().toString());
+  }
+}
+
+}
@@ -3,32 +3,145 @@
 // Header guard standardized to YUNDB_DB_SSTABLE_READER_H
 
 #include "yundb/en.h"
+#include "yundb/iterator.h"
 #include "yundb/options.h"
 #include "yundb/slice.h"
-#include "block_reader.h"
+#include "filter_block_reader.h"
+#include "table_format.h"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace yundb
 {
 
+class BlockReadahead;
+
+// SstableReader holds everything of an opened sstable that does not change
+// between lookups: the file handle, the parsed footer, the uncompressed
+// filter block and the uncompressed index block. It is parsed once by
+// open() and then pinned in the table cache, so a lookup only needs to
+// read the data block.
 class SstableReader
 {
  public:
-  SstableReader(const Options& options, std::string fileName);
+  // Take the ownership of file
+  SstableReader(const Options& options, RandomAccessFile* file, uint64_t fileSize);
   SstableReader() = delete;
   SstableReader(const SstableReader& other) = delete;
+  SstableReader& operator=(const SstableReader& other) = delete;
   ~SstableReader();
 
+  // Read footer, filter block and index block from file.
+  // Return false when the table is broken
+  bool open();
+
+  RandomAccessFile* file() const { return _randomFile.get(); }
+
+  uint64_t fileSize() const { return _fileSize; }
+
+  // Uncompressed index block
+  Slice indexBlock() const { return Slice(_indexBlock); }
+
+  const FilterBlockReader* filter() const { return _filter.get(); }
+
+  // Return false if the whole table filter rules out userKey. Checked
+  // before the index block is searched.
+  bool tableMayMatch(const Slice& userKey) const
+  { return !_wholeTableFilter || _filter->keyMayMatch(0, userKey); }
+
+  // Return false if the filter rules out userKey in data block
+  // blockIndex. Tables written with another filter policy have no filter,
+  // so every key may match.
+  bool keyMayMatch(uint32_t blockIndex, const Slice& userKey) const
+  {
+    return _filter == nullptr || _wholeTableFilter ||
+           _filter->keyMayMatch(blockIndex, userKey);
+  }
+
+  // Batched tableMayMatch, results[i] is set for userKeys[i]
+  void tableKeysMayMatch(const Slice* userKeys, int n, bool* results) const
+  {
+    if (_wholeTableFilter) {
+      _filter->keysMayMatch(0, userKeys, n, results);
+    } else {
+      for (int i = 0; n > i; i++) results[i] = true;
+    }
+  }
+
+  // Batched keyMayMatch, results[i] is set for userKeys[i]
+  void keysMayMatch(uint32_t blockIndex, const Slice* userKeys, int n, bool* results) const
+  {
+    if (_filter == nullptr || _wholeTableFilter) {
+      for (int i = 0; n > i; i++) results[i] = true;
+    } else {
+      _filter->keysMayMatch(blockIndex, userKeys, n, results);
+    }
+  }
+
+  // Memory pinned by this reader
+  size_t getMemoryUsage() const
+  { return sizeof(SstableReader) + _indexBlock.size() + _filterBlock.size(); }
+
+  // Read block at p and store the uncompressed contents in *result
+  bool readBlock(const PosAndSize& p, std::string* result) const;
+
+  // Read block at p and set *contents to its uncompressed contents,
+  // reading through readahead when it is not null. forward tells the
+  // readahead which way the reader moves. An uncompressed block of a
+  // memory mapped table is not copied, *contents then points into the
+  // mapping, which stays valid as long as this reader. Otherwise
+  // *contents points into *scratch.
+  bool readBlock(const PosAndSize& p, Slice* contents, std::string* scratch,
+                 BlockReadahead* readahead = nullptr, bool forward = true) const;
+
+  // readBlock() of blocks[0..n-1] with the reads submitted together, ok[i]
+  // is the result of block i
+  void readBlocks(const PosAndSize* blocks, int n, Slice* contents,
+                  std::string* scratches, bool* ok) const;
+
+  // Return an iterator over all internal keys of the table.
+  // The reader must outlive the iterator
+  Iterator* newIterator(const ReadOptions& options = ReadOptions()) const;
+
+  // Return false if the filter shows the table has no key at or past
+  // target, an internal key, with the prefix of target. Tables whose
+  // filter has no prefixes of Options::prefix_extractor always match.
+  bool prefixMayMatch(const Slice& target) const;
+
+  // Find the newest entry of key's user key whose seq is not greater than
+  // key's seq and call (*handleResult)(arg, internal key, value) with it.
+  // Return false if there is no such entry
+  bool internalGet(const Slice& key, void* arg,
+                   void (*handleResult)(void* arg, const Slice& k, const Slice& v)) const;
+
+  // Approximate file offset of the data block that key falls in. Keys
+  // past the last entry map to the end of the data blocks
+  uint64_t approximateOffsetOf(const Slice& key) const;
+
+  // Append the first internal key of every data block to *keys
+  void dataBlockKeys(std::vector<std::string>* keys) const;
+
  private:
+  bool readFilterBlock(const Footer& footer);
+
+  // Check the trailer of block and set *result to its uncompressed
+  // contents, block may point into *scratch
+  bool blockContents(const Slice& block, Slice* result, std::string* scratch) const;
+
   Options _options;
-  std::string _fileName;
-  uint64_t _fileNumber;
-  std::shared_ptr<RandomAccessFile> _randomFile;
+  uint64_t _fileSize;
+  std::unique_ptr<RandomAccessFile> _randomFile;
   std::string _indexBlock;
-  std::string _metaIndexBlock;
+  std::string _filterBlock;
+  std::unique_ptr<FilterBlockReader> _filter;
+  // _filter has a single filter over every key of the table
+  bool _wholeTableFilter;
+  // _filter also has the prefixes of Options::prefix_extractor
+  bool _prefixFiltered;
 };
 
 }
 
-#endif // YUNDB_DB_SSTABLE_READER_H
\ No newline at end of file
+#endif // YUNDB_DB_SSTABLE_READER_H
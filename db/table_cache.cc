@@ -3,344 +3,508 @@
 #include "db/block_reader.h"
 #include "db/filter_block_reader.h"
 #include "db/table_format.h"
+#include "db/sstable_reader.h"
 #include "db/dbformat.h"
 #include "util/coding.h"
+#include "util/file_name.h"
 
 #include <cstring>
+#include <functional>
 #include <memory>
 
 namespace yundb
 {
 
 constexpr size_t FileNumberSize = sizeof(uint64_t);
+// Block cache key: fixed64 file number + fixed64 block offset
+constexpr size_t BlockCacheKeySize = 2 * sizeof(uint64_t);
 
-static const char* entryLimit(const char* start, const char* end)
+static void deleteSstableReader(const Slice& key, void* value)
 {
-  if (start == nullptr || end == nullptr || end - start < 4) {
+  (void)key;
+  delete static_cast<SstableReader*>(value);
+}
+
+static void deleteBlock(const Slice& key, void* value)
+{
+  (void)key;
+  delete static_cast<std::string*>(value);
+}
+
+// Store the block cache key of the data block at handle in buf
+static Slice encodeBlockKey(char* buf, uint64_t fileNumber, const BlockHandle& handle)
+{
+  EncodeFixed64(buf, fileNumber);
+  EncodeFixed64(buf + sizeof(uint64_t), handle.getPosition());
+  return Slice(buf, BlockCacheKeySize);
+}
+
+TableCache::TableCache(const std::string& dbname, const Options& options,
+                       std::shared_ptr<Cache> cache,
+                       std::shared_ptr<Cache> blockCache)
+    : _cache(std::move(cache)),
+      _blockCache(std::move(blockCache)),
+      _blockCacheHits(0),
+      _blockCacheMisses(0),
+      _options(options),
+      _dbname(dbname) {}
+
+TableCache::~TableCache() = default;
+
+bool TableCache::insert(uint64_t fileNumber, RandomAccessFile* file, uint64_t fileSize)
+{
+  if (cacheTable(fileNumber, file, fileSize) == nullptr) return false;
+  release(fileNumber);
+  return true;
+}
+
+SstableReader* TableCache::cacheTable(uint64_t fileNumber, RandomAccessFile* file,
+                                      uint64_t fileSize)
+{
+  if (file == nullptr) {
+    printError("TableCache: None file ptr");
     return nullptr;
   }
 
-  const uint32_t restartNum = DecodeFixed32(end - 4);
-  const size_t restartBytes = static_cast<size_t>(restartNum + 1) * sizeof(uint32_t);
-  if (static_cast<size_t>(end - start) < restartBytes) {
+  SstableReader* reader = new SstableReader(_options, file, fileSize);
+  if (!reader->open()) {
+    printError("TableCache: open table ", fileNumber, " error");
+    delete reader;
     return nullptr;
   }
 
-  return end - restartBytes;
+  // Pinned by insert, so a reader larger than its shard is not evicted
+  // before the caller gets it
+  return static_cast<SstableReader*>(
+    _cache->insert(Slice(reinterpret_cast<char*>(&fileNumber), FileNumberSize),
+                   reader, FileNumberSize + reader->getMemoryUsage(),
+                   deleteSstableReader)
+  );
 }
 
-class IndexBlockIterator
+SstableReader* TableCache::findTable(uint64_t fileNumber, uint64_t fileSize)
 {
- public:
-  // Start and end of whole index block
-  IndexBlockIterator(const char* start, const char* end, Options options)
-      : _start(start),
-        _end(end),
-        _cur(start),
-        _limit(entryLimit(start, end)),
-        _options(options),
-        _index(0),
-        _valid(start != nullptr && end != nullptr && start < end && _limit != nullptr)
-  { seekToFirst(); }
+  char* fileNumberKey = reinterpret_cast<char*>(&fileNumber);
+  auto reader = static_cast<SstableReader*>(
+    _cache->lookup(Slice(fileNumberKey, FileNumberSize))
+  );
 
-  IndexBlockIterator(const IndexBlockIterator&) = delete;
+  if (reader != nullptr) return reader;
 
-  IndexBlockIterator& operator=(const IndexBlockIterator&) = delete;
+  RandomAccessFile* file = nullptr;
+  const std::string fileName = generateTableFileName(fileNumber, _dbname);
+  if (_options.use_direct_reads) {
+    _options.env->newDirectRandomAccessFile(fileName, &file);
+  } else {
+    _options.env->newRandomAccessFile(fileName, &file);
+  }
+  if (file == nullptr) {
+    printError("TableCache: file number ", fileNumber, " open error");
+    return nullptr;
+  }
 
-  ~IndexBlockIterator() = default;
+  return cacheTable(fileNumber, file, fileSize);
+}
 
-  inline bool valid() const;
+void TableCache::release(uint64_t fileNumber)
+{
+  char* fileNumberKey = reinterpret_cast<char*>(&fileNumber);
+  _cache->unRef(Slice(fileNumberKey, FileNumberSize));
+}
 
-  void seekToFirst();
+bool TableCache::get(const ReadOptions& options, uint64_t fileNumber, uint64_t fileSize,
+                     const Slice& key, void* arg,
+                     void (*handleResult)(void* arg, const Slice& k, const Slice& v))
+{
+  SstableReader* reader = findTable(fileNumber, fileSize);
 
-  int cmp(const char* key1, size_t key1Len, const char* key2, size_t key2Len);
+  if (reader == nullptr) {
+    printError("TableCache: file number ", fileNumber, " not found");
+    return false;
+  }
 
-  void seek(const Slice& target);
+  Slice userKey = key;
+  userKey.removeTailfix(KeyTagSize);
+  // Skip the index search when the table does not hold the key
+  if (!reader->tableMayMatch(userKey)) {
+    release(fileNumber);
+    return true;
+  }
 
-  // Get data block handle
-  Slice value() const;
+  Slice indexBlock = reader->indexBlock();
+  IndexBlockIterator indexBlockIter(
+    indexBlock.data(),
+    indexBlock.data() + indexBlock.size(),
+    _options
+  );
 
-  size_t index() const { return _index; }
+  indexBlockIter.seek(key);
 
-  const char* blockStart() const { return _start; }
+  bool success = true;
+  if (indexBlockIter.valid() && reader->keyMayMatch(indexBlockIter.index(), userKey))
+  {
+    success = readDataBlock(options, reader, fileNumber, indexBlockIter.value(),
+                            [&](const Slice& block) {
+                              BlockIterator iter(_options.comparator, block);
+                              searchBlock(&iter, key, arg, handleResult);
+                            });
+  }
 
-  const char* blockEnd() const { return _end; }
- private:
-  const char* _start;
-  const char* _end;
-  const char* _cur;
-  const char* _limit;
-  Options _options;
-  int _index;
-  bool _valid;
-};
+  release(fileNumber);
+  return success;
+}
 
-inline bool IndexBlockIterator::valid() const
-{ return _valid; }
+namespace
+{
 
-void IndexBlockIterator::seekToFirst()
+// Adds the index of the key to the result of searchBlock
+struct IndexedResult
 {
-  if (!_valid) return;
-
-  const char* key = nullptr;
-  const char* value = nullptr;
-  const char* next = nullptr;
-  uint64_t keyLen = 0;
-  uint64_t valueLen = 0;
-  if (!decodeIndexEntry(_start, _limit, &key, &keyLen, &value, &valueLen, &next)) {
-    _index = -1;
-    _cur = _start;
-    _valid = false;
-    return;
+  void* arg;
+  int index;
+  void (*handleResult)(void* arg, int index, const Slice& k, const Slice& v);
+
+  static void handle(void* arg, const Slice& k, const Slice& v)
+  {
+    IndexedResult* result = static_cast<IndexedResult*>(arg);
+    (*result->handleResult)(result->arg, result->index, k, v);
   }
+};
 
-  _index = 0;
-  _cur = _start;
-  _valid = true;
 }
 
-int IndexBlockIterator::cmp(const char* key1, size_t key1Len, const char* key2, size_t key2Len)
+bool TableCache::multiGet(const ReadOptions& options, uint64_t fileNumber, uint64_t fileSize,
+                          const Slice* keys, int n, void* arg,
+                          void (*handleResult)(void* arg, int index,
+                                               const Slice& k, const Slice& v))
 {
-  int rs = _options.comparator->cmp(
-    Slice(key1, key1Len - KeyTagSize),
-    Slice(key2, key2Len - KeyTagSize)
-  );
+  SstableReader* reader = findTable(fileNumber, fileSize);
 
-  if (rs == 0) {
-    SequenceNumber seq1, seq2;
-    decodeSeqAndType(key1 + key1Len - KeyTagSize, &seq1, NULL);
-    decodeSeqAndType(key2 + key2Len - KeyTagSize, &seq2, NULL);
-    if (seq1 > seq2) {
-      return 1;
-    } else {
-      return -1;
-    }
-  } else {
-    return rs;
+  if (reader == nullptr) {
+    printError("TableCache: file number ", fileNumber, " not found");
+    return false;
   }
-}
 
-void IndexBlockIterator::seek(const Slice& target)
-{
-  if (!_valid) return;
+  std::vector<Slice> userKeys(n);
+  for (int i = 0; n > i; i++) {
+    userKeys[i] = keys[i];
+    userKeys[i].removeTailfix(KeyTagSize);
+  }
+  std::unique_ptr<bool[]> mayMatch(new bool[n]);
+  std::unique_ptr<bool[]> blockMayMatch(new bool[n]);
+  reader->tableKeysMayMatch(userKeys.data(), n, mayMatch.get());
 
-  _index = -1;
-  const char* entry = _start, *pre = nullptr;
-  while (entry < _limit)
+  Slice indexBlock = reader->indexBlock();
+  IndexBlockIterator indexBlockIter(
+    indexBlock.data(),
+    indexBlock.data() + indexBlock.size(),
+    _options
+  );
+
+  // Keys are sorted, so the keys of one data block are next to each other.
+  // Collect them and read the block once for all of them
+  struct BlockGroup
+  {
+    BlockHandle handle;
+    // Keys of the block that pass its filter are blockKeys[begin, end)
+    size_t begin;
+    size_t end;
+  };
+  std::vector<BlockGroup> groups;
+  std::vector<int> blockKeys;
+  std::vector<int> group;
+  std::vector<Slice> groupUserKeys;
+  int i = 0;
+  while (n > i)
   {
-    const char* key = nullptr, *value = nullptr, *next = nullptr;
-    uint64_t keyLen = 0, valueLen = 0;
-
-    if (!decodeIndexEntry(entry, _limit, &key, &keyLen, &value, &valueLen, &next)) {
-      _index = -1;
-      _cur = _start;
-      _valid = false;
-      return;
+    if (!mayMatch[i]) {
+      i++;
+      continue;
+    }
+    indexBlockIter.seek(keys[i]);
+    if (!indexBlockIter.valid()) {
+      i++;
+      continue;
     }
 
-    if (this->cmp(key, keyLen, target.data(), target.size()) > 0) {
-      _cur = pre != nullptr? pre : _start;
-      _valid = pre != nullptr;
-      return;
+    const size_t blockIndex = indexBlockIter.index();
+    BlockGroup blockGroup;
+    blockGroup.handle.decodeFrom(indexBlockIter.value().data());
+    group.clear();
+    groupUserKeys.clear();
+    group.push_back(i);
+    groupUserKeys.push_back(userKeys[i]);
+    for (i++; n > i; i++)
+    {
+      if (!mayMatch[i]) continue;
+      indexBlockIter.seek(keys[i]);
+      if (!indexBlockIter.valid() || indexBlockIter.index() != blockIndex) break;
+      group.push_back(i);
+      groupUserKeys.push_back(userKeys[i]);
     }
 
-    pre = entry;
-    entry = next;
-    _index++;
+    const int groupSize = static_cast<int>(group.size());
+    reader->keysMayMatch(blockIndex, groupUserKeys.data(), groupSize, blockMayMatch.get());
+    blockGroup.begin = blockKeys.size();
+    for (int j = 0; groupSize > j; j++) {
+      if (blockMayMatch[j]) blockKeys.push_back(group[j]);
+    }
+    blockGroup.end = blockKeys.size();
+    if (blockGroup.end > blockGroup.begin) groups.push_back(blockGroup);
   }
 
-  if (pre != nullptr) {
-    _cur = pre;
-    _valid = true;
-  } else {
-    _index = -1;
-    _cur = _start;
-    _valid = false;
+  auto searchGroup = [&](const BlockGroup& blockGroup, const Slice& block) {
+    BlockIterator iter(_options.comparator, block);
+    for (size_t j = blockGroup.begin; blockGroup.end > j; j++)
+    {
+      IndexedResult result{arg, blockKeys[j], handleResult};
+      searchBlock(&iter, keys[blockKeys[j]], &result, IndexedResult::handle);
+    }
+  };
+
+  // Search the cached blocks, then read all others with one batch of reads
+  bool success = true;
+  std::vector<size_t> missing;
+  std::vector<PosAndSize> missingBlocks;
+  for (size_t g = 0; groups.size() > g; g++)
+  {
+    char blockKeyBuf[BlockCacheKeySize];
+    Slice blockKey = encodeBlockKey(blockKeyBuf, fileNumber, groups[g].handle);
+    std::string* cachedBlock = lookupBlock(blockKey);
+    if (cachedBlock != nullptr) {
+      searchGroup(groups[g], *cachedBlock);
+      _blockCache->unRef(blockKey);
+    } else {
+      missing.push_back(g);
+      missingBlocks.emplace_back(groups[g].handle.getPosition(), groups[g].handle.getSize());
+    }
   }
-}
 
-Slice IndexBlockIterator::value() const
-{
-  if (!_valid) return Slice();
-
-  const char* const limit = entryLimit(_start, _end);
-  if (limit == nullptr) return Slice();
-
-  const char* key = nullptr;
-  const char* value = nullptr;
-  const char* next = nullptr;
-  uint64_t keyLen = 0;
-  uint64_t valueLen = 0;
-  if (!decodeIndexEntry(_cur, limit, &key, &keyLen, &value, &valueLen, &next)) {
-    return Slice();
+  if (!missing.empty())
+  {
+    const int missingNum = static_cast<int>(missing.size());
+    std::vector<Slice> contents(missingNum);
+    std::vector<std::string> scratches(missingNum);
+    std::unique_ptr<bool[]> ok(new bool[missingNum]);
+    reader->readBlocks(missingBlocks.data(), missingNum, contents.data(), scratches.data(),
+                       ok.get());
+    for (int j = 0; missingNum > j; j++)
+    {
+      if (!ok[j]) {
+        printError("TableCache: file number ", fileNumber, " read data block error");
+        success = false;
+        continue;
+      }
+      const BlockGroup& blockGroup = groups[missing[j]];
+      searchGroup(blockGroup, contents[j]);
+
+      if (contents[j].data() == scratches[j].data()) {
+        char blockKeyBuf[BlockCacheKeySize];
+        fillBlockCache(options, encodeBlockKey(blockKeyBuf, fileNumber, blockGroup.handle),
+                       &scratches[j]);
+      }
+    }
   }
 
-  return Slice(value, static_cast<size_t>(valueLen));
+  release(fileNumber);
+  return success;
 }
 
-bool TableCache::getFilterBlock(const Footer& footer, RandomAccessFile* file, std::string* result)
+std::string* TableCache::lookupBlock(const Slice& blockKey)
 {
-  if (result == nullptr) {
-    printError("TableCache: None value ptr");
-    return false;
-  }
-  result->clear();
-
-  PosAndSize p = footer.getMetaIndexPosAndSize();
-  Slice metaIndexBlock;
-  std::string uncompressData;
-  char data[_options.block_size + BlockTrailerSize];
+  if (_blockCache == nullptr) return nullptr;
 
-  file->read(p.first, &metaIndexBlock, data, p.second);
-  uncompressData = uncompressBlock(metaIndexBlock, checkBlock(metaIndexBlock));
-  const char* ptr = _options.filter_policy->Name();
-  size_t filterNameSize = std::strlen(ptr);
-
-  if (std::memcmp(uncompressData.data(), ptr, filterNameSize) != 0) {
-    printError("TableCache: filter policy name not match");
-    return false;
+  std::string* cachedBlock = static_cast<std::string*>(_blockCache->lookup(blockKey));
+  if (cachedBlock != nullptr) {
+    _blockCacheHits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    _blockCacheMisses.fetch_add(1, std::memory_order_relaxed);
   }
+  return cachedBlock;
+}
 
-  ptr = uncompressData.data() + filterNameSize;
-
-  BlockHandle filterBlockHandle;
-  filterBlockHandle.decodeFrom(ptr);
-  uint64_t filterBlockPos = filterBlockHandle.getPosition();
-  uint64_t filterBlockSize = filterBlockHandle.getSize();
-
-  Slice filterBlock;
-  if (!file->read(filterBlockPos, &filterBlock, data, filterBlockSize)) {
-    printError("TableCache: read filter block error");
-    return false;
+void TableCache::fillBlockCache(const ReadOptions& options, const Slice& blockKey,
+                                std::string* block)
+{
+  if (_blockCache != nullptr && options.fill_cache) {
+    size_t charge = block->size();
+    _blockCache->insert(blockKey, new std::string(std::move(*block)), charge, deleteBlock);
+    _blockCache->unRef(blockKey);
   }
-
-  *result = uncompressBlock(filterBlock, checkBlock(filterBlock));
-  return true;
 }
 
-bool TableCache::getIndexBlock(const Footer& footer, RandomAccessFile* file, std::string* result)
+bool TableCache::readDataBlock(const ReadOptions& options, SstableReader* reader,
+                               uint64_t fileNumber, const Slice& handleValue,
+                               const std::function<void(const Slice& block)>& useBlock)
 {
-  if (result == nullptr) {
-    printError("TableCache: None value ptr");
-    return false;
+  BlockHandle handle;
+  handle.decodeFrom(handleValue.data());
+
+  char blockKeyBuf[BlockCacheKeySize];
+  Slice blockKey = encodeBlockKey(blockKeyBuf, fileNumber, handle);
+  std::string* cachedBlock = lookupBlock(blockKey);
+  if (cachedBlock != nullptr) {
+    useBlock(*cachedBlock);
+    _blockCache->unRef(blockKey);
+    return true;
   }
-  result->clear();
 
-  PosAndSize p = footer.getIndexBlockPosAndSize();
-  Slice indexBlock;
-  char data[_options.block_size + BlockTrailerSize];
-  if (!file->read(p.first, &indexBlock, data, p.second)) {
-    printError("TableCache: read index block error");
+  Slice contents;
+  std::string scratch;
+  if (!reader->readBlock({handle.getPosition(), handle.getSize()}, &contents, &scratch)) {
+    printError("TableCache: read data block error");
     return false;
   }
-  *result = uncompressBlock(indexBlock, checkBlock(indexBlock));
+  // Use before insert, the block may be evicted as soon as it
+  // is handed to the cache
+  useBlock(contents);
+  // A block read in place from the mapping costs nothing to read again
+  if (contents.data() == scratch.data()) fillBlockCache(options, blockKey, &scratch);
   return true;
 }
 
-TableCache::TableCache(const std::string& dbname, const Options& options,
-                       std::shared_ptr<Cache> cache)
-    : _cache(std::move(cache)), _options(options), _dbname(dbname) {}
+bool TableCache::searchBlock(BlockIterator* iter, const Slice& key, void* arg,
+                             void (*handleResult)(void* arg, const Slice& k, const Slice& v)) const
+{
+  // Entries of one user key are in ascending seq order,
+  // the newest visible one is the last entry not greater than key
+  iter->seek(key);
+  if (!iter->valid()) {
+    iter->seekToLast();
+  } else if (compareInternalKey(_options.comparator, iter->key(), key) > 0) {
+    iter->prev();
+  }
 
-TableCache::~TableCache() = default;
+  if (!iter->valid()) return false;
+
+  Slice foundUserKey = iter->key();
+  foundUserKey.removeTailfix(KeyTagSize);
+  Slice userKey = key;
+  userKey.removeTailfix(KeyTagSize);
+  if (_options.comparator->cmp(foundUserKey, userKey) != 0) return false;
 
-void TableCache::insert(uint64_t fileNumber, RandomAccessFile* value, size_t valueSize,
-                        void (*deleter)(const Slice& key, void* value)) {
-  _cache->insert(Slice(reinterpret_cast<char*>(&fileNumber), FileNumberSize),
-                 reinterpret_cast<char*>(value), FileNumberSize + valueSize, deleter);
+  (*handleResult)(arg, iter->key(), iter->value());
+  return true;
 }
 
-bool TableCache::lookup(uint64_t fileNumber, size_t fileSize, const Slice key, std::string* value)
+// Copy the value, a deletion leaves value empty
+static void saveValue(void* arg, const Slice& k, const Slice& v)
+{
+  ValueType type;
+  decodeSeqAndType(k.data() + k.size() - KeyTagSize, nullptr, &type);
+  std::string* value = static_cast<std::string*>(arg);
+  if (type == TypeValue) {
+    value->assign(v.data(), v.size());
+  } else {
+    value->clear();
+  }
+}
+
+bool TableCache::lookup(const ReadOptions& options, uint64_t fileNumber,
+                        size_t fileSize, const Slice key, std::string* value)
 {
   if (value == nullptr) {
     printError("TableCache: None value ptr");
     return false;
   }
 
-  if (fileSize < Footer::MaxFooterSize) {
-    printError("TableCache: file size less than footer size");
-    return false;
-  }
+  struct Lookup
+  {
+    std::string* value;
+    bool found;
+
+    static void save(void* arg, const Slice& k, const Slice& v)
+    {
+      Lookup* lookup = static_cast<Lookup*>(arg);
+      lookup->found = true;
+      saveValue(lookup->value, k, v);
+    }
+  };
 
   value->clear();
-  char* fileNumberKey = reinterpret_cast<char*>(&fileNumber);
-  auto randomAccessTable = static_cast<RandomAccessFile*>(
-    _cache->lookup(Slice(fileNumberKey, FileNumberSize))
-  );
-
-  if (randomAccessTable == nullptr) {
-    printError("TableCache: file number %lu not found in cache", fileNumber);
-    return false;
-  }
+  Lookup lookup{value, false};
+  return get(options, fileNumber, fileSize, key, &lookup, &Lookup::save) && lookup.found;
+}
 
-  Slice fileData;
-  char scratch[_options.block_size + BlockTrailerSize];
+// Unpin the table of an iterator, arg1 is the table cache
+// and arg2 is the heap allocated file number
+static void releaseTable(void* arg1, void* arg2)
+{
+  uint64_t* fileNumber = static_cast<uint64_t*>(arg2);
+  static_cast<Cache*>(arg1)->unRef(
+    Slice(reinterpret_cast<char*>(fileNumber), FileNumberSize));
+  delete fileNumber;
+}
 
-  if (!randomAccessTable->read(fileSize - Footer::MaxFooterSize - BlockTrailerSize,
-                               &fileData, scratch, Footer::MaxFooterSize + BlockTrailerSize)) {
-    printError("TableCache: read file error");
-    return false;
+Iterator* TableCache::newIterator(uint64_t fileNumber, uint64_t fileSize,
+                                  const ReadOptions& options)
+{
+  SstableReader* reader = findTable(fileNumber, fileSize);
+  if (reader == nullptr) {
+    printError("TableCache: file number ", fileNumber, " not found");
+    return newErrorIterator();
   }
 
-  std::string uncompressedData = uncompressBlock(fileData, checkBlock(fileData));
-  Footer footer(uncompressedData);
-
-  std::string filterBlock;
-  std::string indexBlock;
-
-  if (!getFilterBlock(footer, randomAccessTable, &filterBlock)) {
-    printError("TableCache: get filter block error");
-    return false;
-  }
+  Iterator* iter = reader->newIterator(options);
+  iter->registerCleanup(releaseTable, _cache.get(), new uint64_t(fileNumber));
+  return iter;
+}
 
-  if (!getIndexBlock(footer, randomAccessTable, &indexBlock)) {
-    printError("TableCache: get index block error");
+bool TableCache::dataBlockKeys(uint64_t fileNumber, uint64_t fileSize,
+                               std::vector<std::string>* keys)
+{
+  SstableReader* reader = findTable(fileNumber, fileSize);
+  if (reader == nullptr) {
+    printError("TableCache: file number ", fileNumber, " not found");
     return false;
   }
 
-  FilterBlockReader filterBlockReader(
-    _options.filter_policy,
-    Slice(filterBlock.data(), filterBlock.size())
-  );
-  IndexBlockIterator indexBlockIter(
-    indexBlock.data(),
-    indexBlock.data() + indexBlock.size(),
-    _options
-  );
-
-  indexBlockIter.seek(key);
-  Slice userKey = key;
-  userKey.removeTailfix(KeyTagSize);
-
-  if (indexBlockIter.valid() && filterBlockReader.keyMayMatch(indexBlockIter.index(), userKey))
-  {
-    DataBlockReader dataBlockReader(_options);
-    Slice dataBlockHandle = indexBlockIter.value();
-    BlockHandle handle;
-    Slice dataBlock;
-    handle.decodeFrom(dataBlockHandle.data());
+  reader->dataBlockKeys(keys);
+  release(fileNumber);
+  return true;
+}
 
-    if (!randomAccessTable->read(handle.getPosition(), &dataBlock, scratch,
-                                 handle.getSize())) {
-      printError("TableCache: read data block error");
-      return false;
-    }
-    uncompressedData = uncompressBlock(dataBlock, checkBlock(dataBlock));
-    return dataBlockReader.queryValue(uncompressedData, key, value);
+uint64_t TableCache::approximateOffsetOf(uint64_t fileNumber, uint64_t fileSize,
+                                         const Slice& key)
+{
+  SstableReader* reader = findTable(fileNumber, fileSize);
+  if (reader == nullptr) {
+    printError("TableCache: file number ", fileNumber, " not found");
+    return 0;
   }
 
-  return false;
+  uint64_t offset = reader->approximateOffsetOf(key);
+  release(fileNumber);
+  return offset;
 }
 
 void TableCache::evict(uint64_t fileNumber)
 {
   char* fileNumberKey = reinterpret_cast<char*>(&fileNumber);
-  _cache->unRef(Slice(fileNumberKey, FileNumberSize));
+  _cache->erase(Slice(fileNumberKey, FileNumberSize));
 }
 
 void TableCache::changeOptions(const Options& options)
 {
   _options = options;
   _cache->changeCpacity(options.max_cache_size);
+  if (_blockCache != nullptr) _blockCache->changeCpacity(options.block_cache_size);
+}
+
+bool TableCache::getProperty(const Slice& property, std::string* value) const
+{
+  if (value == nullptr) return false;
+
+  if (property == Slice("yundb.block-cache-hits")) {
+    *value = std::to_string(getBlockCacheHits());
+  } else if (property == Slice("yundb.block-cache-misses")) {
+    *value = std::to_string(getBlockCacheMisses());
+  } else if (property == Slice("yundb.block-cache-usage")) {
+    *value = std::to_string(_blockCache != nullptr ? _blockCache->getUsage() : 0);
+  } else {
+    return false;
+  }
+  return true;
 }
 
 }
\ No newline at end of file
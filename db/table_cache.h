@@ -2,43 +2,127 @@
 #define YUNDB_DB_TABLE_CACHE_H
 
 #include "yundb/en.h"
+#include "yundb/iterator.h"
 #include "util/cache.h"
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace yundb
 {
 
-class Footer;
+class BlockIterator;
+class SstableReader;
 
 class TableCache
 {
  public:
+  // cache holds opened tables. blockCache holds uncompressed data blocks
+  // keyed by file number and block offset, data blocks are not cached
+  // when it is null
   TableCache(const std::string& dbname, const Options& options,
-             std::shared_ptr<Cache> cache);
+             std::shared_ptr<Cache> cache,
+             std::shared_ptr<Cache> blockCache = nullptr);
 
   ~TableCache();
 
-  // Deleter is the function to delete this key-value pair when evicted from cache
-  void insert(uint64_t fileNumber, RandomAccessFile* value, size_t valueSize,
-              void (*deleter)(const Slice& key, void* value));
+  // Parse footer, filter block and index block of the table once and
+  // keep them in cache together with file.
+  // Take the ownership of file, return false if the table is broken
+  bool insert(uint64_t fileNumber, RandomAccessFile* file, uint64_t fileSize);
     
-  // Find the value of key in specified fileNumber 
-  bool lookup(uint64_t fileNumber, size_t fileSize, const Slice key, std::string* value);
+  // Find the value of key in specified fileNumber.
+  // The data block read from file is kept in block cache only when
+  // options.fill_cache is true
+  bool lookup(const ReadOptions& options, uint64_t fileNumber, size_t fileSize,
+              const Slice key, std::string* value);
+
+  // Call handleResult(arg, foundKey, foundValue) with the newest entry of
+  // the user key of internal key that is not newer than key, if the table
+  // has one. Return false if the table or the data block of key can not
+  // be read, a key that is not in the table is not an error
+  bool get(const ReadOptions& options, uint64_t fileNumber, uint64_t fileSize,
+           const Slice& key, void* arg,
+           void (*handleResult)(void* arg, const Slice& k, const Slice& v));
+
+  // Batched get of keys[0..n-1], internal keys sorted in ascending order.
+  // Every data block is read and uncompressed at most once, however many
+  // of the keys fall in it. Call handleResult(arg, i, foundKey, foundValue)
+  // for every keys[i] that has an entry in the table.
+  // Return false if the table or any data block of keys can not be read
+  bool multiGet(const ReadOptions& options, uint64_t fileNumber, uint64_t fileSize,
+                const Slice* keys, int n, void* arg,
+                void (*handleResult)(void* arg, int index, const Slice& k, const Slice& v));
+
+  // Return an iterator over the internal keys of table fileNumber,
+  // the table stays pinned in cache until the iterator is deleted.
+  // Return an empty iterator if the table can not be opened
+  Iterator* newIterator(uint64_t fileNumber, uint64_t fileSize,
+                        const ReadOptions& options = ReadOptions());
+
+  // Append the first internal key of every data block of the table to *keys.
+  // Return false if the table can not be opened
+  bool dataBlockKeys(uint64_t fileNumber, uint64_t fileSize, std::vector<std::string>* keys);
+
+  // Approximate file offset of the data block that internal key falls
+  // in, see SstableReader::approximateOffsetOf. Return 0 if the table
+  // can not be opened
+  uint64_t approximateOffsetOf(uint64_t fileNumber, uint64_t fileSize, const Slice& key);
 
   // Remove fileNumber entry from cache
   void evict(uint64_t fileNumber);
 
   void changeOptions(const Options& options);
 
+  uint64_t getBlockCacheHits() const { return _blockCacheHits.load(std::memory_order_relaxed); }
+  uint64_t getBlockCacheMisses() const { return _blockCacheMisses.load(std::memory_order_relaxed); }
+
+  // Handle the block cache properties of DB::GetProperty:
+  // "yundb.block-cache-hits", "yundb.block-cache-misses" and
+  // "yundb.block-cache-usage". Return false for other properties
+  bool getProperty(const Slice& property, std::string* value) const;
+
  private:
-  bool getFilterBlock(const Footer& footer,  RandomAccessFile* file, std::string* result);
-  bool getIndexBlock(const Footer& footer, RandomAccessFile* file, std::string* result);
+  // Return the reader of fileNumber, open the table file if it is not
+  // in cache. Caller should call release() when done
+  SstableReader* findTable(uint64_t fileNumber, uint64_t fileSize);
+
+  // Open the table of file and add it to cache. Return the reader
+  // pinned like findTable, or null if the table can not be opened
+  SstableReader* cacheTable(uint64_t fileNumber, RandomAccessFile* file, uint64_t fileSize);
+
+  void release(uint64_t fileNumber);
+
+  // Return the cached block of blockKey pinned in block cache, caller
+  // should unRef it when done. Return null if it is not cached
+  std::string* lookupBlock(const Slice& blockKey);
+
+  // Move *block into block cache if options.fill_cache is true
+  void fillBlockCache(const ReadOptions& options, const Slice& blockKey, std::string* block);
+
+  // Call useBlock with the uncompressed data block whose encoded handle is
+  // handleValue, from block cache when it is there. The block is only
+  // valid during the call. Return false if the block can not be read
+  bool readDataBlock(const ReadOptions& options, SstableReader* reader,
+                     uint64_t fileNumber, const Slice& handleValue,
+                     const std::function<void(const Slice& block)>& useBlock);
+
+  // Position iter, an iterator over a data block, at the entry of key
+  // and pass it to handleResult. Return false if there is no such entry
+  bool searchBlock(BlockIterator* iter, const Slice& key, void* arg,
+                   void (*handleResult)(void* arg, const Slice& k, const Slice& v)) const;
+
   std::shared_ptr<Cache> _cache;
+  std::shared_ptr<Cache> _blockCache;
+  std::atomic<uint64_t> _blockCacheHits;
+  std::atomic<uint64_t> _blockCacheMisses;
   Options _options;
   std::string _dbname;
 };
 
 }
 
-#endif // YUNDB_DB_TABLE_CACHE_H
\ No newline at end of file
+#endif // YUNDB_DB_TABLE_CACHE_H
@@ -15,6 +15,11 @@ namespace yundb
 // and taking the leading 64 bits.
 constexpr uint64_t TableMagicNumber = 0xbf920e1798aff023ull;
 
+// The meta index block holds the filter policy name and the handle of the
+// filter block. A table with one filter over all of its keys puts this
+// prefix before the name.
+constexpr char WholeTableFilterPrefix[] = "table.";
+
 // First is pos, second is size
 using PosAndSize = std::pair<uint64_t, uint64_t>;
 
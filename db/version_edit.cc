@@ -20,7 +20,13 @@ enum LogTag
   NewFile = 9,
 };
 
-FileMeta::FileMeta() : ref(0), allowedSeek(AllowedSeekTime), fileSize(0) {}
+FileMeta::FileMeta()
+      : ref(0),
+        allowedSeek(AllowedSeekTime),
+        number(0),
+        smallest(std::make_shared<InternalKey>(std::string())),
+        largest(std::make_shared<InternalKey>(std::string())),
+        fileSize(0) {}
 
 FileMeta::FileMeta(uint64_t fileNumber, size_t fileSize,
                    const std::string& smallest, const std::string& largest)
@@ -28,7 +34,8 @@ FileMeta::FileMeta(uint64_t fileNumber, size_t fileSize,
         allowedSeek(AllowedSeekTime),
         number(fileNumber),
         smallest(std::make_shared<InternalKey>(smallest)),
-        largest(std::make_shared<InternalKey>(largest)) {}
+        largest(std::make_shared<InternalKey>(largest)),
+        fileSize(fileSize) {}
  
 void VersionEdit::clear()
 {
@@ -74,10 +81,10 @@ void VersionEdit::encode(std::string* dst)
     PutVarint64(dst, _lastSequenceNumber);
   }
 
-  for (size_t i = 0; _compactPoints.size(); i++)
+  for (size_t i = 0; _compactPoints.size() > i; i++)
   {
     PutVarint32(dst, CompactPointer);
-    PutVarint64(dst, _compactPoints[i].first);
+    PutVarint32(dst, _compactPoints[i].first);
     PutLengthPrefixedSlice(dst, _compactPoints[i].second);
   }
 
@@ -93,10 +100,10 @@ void VersionEdit::encode(std::string* dst)
     auto file = _newFiles[i].second;
     PutVarint32(dst, NewFile);
     PutVarint32(dst, _newFiles[i].first);
-    PutVarint32(dst, file->number);
-    PutVarint32(dst, file->fileSize);
-    PutLengthPrefixedSlice(dst, file->largest->internalKey);
+    PutVarint64(dst, file->number);
+    PutVarint64(dst, file->fileSize);
     PutLengthPrefixedSlice(dst, file->smallest->internalKey);
+    PutLengthPrefixedSlice(dst, file->largest->internalKey);
   }
 }
 
@@ -128,7 +135,6 @@ bool VersionEdit::decode(const Slice& data)
   // Temporary storage for parsing
   int level;
   uint64_t number;
-  std::shared_ptr<FileMeta> f = std::make_shared<FileMeta>();
   Slice str;
   Slice key;
 
@@ -195,6 +201,7 @@ bool VersionEdit::decode(const Slice& data)
 
       case NewFile:
       {
+        auto f = std::make_shared<FileMeta>();
         Slice smallest, largest;
         if (getLevel(&input, &level) && GetVarint64(&input, &f->number) &&
             GetVarint64(&input, &f->fileSize) &&
@@ -220,10 +227,10 @@ bool VersionEdit::decode(const Slice& data)
   }
 
   if (msg != nullptr) {
-    printError(msg);
-  } else {
-    return true;
+    printError("VersionEdit: decode ", msg, " error");
+    return false;
   }
+  return true;
 }
 
 };
\ No newline at end of file
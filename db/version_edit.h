@@ -74,6 +74,7 @@ class VersionEdit
       printError("VersionEdit: comparator name is empty");
     }
     _comparatorName = name;
+    _hasComparatorName = true;
   }
 
   void setLogNumber(uint64_t number)
@@ -103,6 +104,10 @@ class VersionEdit
   void setCompactPointer(int level, const std::string& key)
   { _compactPoints.push_back(std::make_pair(level, key)); }
 
+  // Files added by this edit, pair first is level
+  const std::vector<std::pair<int, std::shared_ptr<FileMeta>>>& newFiles() const
+  { return _newFiles; }
+
  private:
   friend class VersionSet;
 
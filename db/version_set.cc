@@ -1,39 +1,43 @@
 #include "version_set.h"
+#include "compaction.h"
+#include "merging_iterator.h"
 #include "util/file_name.h"
 #include "db/log_reader.h"
+#include "db/table_cache.h"
 
 #include <algorithm>
 
 namespace yundb
 {
 
-static bool afterFile(const std::shared_ptr<Comparator> cmp, const Slice& userKey,
-                      const std::shared_ptr<FileMeta> f)
+static bool afterFile(const Comparator* ucmp, const Slice* userKey,
+                      const std::shared_ptr<FileMeta>& f)
 {
   // null user_key occurs before all keys and is therefore never after *f
-  return (userKey != nullptr && cmp->cmp(userKey, f->largest->getUserKey()) > 0); 
+  return (userKey != nullptr && ucmp->cmp(*userKey, f->largest->getUserKey()) > 0);
 }
 
-static bool beforeFile(const std::shared_ptr<Comparator> cmp, const Slice& userKey,
-                       const std::shared_ptr<FileMeta> f)
+static bool beforeFile(const Comparator* ucmp, const Slice* userKey,
+                       const std::shared_ptr<FileMeta>& f)
 {
   // null user_key occurs after all keys and is therefore never before *f
-  return (userKey != nullptr && cmp->cmp(userKey, f->smallest->getUserKey()) < 0);
+  return (userKey != nullptr && ucmp->cmp(*userKey, f->smallest->getUserKey()) < 0);
 }
 
-static bool fileOverlaps(const std::shared_ptr<Comparator> cmp, const Slice& smallestUserKey,
-                         const Slice& largestUserKey, const std::shared_ptr<FileMeta> f)
-{ return !afterFile(cmp, smallestUserKey, f) && !beforeFile(cmp, largestUserKey, f); }
+static bool fileOverlaps(const Comparator* ucmp, const Slice* smallestUserKey,
+                         const Slice* largestUserKey, const std::shared_ptr<FileMeta>& f)
+{ return !afterFile(ucmp, smallestUserKey, f) && !beforeFile(ucmp, largestUserKey, f); }
 
-static bool NewFileCmp(const std::shared_ptr<FileMeta> file1, const std::shared_ptr<FileMeta> file2)
-{ return file1->number < file2->number; }
+static bool newestFirst(const std::shared_ptr<FileMeta>& file1,
+                        const std::shared_ptr<FileMeta>& file2)
+{ return file1->number > file2->number; }
 
 static uint64_t maxBytesForLevel(int level)
 {
   // Init for 10 MB
   uint64_t result = 10 * 1048576;
   
-  while (level > 0) {
+  while (level > 1) {
     result *= 10;
     level--;
   }
@@ -41,9 +45,9 @@ static uint64_t maxBytesForLevel(int level)
   return result;
 }
 
-int findFile(const std::shared_ptr<Comparator> internalKeyCmp,
+int findFile(const Comparator* ucmp,
              const std::vector<std::shared_ptr<FileMeta>>& files,
-             const Slice& internalKey)
+             const Slice& userKey)
 {
   uint32_t left = 0;
   uint32_t right = files.size();
@@ -51,7 +55,7 @@ int findFile(const std::shared_ptr<Comparator> internalKeyCmp,
   {
     uint32_t mid = (left + right) / 2;
     const auto& f = files[mid];
-    if (internalKeyCmp->cmp(f->largest->internalKey, internalKey) < 0) {
+    if (ucmp->cmp(f->largest->getUserKey(), userKey) < 0) {
       // Key at "mid.largest" is < "target".  Therefore all
       // files at or before "mid" are uninteresting.
       left = mid + 1;
@@ -64,22 +68,19 @@ int findFile(const std::shared_ptr<Comparator> internalKeyCmp,
   return right;
 }
 
-bool someFileOverlapsRange(const std::shared_ptr<Comparator> cmp,
+bool someFileOverlapsRange(const Comparator* ucmp,
                            bool disjointSortedFiles,
                            const std::vector<std::shared_ptr<FileMeta>>& files,
-                           const InternalKey* smallestKey,
-                           const InternalKey* largestKey)
+                           const Slice* smallestUserKey,
+                           const Slice* largestUserKey)
 {
   if (!disjointSortedFiles)
   {
     // Need to check against all files
-    for (size_t i = 0; i < files.size(); i++)
+    for (const auto& f : files)
     {
-      const auto& f = files[i];
-      if (fileOverlaps(cmp, smallestKey->getUserKey(), largestKey->getUserKey(), f)) {
+      if (fileOverlaps(ucmp, smallestUserKey, largestUserKey, f)) {
         return true; // Overlap
-      } else {
-        // No overlap
       }
     }
     return false;
@@ -87,9 +88,8 @@ bool someFileOverlapsRange(const std::shared_ptr<Comparator> cmp,
 
   // Binary search over file list
   uint32_t index = 0;
-  if (smallestKey != nullptr) {
-    // Find the earliest possible internal key for smallestkey
-    index = findFile(cmp, files, smallestKey->internalKey);
+  if (smallestUserKey != nullptr) {
+    index = findFile(ucmp, files, *smallestUserKey);
   }
 
   if (index >= files.size()) {
@@ -97,26 +97,170 @@ bool someFileOverlapsRange(const std::shared_ptr<Comparator> cmp,
     return false;
   }
 
-  return !beforeFile(cmp, largestKey->getUserKey(), files[index]);
+  return !beforeFile(ucmp, largestUserKey, files[index]);
 }
 
-static size_t targetFileSize(const Options* options)
-{return options->max_file_size;}
-
 // stop building a single file in a level->level+1 compaction.
 static int64_t maxGrandParentOverlapBytes(const Options* options)
-{return 10 * targetFileSize(options);}
+{return 10 * static_cast<int64_t>(options->max_file_size);}
 
+// Maximum number of bytes in all compacted files.  We avoid expanding
+// the lower level file set of a compaction if it would make the
+// total compaction cover more than this many bytes.
+static int64_t expandedCompactionByteSizeLimit(const Options* options)
+{return 25 * static_cast<int64_t>(options->max_file_size);}
 
-static size_t totalFileSize(const std::vector<std::shared_ptr<FileMeta>>& files)
+static int64_t totalFileSize(const std::vector<std::shared_ptr<FileMeta>>& files)
 {
-  size_t sums = 0;
+  int64_t sums = 0;
   for (auto& f : files) {
     sums += f->fileSize;
   }
   return sums;
 }
 
+// Concatenate the tables of one level > 0. Tables are disjoint and sorted,
+// so only the table holding the current key is open at any time.
+class LevelIterator : public Iterator
+{
+ public:
+  LevelIterator(TableCache* tableCache, const Comparator* comparator,
+                const std::vector<std::shared_ptr<FileMeta>>& files,
+                const ReadOptions& options)
+        : _tableCache(tableCache),
+          _comparator(comparator),
+          _options(options),
+          _files(files),
+          _fileIndex(files.size()),
+          _openFileIndex(files.size()),
+          _error(false) {}
+
+  LevelIterator(const LevelIterator&) = delete;
+  LevelIterator& operator=(const LevelIterator&) = delete;
+
+  ~LevelIterator() override = default;
+
+  bool valid() const override { return _tableIter != nullptr && _tableIter->valid(); }
+
+  void seekToFirst() override
+  {
+    _fileIndex = 0;
+    if (openTable()) _tableIter->seekToFirst();
+    skipEmptyTablesForward();
+  }
+
+  void seekToLast() override
+  {
+    _fileIndex = _files.empty() ? 0 : _files.size() - 1;
+    if (openTable()) _tableIter->seekToLast();
+    skipEmptyTablesBackward();
+  }
+
+  void seek(const Slice& target) override
+  {
+    // First table whose largest key >= target
+    size_t left = 0, right = _files.size();
+    while (left < right)
+    {
+      size_t mid = left + (right - left) / 2;
+      if (compareInternalKey(_comparator, _files[mid]->largest->internalKey, target) < 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+
+    _fileIndex = right;
+    if (openTable()) _tableIter->seek(target);
+    if (_options.prefix_same_as_start && !valid()) {
+      // The table holds the first key at or past target, so when its
+      // filter rules out the prefix no later table has it either
+      setTableIter(nullptr);
+      return;
+    }
+    skipEmptyTablesForward();
+  }
+
+  void next() override
+  {
+    _tableIter->next();
+    skipEmptyTablesForward();
+  }
+
+  void prev() override
+  {
+    _tableIter->prev();
+    skipEmptyTablesBackward();
+  }
+
+  Slice key() const override { return _tableIter->key(); }
+
+  Slice value() const override { return _tableIter->value(); }
+
+  bool status() const override
+  { return !_error && (_tableIter == nullptr || _tableIter->status()); }
+
+ private:
+  // Replace the table iterator, keep the error of the one it replaces
+  void setTableIter(Iterator* iter)
+  {
+    if (_tableIter != nullptr && !_tableIter->status()) _error = true;
+    _tableIter.reset(iter);
+  }
+
+  // Open the table of _fileIndex, return false if _fileIndex is out of range
+  bool openTable()
+  {
+    if (_fileIndex >= _files.size()) {
+      setTableIter(nullptr);
+      _openFileIndex = _files.size();
+      return false;
+    }
+
+    if (_tableIter == nullptr || _openFileIndex != _fileIndex) {
+      const auto& f = _files[_fileIndex];
+      setTableIter(_tableCache->newIterator(f->number, f->fileSize, _options));
+      _openFileIndex = _fileIndex;
+    }
+    return true;
+  }
+
+  void skipEmptyTablesForward()
+  {
+    while (_tableIter != nullptr && !_tableIter->valid())
+    {
+      _fileIndex++;
+      if (!openTable()) return;
+      _tableIter->seekToFirst();
+    }
+  }
+
+  void skipEmptyTablesBackward()
+  {
+    while (_tableIter != nullptr && !_tableIter->valid())
+    {
+      if (_fileIndex == 0) {
+        setTableIter(nullptr);
+        return;
+      }
+      _fileIndex--;
+      if (!openTable()) return;
+      _tableIter->seekToLast();
+    }
+  }
+
+  TableCache* const _tableCache;
+  const Comparator* const _comparator;
+  const ReadOptions _options;
+  const std::vector<std::shared_ptr<FileMeta>> _files;
+  size_t _fileIndex;
+  // Index of the table _tableIter is opened on
+  size_t _openFileIndex;
+  std::unique_ptr<Iterator> _tableIter;
+  // Set once a table iterator that is no longer open met an error
+  bool _error;
+};
+
 Version::~Version()
 {
   _pre->_next = _next;
@@ -145,62 +289,317 @@ bool Version::unRef()
   return false;
 }
 
-void Version::forEachOverlapping(const Slice& userKey, const Slice& internalKey,
-                                 bool (*func)(void* arg, int level, FileMeta* f), void* arg)
+namespace
+{
+
+enum SaverState
+{
+  NotFound,
+  Found,
+  Deleted
+};
+
+struct Saver
+{
+  SaverState state;
+  std::string* value;
+};
+
+}
+
+static void saveValue(void* arg, const Slice& k, const Slice& v)
+{
+  Saver* s = static_cast<Saver*>(arg);
+  ValueType type;
+  decodeSeqAndType(k.data() + k.size() - KeyTagSize, nullptr, &type);
+  if (type == TypeValue) {
+    s->state = Found;
+    s->value->assign(v.data(), v.size());
+  } else {
+    s->state = Deleted;
+  }
+}
+
+bool Version::get(const ReadOptions& options, const Slice& internalKey,
+                  std::string* value, bool& found, GetStats* stats)
+{
+  stats->seekFile = nullptr;
+  stats->seekFileLevel = -1;
+
+  struct State
+  {
+    Saver saver;
+    GetStats* stats;
+    const ReadOptions* options;
+    Slice internalKey;
+    TableCache* tableCache;
+    std::shared_ptr<FileMeta> lastFileRead;
+    int lastFileReadLevel;
+    bool error;
+
+    static bool match(void* arg, int level, const std::shared_ptr<FileMeta>& f)
+    {
+      State* state = static_cast<State*>(arg);
+
+      if (state->stats->seekFile == nullptr && state->lastFileRead != nullptr) {
+        // We have had more than one seek for this read.  Charge the 1st file.
+        state->stats->seekFile = state->lastFileRead;
+        state->stats->seekFileLevel = state->lastFileReadLevel;
+      }
+
+      state->lastFileRead = f;
+      state->lastFileReadLevel = level;
+
+      if (!state->tableCache->get(*state->options, f->number, f->fileSize,
+                                  state->internalKey, &state->saver, saveValue)) {
+        state->error = true;
+        return false;
+      }
+      // Keep searching in other files while not found
+      return state->saver.state == NotFound;
+    }
+  };
+
+  State state;
+  state.saver.state = NotFound;
+  state.saver.value = value;
+  state.stats = stats;
+  state.options = &options;
+  state.internalKey = internalKey;
+  state.tableCache = _versionSet->_tableCache.get();
+  state.lastFileReadLevel = -1;
+  state.error = false;
+
+  Slice userKey = internalKey;
+  userKey.removeTailfix(KeyTagSize);
+  forEachOverlapping(userKey, &State::match, &state);
+
+  if (state.error) {
+    found = false;
+    return false;
+  }
+  found = (state.saver.state == Found);
+  return state.saver.state != NotFound;
+}
+
+void Version::multiGet(const ReadOptions& options, const Slice* internalKeys, int n,
+                       std::string* values, bool* done, bool* found, GetStats* stats)
+{
+  stats->seekFile = nullptr;
+  stats->seekFileLevel = -1;
+
+  struct State
+  {
+    std::string* values;
+    bool* done;
+    bool* found;
+    // Index in internalKeys of every key of the batch
+    const int* batch;
+
+    static void saveValue(void* arg, int index, const Slice& k, const Slice& v)
+    {
+      State* state = static_cast<State*>(arg);
+      const int i = state->batch[index];
+      ValueType type;
+      decodeSeqAndType(k.data() + k.size() - KeyTagSize, nullptr, &type);
+      state->done[i] = true;
+      state->found[i] = (type == TypeValue);
+      if (type == TypeValue) {
+        state->values[i].assign(v.data(), v.size());
+      }
+    }
+  };
+
+  const Comparator* ucmp = _versionSet->_comparator;
+  TableCache* tableCache = _versionSet->_tableCache.get();
+
+  std::vector<Slice> userKeys(n);
+  for (int i = 0; n > i; i++)
+  {
+    done[i] = false;
+    found[i] = false;
+    userKeys[i] = internalKeys[i];
+    userKeys[i].removeTailfix(KeyTagSize);
+  }
+
+  // First file each key was looked up in, charged as in get() when the
+  // key has to be looked up in another file
+  std::vector<std::shared_ptr<FileMeta>> firstFile(n);
+  std::vector<int> firstFileLevel(n, -1);
+  std::vector<int> batch;
+  std::vector<Slice> batchKeys;
+  auto lookupBatch = [&](int level, const std::shared_ptr<FileMeta>& f) {
+    batchKeys.clear();
+    for (int i : batch)
+    {
+      if (firstFile[i] == nullptr) {
+        firstFile[i] = f;
+        firstFileLevel[i] = level;
+      } else if (stats->seekFile == nullptr) {
+        stats->seekFile = firstFile[i];
+        stats->seekFileLevel = firstFileLevel[i];
+      }
+      batchKeys.push_back(internalKeys[i]);
+    }
+    State state{values, done, found, batch.data()};
+    if (!tableCache->multiGet(options, f->number, f->fileSize, batchKeys.data(),
+                              static_cast<int>(batchKeys.size()), &state, &State::saveValue)) {
+      // Older files may hold stale entries of the keys, stop there
+      for (int i : batch)
+      {
+        done[i] = true;
+        found[i] = false;
+      }
+    }
+  };
+
+  // Search level-0 in order from newest to oldest, a file gets every
+  // unresolved key in its range
+  std::vector<std::shared_ptr<FileMeta>> sortFile(_files[0]);
+  std::sort(sortFile.begin(), sortFile.end(), newestFirst);
+  for (const auto& f : sortFile)
+  {
+    batch.clear();
+    for (int i = 0; n > i; i++) {
+      if (!done[i] && fileOverlaps(ucmp, &userKeys[i], &userKeys[i], f)) batch.push_back(i);
+    }
+    if (!batch.empty()) lookupBatch(0, f);
+  }
+
+  // Files of other levels are sorted and disjoint, so the keys that fall
+  // in one file are next to each other
+  for (int level = 1; MaxFileLevel > level; level++)
+  {
+    if (_files[level].empty()) continue;
+
+    int i = 0;
+    while (n > i)
+    {
+      if (done[i]) {
+        i++;
+        continue;
+      }
+      size_t index = findFile(ucmp, _files[level], userKeys[i]);
+      // The remaining keys are past the last file too
+      if (index >= _files[level].size()) break;
+
+      const auto& f = _files[level][index];
+      batch.clear();
+      for (; n > i; i++)
+      {
+        if (done[i]) continue;
+        if (ucmp->cmp(userKeys[i], f->largest->getUserKey()) > 0) break;
+        if (ucmp->cmp(userKeys[i], f->smallest->getUserKey()) >= 0) batch.push_back(i);
+      }
+      if (!batch.empty()) lookupBatch(level, f);
+    }
+  }
+}
+
+bool Version::updateStats(const GetStats& stats)
+{
+  const auto& f = stats.seekFile;
+  if (f != nullptr) {
+    f->allowedSeek--;
+    if (f->allowedSeek <= 0 && _nextCompactFile == nullptr) {
+      _nextCompactFile = f;
+      _compactFileLevel = stats.seekFileLevel;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Version::forEachOverlapping(const Slice& userKey,
+                                 bool (*func)(void* arg, int level,
+                                              const std::shared_ptr<FileMeta>& f),
+                                 void* arg)
 {
+  const Comparator* ucmp = _versionSet->_comparator;
+
+  // Search level-0 in order from newest to oldest.
   std::vector<std::shared_ptr<FileMeta>> sortFile;
-  auto ucmp = _versionSet->_comparator;
-  auto icmp = std::make_shared<InternalComparator>(_versionSet->_options);
-  
-  sortFile = _files[0];
-  for (auto& file : sortFile)
+  sortFile.reserve(_files[0].size());
+  for (const auto& file : _files[0])
   {
-    if (fileOverlaps(ucmp, userKey, userKey, file)) {
-      if (!func(arg, 0, file.get())) break;
+    if (fileOverlaps(ucmp, &userKey, &userKey, file)) {
+      sortFile.push_back(file);
     }
   }
 
+  if (!sortFile.empty())
+  {
+    std::sort(sortFile.begin(), sortFile.end(), newestFirst);
+    for (const auto& file : sortFile) {
+      if (!func(arg, 0, file)) return;
+    }
+  }
+
+  // Search other levels.
   for (int level = 1; MaxFileLevel > level; level++)
   {
     if (_files[level].empty()) continue;
-    sortFile = _files[level];
-    std::sort(sortFile.begin(), sortFile.end(), NewFileCmp);
 
-    auto index = findFile(icmp, sortFile, internalKey);
-    if (index != sortFile.size() && !func(arg, level, sortFile[index].get())) {
-      return;
+    // Binary search to find earliest index whose largest key >= userKey.
+    size_t index = findFile(ucmp, _files[level], userKey);
+    if (index < _files[level].size()) {
+      const auto& f = _files[level][index];
+      if (ucmp->cmp(userKey, f->smallest->getUserKey()) < 0) {
+        // All of "f" is past any data for userKey
+      } else {
+        if (!func(arg, level, f)) return;
+      }
     }
   }
 }
 
-bool Version::overlapInLevel(int level, const InternalKey* smallestKey,
-                             const InternalKey* largestKey)
+void Version::addIterators(const ReadOptions& options, std::vector<Iterator*>* iters)
+{
+  TableCache* tableCache = _versionSet->_tableCache.get();
+
+  // Level-0 files may overlap each other, merge all of them
+  for (const auto& f : _files[0])
+  {
+    iters->push_back(tableCache->newIterator(f->number, f->fileSize, options));
+  }
+
+  for (int level = 1; MaxFileLevel > level; level++)
+  {
+    if (_files[level].empty()) continue;
+    iters->push_back(new LevelIterator(tableCache, _versionSet->_comparator,
+                                       _files[level], options));
+  }
+}
+
+bool Version::overlapInLevel(int level, const Slice* smallestUserKey,
+                             const Slice* largestUserKey)
 {
   return someFileOverlapsRange(_versionSet->_comparator, (level > 0), _files[level],
-                               smallestKey, largestKey);
+                               smallestUserKey, largestUserKey);
 }
 
-// Store in "*inputs" all files in "level" that overlap [begin,end]
-void Version::getOverlappingInputs(int level, const Slice& beginUserKey,
-                                   const Slice& endUserKey,
+void Version::getOverlappingInputs(int level, const Slice* beginUserKey,
+                                   const Slice* endUserKey,
                                    std::vector<std::shared_ptr<FileMeta>>& inputs)
 {
   assert(level >= 0);
   assert(level < MaxFileLevel);
 
   inputs.clear();
-  std::shared_ptr<Comparator> cmp = _versionSet->_comparator;
+  const Comparator* ucmp = _versionSet->_comparator;
 
-  Slice begin = beginUserKey, end = endUserKey;
+  Slice begin, end;
+  if (beginUserKey != nullptr) begin = *beginUserKey;
+  if (endUserKey != nullptr) end = *endUserKey;
 
   for (size_t i = 0; i < _files[level].size();)
   {
     auto& f = _files[level][i++];
     const Slice fileStart(f->smallest->getUserKey());
     const Slice fileLimit(f->largest->getUserKey());
-    if (begin != nullptr && cmp->cmp(fileLimit, begin) < 0) {
+    if (beginUserKey != nullptr && ucmp->cmp(fileLimit, begin) < 0) {
       // "f" is completely before specified range; skip it
-    } else if (end != nullptr && cmp->cmp(fileStart, end) > 0) {
+    } else if (endUserKey != nullptr && ucmp->cmp(fileStart, end) > 0) {
       // "f" is completely after specified range; skip it
     }
     else
@@ -210,13 +609,13 @@ void Version::getOverlappingInputs(int level, const Slice& beginUserKey,
       {
         // Level-0 files may overlap each other.  So check if the newly
         // added file has expanded the range.  If so, restart search.
-        if (begin != nullptr && cmp->cmp(fileStart, end) < 0)
+        if (beginUserKey != nullptr && ucmp->cmp(fileStart, begin) < 0)
         {
           begin = fileStart;
           inputs.clear();
           i = 0;
         }
-        else if (end != nullptr && cmp->cmp(fileLimit, end) > 0)
+        else if (endUserKey != nullptr && ucmp->cmp(fileLimit, end) > 0)
         {
           end = fileLimit;
           inputs.clear();
@@ -227,26 +626,25 @@ void Version::getOverlappingInputs(int level, const Slice& beginUserKey,
   }
 }
 
-int Version::pickLevelForMemTableOutput(const InternalKey& smallestKey,
-                                        const InternalKey& largestKey)
+int Version::pickLevelForMemTableOutput(const Slice& smallestUserKey,
+                                        const Slice& largestUserKey)
 {
   int level = 0;
-  if (!overlapInLevel(0, &smallestKey, &largestKey))
+  if (!overlapInLevel(0, &smallestUserKey, &largestUserKey))
   {
     std::vector<std::shared_ptr<FileMeta>> overlaps;
     // Push to next level if there is no overlap in next level,
     // and the #bytes overlapping in the level after that are limited.
     while (level < MaxMemCompactLevel)
     {
-      if (overlapInLevel(level + 1, &smallestKey, &largestKey)) {
+      if (overlapInLevel(level + 1, &smallestUserKey, &largestUserKey)) {
         break;
       }
 
       if (level + 2 < MaxFileLevel)
       {
         // Check that file does not overlap too many grandparent bytes.
-        getOverlappingInputs(level + 2, smallestKey.getUserKey(), largestKey.getUserKey(),
-                             overlaps);
+        getOverlappingInputs(level + 2, &smallestUserKey, &largestUserKey, overlaps);
         const int64_t sum = totalFileSize(overlaps);
         if (sum > maxGrandParentOverlapBytes(&(_versionSet->_options))) {
           break;
@@ -263,12 +661,12 @@ class VersionSet::Builder
  private:
   struct FileComparator
   {
-    std::shared_ptr<Comparator> internalComparator;
+    const Comparator* ucmp;
 
-    bool operator()(const std::shared_ptr<FileMeta> f1,
-                    const std::shared_ptr<FileMeta> f2) const
+    bool operator()(const std::shared_ptr<FileMeta>& f1,
+                    const std::shared_ptr<FileMeta>& f2) const
     {
-      int r = internalComparator->cmp(f1->smallest->internalKey, f2->smallest->internalKey);
+      int r = compareInternalKey(ucmp, f1->smallest->internalKey, f2->smallest->internalKey);
       if (r != 0) {
         return (r < 0);
       } else {
@@ -277,7 +675,9 @@ class VersionSet::Builder
     }
   };
 
-  void maybeAddFile(Version* v, int level, std::shared_ptr<FileMeta> f);
+  using FileSet = std::set<std::shared_ptr<FileMeta>, FileComparator>;
+
+  void maybeAddFile(Version* v, int level, const std::shared_ptr<FileMeta>& f);
   
  public:
   Builder(VersionSet* set, Version* version);
@@ -290,22 +690,27 @@ class VersionSet::Builder
  private:
   VersionSet* _set;
   Version* _curVersion;
-  std::shared_ptr<Comparator> _comparator;
-  std::set<std::shared_ptr<FileMeta>, FileComparator> _addedFiles[MaxFileLevel];
+  FileComparator _cmp;
+  std::vector<FileSet> _addedFiles;
   std::set<uint64_t> _deleteFiles[MaxFileLevel];
 };
 
 VersionSet::Builder::Builder(VersionSet* set, Version* version)
       : _set(set),
-        _curVersion(version),
-        _comparator(set->_comparator)
-{version->ref();}
+        _curVersion(version)
+{
+  _cmp.ucmp = set->_comparator;
+  for (int level = 0; MaxFileLevel > level; level++) {
+    _addedFiles.emplace_back(_cmp);
+  }
+  version->ref();
+}
 
 VersionSet::Builder::~Builder()
 {_curVersion->unRef();}
 
 void VersionSet::Builder::maybeAddFile(Version* v, int level,
-                                       std::shared_ptr<FileMeta> f)
+                                       const std::shared_ptr<FileMeta>& f)
 {
   if (_deleteFiles[level].count(f->number) > 0) {
     // Deleted file do nothing
@@ -323,7 +728,7 @@ void VersionSet::Builder::maybeAddFile(Version* v, int level,
 void VersionSet::Builder::apply(VersionEdit* edit)
 {
   // Update compaction pointers
-  for (int i = 0; edit->_compactPoints.size() > i; i++) {
+  for (size_t i = 0; edit->_compactPoints.size() > i; i++) {
     int level = edit->_compactPoints[i].first;
     _set->_compactPoints[level] = edit->_compactPoints[i].second;
   }
@@ -339,8 +744,6 @@ void VersionSet::Builder::apply(VersionEdit* edit)
   {
     int level = pair.first;
     pair.second->ref = 1;
-    int allowedSeek = static_cast<int>(pair.second->fileSize / 16384U);
-    if (allowedSeek < 100) allowedSeek = 100;
     // We arrange to automatically compact this file after
     // a certain number of seeks.  Let's assume:
     //   (1) One seek costs 10ms
@@ -357,6 +760,10 @@ void VersionSet::Builder::apply(VersionEdit* edit)
 
     // That is, we consider compacting this file to the next level
     // when the wasted seek cost on the current file exceeds the cost of compaction.
+    int allowedSeek = static_cast<int>(pair.second->fileSize / 16384U);
+    if (allowedSeek < 100) allowedSeek = 100;
+    pair.second->allowedSeek = allowedSeek;
+
     _deleteFiles[level].erase(pair.second->number);
     _addedFiles[level].insert(pair.second);
   }
@@ -364,9 +771,6 @@ void VersionSet::Builder::apply(VersionEdit* edit)
 
 void VersionSet::Builder::saveTo(Version* v)
 {
-  FileComparator cmp;
-  cmp.internalComparator = _set->_comparator;
-
   for (int level = 0; level < MaxFileLevel; level++)
   {
     const auto& baseFiles = _curVersion->_files[level];
@@ -380,7 +784,7 @@ void VersionSet::Builder::saveTo(Version* v)
     // Merge sort
     for (const auto& file : addedFiles)
     {
-      for (auto bpos = std::upper_bound(baseIter, baseEnd, file, cmp);
+      for (auto bpos = std::upper_bound(baseIter, baseEnd, file, _cmp);
            baseIter != bpos; ++baseIter) {
         maybeAddFile(v, level, *baseIter);
       }
@@ -407,44 +811,49 @@ void VersionSet::Builder::saveTo(Version* v)
   }
 }
 
-VersionSet::VersionSet(const std::string dbName, const Options options,
-                       std::shared_ptr<Comparator> InternalComparator,
+VersionSet::VersionSet(const std::string& dbName, const Options& options,
                        std::shared_ptr<TableCache> tableCache)
       : _dbName(dbName),
         _options(options), 
-        _comparator(InternalComparator),
+        _comparator(options.comparator),
+        _nextFileNumber(2),
+        _manifestFileNumber(0),
+        _lastSequence(0),
+        _logNumber(0),
+        _preLogNumber(0),
         _tableCache(tableCache),
+        _descriptorFile(nullptr),
+        _descriptorLog(nullptr),
         _cur(nullptr),
-        _dummyVersion(this) {}
+        _dummyVersion(this)
+{
+  appendVersion(new Version(this));
+}
 
 VersionSet::~VersionSet()
-{  if (_descriptorLog != nullptr) {
-    delete _descriptorLog;
-  }
-  if (_descriptorFile != nullptr) {
-    delete _descriptorFile;
-  }
+{
+  _cur->unRef();
+  assert(_dummyVersion._next == &_dummyVersion);  // List must be empty
+  // The log owns the descriptor file
+  delete _descriptorLog;
 }
 
-inline int VersionSet::levelTablesNumber(int level) const
+int VersionSet::levelTablesNumber(int level) const
 {
   if (level < 0 || level >= MaxFileLevel) {
     printError("VersionSet: level number error");
+    return 0;
   }
   return _cur->_files[level].size();
 }
 
-inline uint64_t VersionSet::levelTablesBytes(int level) const
+uint64_t VersionSet::levelTablesBytes(int level) const
 {
-  if (level < 0 || level > MaxFileLevel) {
+  if (level < 0 || level >= MaxFileLevel) {
     printError("VersionSet: level number error");
+    return 0;
   }
-  uint64_t result = 0;
-  for (auto f : _cur->_files[level]) {
-    result += f->fileSize;
-  }
-
-  return result;
+  return totalFileSize(_cur->_files[level]);
 }
 
 void VersionSet::finalize(Version* version)
@@ -453,7 +862,7 @@ void VersionSet::finalize(Version* version)
   double baseScore = -1.0;
   double curScore;
 
-  for (int level = 0; MaxFileLevel > level; level++)
+  for (int level = 0; MaxFileLevel - 1 > level; level++)
   {
     if (level == 0)
     {
@@ -472,7 +881,7 @@ void VersionSet::finalize(Version* version)
       curScore = static_cast<double>(version->_files[level].size())
         / static_cast<double>(L0CompactionTrigger);
     } else {
-      curScore = static_cast<double>(levelTablesBytes(level))
+      curScore = static_cast<double>(totalFileSize(version->_files[level]))
         / static_cast<double>(maxBytesForLevel(level));
     }
 
@@ -482,7 +891,7 @@ void VersionSet::finalize(Version* version)
     }
   }
 
-  version->_compactFileLevel = baseLevel;
+  version->_compactionLevel = baseLevel;
   version->_compactionScore = baseScore;
 }
 
@@ -540,18 +949,16 @@ bool VersionSet::parseManifestFile(log::Reader* reader, Version *version)
   uint64_t lastSequence = 0;
   uint64_t logNumber = 0;
   uint64_t prevLogNumber = 0;
-  int readRecords = 0;
 
   Slice record;
-  std::string scratch(log::recordBlockSize, '\0');
+  std::string scratch;
   Builder builder(this, _cur);
 
   while (reader->readRecord(&record, &scratch))
   {
-    readRecords++;
     VersionEdit edit;
     
-    if (edit.decode(record)) {
+    if (!edit.decode(record)) {
       printError("VersionSet: decode manifest record error");
       return false;
     }
@@ -598,14 +1005,10 @@ bool VersionSet::parseManifestFile(log::Reader* reader, Version *version)
     prevLogNumber = 0;
   }
 
-  if (_nextFileNumber <= prevLogNumber) {
-    _nextFileNumber = prevLogNumber+ 1;
-  }
-
-  if (_nextFileNumber <= logNumber) {
-    _nextFileNumber = logNumber + 1;
-  }
+  markFileNumberUsed(prevLogNumber);
+  markFileNumberUsed(logNumber);
 
+  // A new MANIFEST is written with the next file number
   _manifestFileNumber = nextFile;
   _nextFileNumber = nextFile + 1;
   _lastSequence = lastSequence;
@@ -635,8 +1038,6 @@ bool VersionSet::logAndApply(VersionEdit& edit, sync::Mutex* mu) noexcept
   edit.setLastSequence(_lastSequence);
 
   Version* v = new Version(this);
-  if (v == nullptr) return false;
-
   {
     Builder builder(this, _cur);
     builder.apply(&edit);
@@ -653,12 +1054,18 @@ bool VersionSet::logAndApply(VersionEdit& edit, sync::Mutex* mu) noexcept
     assert(_descriptorFile == nullptr);
     newManifestFile = generateDescriptorFileName(_manifestFileNumber, _dbName);
     _options.env->newWritableFile(newManifestFile, &_descriptorFile);
+    if (_descriptorFile == nullptr) {
+      printError("VersionSet: create manifest file error");
+      delete v;
+      return false;
+    }
     // Writer need crc code
     _descriptorLog = new log::Writer(_descriptorFile);
     saveSnapshot(_descriptorLog);
   }
 
   // Unlock during expensive MANIFEST log write
+  bool success = true;
   {
     mu->unlock();
 
@@ -666,15 +1073,21 @@ bool VersionSet::logAndApply(VersionEdit& edit, sync::Mutex* mu) noexcept
     std::string record;
     edit.encode(&record);
     _descriptorLog->appendRecord(record);
-    _descriptorFile->sync();
+    _descriptorLog->sync();
 
     if (!newManifestFile.empty()) {
-      setCurrentFile(_options.env, _dbName, _manifestFileNumber);
+      success = setCurrentFile(_options.env, _dbName, _manifestFileNumber);
     }
 
     mu->Lock();
   }
 
+  if (!success) {
+    printError("VersionSet: set current file error");
+    delete v;
+    return false;
+  }
+
   // Update new version
   appendVersion(v);
   _logNumber = edit._logNumber;
@@ -702,29 +1115,286 @@ bool VersionSet::resume()
     return false;
   }
 
+  if (manifestFileName.empty() || manifestFileName.back() != '\n') {
+    printError("VersionSet: CURRENT file does not end with newline");
+    return false;
+  }
+  manifestFileName.resize(manifestFileName.size() - 1);
+
   SequentialFile* manifestFile = nullptr;
-  _options.env->newSequentialFile(manifestFileName, &manifestFile);
+  _options.env->newSequentialFile(_dbName + "/" + manifestFileName, &manifestFile);
 
   if (manifestFile == nullptr) {
     printError("VersionSet: open manifest file error");
     return false;
   }
 
+  // The reader takes the ownership of manifestFile
   log::Reader reader(manifestFile, 0, true);
   Version* version = new Version(this);
 
   if (!parseManifestFile(&reader, version)) {
     printError("VersionSet: parseManifestFile error");
-    delete manifestFile;
     delete version;
     return false;
   }
 
   finalize(version); 
   appendVersion(version);
-  delete manifestFile;
-  delete version;
   return true;
 }
 
-}
\ No newline at end of file
+Compaction* VersionSet::pickCompaction()
+{
+  Compaction* c;
+  int level;
+
+  // We prefer compactions triggered by too much data in a level over
+  // the compactions triggered by seeks.
+  const bool sizeCompaction = (_cur->_compactionScore >= 1);
+  const bool seekCompaction = (_cur->_nextCompactFile != nullptr);
+  if (sizeCompaction)
+  {
+    level = _cur->_compactionLevel;
+    assert(level >= 0);
+    assert(level + 1 < MaxFileLevel);
+    c = new Compaction(&_options, level);
+
+    // Pick the first file that comes after _compactPoints[level]
+    for (const auto& f : _cur->_files[level])
+    {
+      if (_compactPoints[level].empty() ||
+          compareInternalKey(_comparator, f->largest->internalKey, _compactPoints[level]) > 0) {
+        c->_inputs[0].push_back(f);
+        break;
+      }
+    }
+    if (c->_inputs[0].empty()) {
+      // Wrap-around to the beginning of the key space
+      c->_inputs[0].push_back(_cur->_files[level][0]);
+    }
+  }
+  else if (seekCompaction)
+  {
+    level = _cur->_compactFileLevel;
+    c = new Compaction(&_options, level);
+    c->_inputs[0].push_back(_cur->_nextCompactFile);
+  }
+  else
+  {
+    return nullptr;
+  }
+
+  c->_inputVersion = _cur;
+  c->_inputVersion->ref();
+
+  // Files in level 0 may overlap each other, so pick up all overlapping ones
+  if (level == 0)
+  {
+    Slice smallest = c->_inputs[0][0]->smallest->getUserKey();
+    Slice largest = c->_inputs[0][0]->largest->getUserKey();
+    // Note that the next call will discard the file we placed in
+    // c->_inputs[0] earlier and replace it with an overlapping set
+    // which will include the picked file.
+    _cur->getOverlappingInputs(0, &smallest, &largest, c->_inputs[0]);
+    assert(!c->_inputs[0].empty());
+  }
+
+  setupOtherInputs(c);
+  return c;
+}
+
+// Stores the minimal range that covers all entries in inputs in
+// *smallest, *largest.
+// REQUIRES: inputs is not empty
+static void getRange(const Comparator* ucmp,
+                     const std::vector<std::shared_ptr<FileMeta>>& inputs,
+                     std::string* smallest, std::string* largest)
+{
+  assert(!inputs.empty());
+  smallest->clear();
+  largest->clear();
+  for (size_t i = 0; inputs.size() > i; i++)
+  {
+    const auto& f = inputs[i];
+    if (i == 0) {
+      *smallest = f->smallest->internalKey;
+      *largest = f->largest->internalKey;
+    } else {
+      if (compareInternalKey(ucmp, f->smallest->internalKey, *smallest) < 0) {
+        *smallest = f->smallest->internalKey;
+      }
+      if (compareInternalKey(ucmp, f->largest->internalKey, *largest) > 0) {
+        *largest = f->largest->internalKey;
+      }
+    }
+  }
+}
+
+static Slice userKeyOf(const std::string& internalKey)
+{ return Slice(internalKey.data(), internalKey.size() - KeyTagSize); }
+
+void VersionSet::setupOtherInputs(Compaction* c)
+{
+  const int level = c->level();
+  std::string smallest, largest;
+
+  getRange(_comparator, c->_inputs[0], &smallest, &largest);
+  Slice smallestUserKey = userKeyOf(smallest), largestUserKey = userKeyOf(largest);
+  _cur->getOverlappingInputs(level + 1, &smallestUserKey, &largestUserKey, c->_inputs[1]);
+
+  // Get entire range covered by compaction
+  std::string allStart, allLimit;
+  std::vector<std::shared_ptr<FileMeta>> all = c->_inputs[0];
+  all.insert(all.end(), c->_inputs[1].begin(), c->_inputs[1].end());
+  getRange(_comparator, all, &allStart, &allLimit);
+
+  // See if we can grow the number of inputs in "level" without
+  // changing the number of "level+1" files we pick up.
+  if (!c->_inputs[1].empty())
+  {
+    std::vector<std::shared_ptr<FileMeta>> expanded0;
+    Slice allStartUserKey = userKeyOf(allStart), allLimitUserKey = userKeyOf(allLimit);
+    _cur->getOverlappingInputs(level, &allStartUserKey, &allLimitUserKey, expanded0);
+    const int64_t inputs1Size = totalFileSize(c->_inputs[1]);
+    const int64_t expanded0Size = totalFileSize(expanded0);
+    if (expanded0.size() > c->_inputs[0].size() &&
+        inputs1Size + expanded0Size < expandedCompactionByteSizeLimit(&_options))
+    {
+      std::string newStart, newLimit;
+      getRange(_comparator, expanded0, &newStart, &newLimit);
+      Slice newStartUserKey = userKeyOf(newStart), newLimitUserKey = userKeyOf(newLimit);
+      std::vector<std::shared_ptr<FileMeta>> expanded1;
+      _cur->getOverlappingInputs(level + 1, &newStartUserKey, &newLimitUserKey, expanded1);
+      if (expanded1.size() == c->_inputs[1].size())
+      {
+        smallest = newStart;
+        largest = newLimit;
+        c->_inputs[0] = expanded0;
+        c->_inputs[1] = expanded1;
+        all = c->_inputs[0];
+        all.insert(all.end(), c->_inputs[1].begin(), c->_inputs[1].end());
+        getRange(_comparator, all, &allStart, &allLimit);
+      }
+    }
+  }
+
+  // Compute the set of grandparent files that overlap this compaction
+  // (parent == level+1; grandparent == level+2)
+  if (level + 2 < MaxFileLevel) {
+    Slice allStartUserKey = userKeyOf(allStart), allLimitUserKey = userKeyOf(allLimit);
+    _cur->getOverlappingInputs(level + 2, &allStartUserKey, &allLimitUserKey,
+                               c->_grandparents);
+  }
+
+  // Update the place where we will do the next compaction for this level.
+  // We update this immediately instead of waiting for the VersionEdit
+  // to be applied so that if the compaction fails, we will try a different
+  // key range next time.
+  _compactPoints[level] = largest;
+  c->_edit.setCompactPointer(level, largest);
+}
+
+Compaction* VersionSet::compactRange(int level, const Slice* beginUserKey,
+                                     const Slice* endUserKey)
+{
+  std::vector<std::shared_ptr<FileMeta>> inputs;
+  _cur->getOverlappingInputs(level, beginUserKey, endUserKey, inputs);
+  if (inputs.empty()) {
+    return nullptr;
+  }
+
+  // Avoid compacting too much in one shot in case the range is large.
+  // But we cannot do this for level-0 since level-0 files can overlap
+  // and we must not pick one file and drop another older file if the
+  // two files overlap.
+  if (level > 0)
+  {
+    const uint64_t limit = _options.max_file_size;
+    uint64_t total = 0;
+    for (size_t i = 0; inputs.size() > i; i++)
+    {
+      total += inputs[i]->fileSize;
+      if (total >= limit) {
+        inputs.resize(i + 1);
+        break;
+      }
+    }
+  }
+
+  Compaction* c = new Compaction(&_options, level);
+  c->_inputVersion = _cur;
+  c->_inputVersion->ref();
+  c->_inputs[0] = inputs;
+  setupOtherInputs(c);
+  return c;
+}
+
+Iterator* VersionSet::makeInputIterator(Compaction* c)
+{
+  // Inputs are read from start to end, always read ahead
+  ReadOptions options;
+  options.fill_cache = false;
+  options.readahead_size = _options.compaction_readahead_size;
+
+  // Level-0 files have to be merged together.  For other levels,
+  // we will make a concatenating iterator per level.
+  std::vector<Iterator*> list;
+  for (int which = 0; 2 > which; which++)
+  {
+    if (c->_inputs[which].empty()) continue;
+
+    if (c->level() + which == 0) {
+      for (const auto& f : c->_inputs[which]) {
+        list.push_back(_tableCache->newIterator(f->number, f->fileSize, options));
+      }
+    } else {
+      // Create concatenating iterator for the files from this level
+      list.push_back(new LevelIterator(_tableCache.get(), _comparator, c->_inputs[which],
+                                       options));
+    }
+  }
+
+  return newMergingIterator(_comparator, list.data(), static_cast<int>(list.size()));
+}
+
+void VersionSet::splitCompaction(Compaction* c, int maxRanges,
+                                 std::vector<std::string>* boundaries)
+{
+  boundaries->clear();
+  if (maxRanges <= 1) return;
+
+  // The first key of every input data block is a candidate boundary
+  std::vector<std::string> keys;
+  for (int which = 0; 2 > which; which++)
+  {
+    for (const auto& f : c->_inputs[which]) {
+      _tableCache->dataBlockKeys(f->number, f->fileSize, &keys);
+    }
+  }
+
+  std::vector<Slice> userKeys;
+  userKeys.reserve(keys.size());
+  for (const auto& key : keys) {
+    if (key.size() >= KeyTagSize) userKeys.push_back(userKeyOf(key));
+  }
+
+  const Comparator* ucmp = _comparator;
+  std::sort(userKeys.begin(), userKeys.end(),
+            [ucmp](const Slice& a, const Slice& b) { return ucmp->cmp(a, b) < 0; });
+  userKeys.erase(std::unique(userKeys.begin(), userKeys.end(),
+                             [ucmp](const Slice& a, const Slice& b) { return ucmp->cmp(a, b) == 0; }),
+                 userKeys.end());
+
+  // Pick evenly spaced keys, the smallest one would only make an empty range
+  const size_t ranges = std::min(static_cast<size_t>(maxRanges), userKeys.size());
+  for (size_t i = 1; ranges > i; i++)
+  {
+    const Slice& key = userKeys[i * userKeys.size() / ranges];
+    if (boundaries->empty() || ucmp->cmp(key, boundaries->back()) > 0) {
+      boundaries->push_back(key.toString());
+    }
+  }
+}
+
+}
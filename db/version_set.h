@@ -2,59 +2,102 @@
 #define YUNDB_DB_VERSION_SET_H
 
 #include "dbformat.h"
+#include "yundb/iterator.h"
 #include "version_edit.h"
 #include "util/sync.h"
 #include "log_writer.h"
+#include "log_reader.h"
 
 #include <memory>
 #include <vector>
 #include <array>
 
-class TableCache;
-
 namespace yundb
 {
 
-// Return the smallest index i such that files[i]->largest >= key.
-// Return files.size() if there is no such file.
+class Compaction;
+class TableCache;
+
+// Return the smallest index i such that the largest user key of files[i]
+// is >= userKey. Return files.size() if there is no such file.
 // REQUIRES: "files" contains a sorted list of non-overlapping files.
-int findFile(const std::shared_ptr<Comparator> cmp,
+int findFile(const Comparator* ucmp,
              const std::vector<std::shared_ptr<FileMeta>>& files,
-             const Slice& key);
+             const Slice& userKey);
 
 // Returns true iff some file in "files" overlaps the user key range
-// [*smallest,*largest].
-// smallest==nullptr represents a key smaller than all keys in the DB.
-// largest==nullptr represents a key largest than all keys in the DB.
-// REQUIRES: If disjoint_sorted_files, files[] contains disjoint ranges
+// [*smallestUserKey,*largestUserKey].
+// smallestUserKey==nullptr represents a key smaller than all keys in the DB.
+// largestUserKey==nullptr represents a key largest than all keys in the DB.
+// REQUIRES: If disjointSortedFiles, files[] contains disjoint ranges
 //           in sorted order.
-bool someFileOverlapsRange(const std::shared_ptr<Comparator> cmp,
+bool someFileOverlapsRange(const Comparator* ucmp,
                            bool disjointSortedFiles,
                            const std::vector<std::shared_ptr<FileMeta>>& files,
-                           const InternalKey* smallestKey,
-                           const InternalKey* largestKey);
+                           const Slice* smallestUserKey,
+                           const Slice* largestUserKey);
 class VersionSet;
 
 class Version
 {
  public:
+  // The first file probed by a get() that had to look further
+  struct GetStats
+  {
+    std::shared_ptr<FileMeta> seekFile;
+    int seekFileLevel;
+  };
+
+  // Lookup the value of internalKey in the tables of this version.
+  // Return true if an entry is found, found is set to false if the
+  // entry is a deletion. Fills *stats. A table that can not be read
+  // ends the lookup with false, since the older files after it may
+  // hold a stale entry of the key.
+  // REQUIRES: lock is not held
+  bool get(const ReadOptions& options, const Slice& internalKey,
+           std::string* value, bool& found, GetStats* stats);
+
+  // Batched get of internalKeys[0..n-1], sorted by user key. Keys are
+  // grouped by the files they fall in and every table is searched once
+  // for its whole group. done[i] is set if an entry of key i is found and
+  // found[i] is false if that entry is a deletion. A key whose table can
+  // not be read is done with found[i] false, like in get(). Fills *stats.
+  // REQUIRES: lock is not held
+  void multiGet(const ReadOptions& options, const Slice* internalKeys, int n,
+                std::string* values, bool* done, bool* found, GetStats* stats);
+
+  // Adds "stats" into the current state.  Returns true if a new
+  // compaction may need to be triggered, false otherwise.
+  // REQUIRES: lock is held
+  bool updateStats(const GetStats& stats);
+
   // Call func(arg, level, f) for every file that overlaps user_key in
   // order from newest to oldest.  If an invocation of func returns
   // false, makes no more calls.
-  // REQUIRES: user portion of internal_key == user_key.
-  void forEachOverlapping(const Slice& userKey, const Slice& internalKey,
-                          bool (*func)(void* arg, int level, FileMeta* f), void* arg);
+  void forEachOverlapping(const Slice& userKey,
+                          bool (*func)(void* arg, int level,
+                                       const std::shared_ptr<FileMeta>& f),
+                          void* arg);
   // Returns true iff some file in the specified level overlaps
-  // some part of [*smallest_internalkey,*largest_internalkey].
-  // smallest_internalkey==nullptr represents a key smaller than all the DB's keys.
-  // largest_internalkey==nullptr represents a key largest than all the DB's keys.
-  bool overlapInLevel(int level, const InternalKey* smallestKey, const InternalKey* largestKey);
+  // some part of [*smallestUserKey,*largestUserKey].
+  // smallestUserKey==nullptr represents a key smaller than all the DB's keys.
+  // largestUserKey==nullptr represents a key largest than all the DB's keys.
+  bool overlapInLevel(int level, const Slice* smallestUserKey, const Slice* largestUserKey);
+  // Store in "inputs" all files in "level" that overlap [begin,end].
   // Begin is nullptr means before all keys
   // end is nullptr means after all keys
-  void getOverlappingInputs(int level, const Slice& beginUserKey, const Slice& endUserKey,
+  void getOverlappingInputs(int level, const Slice* beginUserKey, const Slice* endUserKey,
                             std::vector<std::shared_ptr<FileMeta>>& inputs);
+  // Append to *iters a sequence of iterators that will
+  // yield the contents of this Version when merged together.
+  // Level-0 tables are added one by one, every other level is added
+  // as one iterator that opens its tables lazily.
+  // REQUIRES: files of level > 0 are sorted by key and disjoint
+  void addIterators(const ReadOptions& options, std::vector<Iterator*>* iters);
   // Return a level for compact memtable
-  int pickLevelForMemTableOutput(const InternalKey& smallestKey, const InternalKey& largestKey);
+  int pickLevelForMemTableOutput(const Slice& smallestUserKey, const Slice& largestUserKey);
+
+  int numFiles(int level) const { return static_cast<int>(_files[level].size()); }
 
   void ref();
 
@@ -65,7 +108,6 @@ class Version
   explicit Version(VersionSet* versonSet)
       : _ref(0),
         _compactFileLevel(-1),
-        _compactFile(nullptr),
         _compactionScore(-1),
         _compactionLevel(-1),
         _versionSet(versonSet),
@@ -76,12 +118,12 @@ class Version
 
   ~Version();
 
+  friend class Compaction;
   friend class VersionSet;
 
   int _ref;
-  // Next compact file and level based on seek stats.
+  // Level of _nextCompactFile
   int _compactFileLevel;
-  FileMeta* _compactFile;
   // Level that should be size compacted next and its compaction score.
   // Score < 1 means compaction is not strictly needed.  These fields
   // are initialized by VersionSet::Finalize().
@@ -99,8 +141,7 @@ class Version
 class VersionSet
 {
  public:
-  VersionSet(const std::string dbName, const Options options,
-             std::shared_ptr<Comparator> internalComparator,
+  VersionSet(const std::string& dbName, const Options& options,
              std::shared_ptr<TableCache> tableCache);
 
   ~VersionSet();
@@ -124,9 +165,63 @@ class VersionSet
 
   uint64_t getNewFileNumber() {return _nextFileNumber++;}
 
-  inline int levelTablesNumber(int level) const;
+  // Arrange to reuse "fileNumber" unless a newer file number has
+  // already been allocated.
+  // REQUIRES: "fileNumber" was returned by a call to getNewFileNumber().
+  void reuseFileNumber(uint64_t fileNumber)
+  {
+    if (_nextFileNumber == fileNumber + 1) _nextFileNumber = fileNumber;
+  }
+
+  // Mark the specified file number as used.
+  void markFileNumberUsed(uint64_t number)
+  {
+    if (_nextFileNumber <= number) _nextFileNumber = number + 1;
+  }
+
+  uint64_t getLastSequence() const { return _lastSequence; }
 
-  inline uint64_t levelTablesBytes(int level) const;
+  void setLastSequence(uint64_t seq) { _lastSequence = seq; }
+
+  // Return the current log file number
+  uint64_t getLogNumber() const { return _logNumber; }
+
+  // Return the log file number for the log file that is currently
+  // being compacted, or zero if there is no such log file.
+  uint64_t getPreLogNumber() const { return _preLogNumber; }
+
+  int levelTablesNumber(int level) const;
+
+  uint64_t levelTablesBytes(int level) const;
+
+  // Pick level and inputs for a new compaction.
+  // Returns nullptr if there is no compaction to be done.
+  // Otherwise returns a heap-allocated object that describes the compaction.
+  // Caller should delete the result.
+  Compaction* pickCompaction();
+
+  // Return a compaction object for compacting the range [begin,end] in
+  // the specified level.  Returns nullptr if there is nothing in that
+  // level that overlaps the specified range.  Caller should delete
+  // the result.
+  Compaction* compactRange(int level, const Slice* beginUserKey, const Slice* endUserKey);
+
+  // Create an iterator that reads over the compaction inputs for "*c".
+  // The caller should delete the iterator when no longer needed.
+  Iterator* makeInputIterator(Compaction* c);
+
+  // Split the user key space of "*c" into at most maxRanges ranges that
+  // hold about the same number of input data blocks. The user keys that
+  // separate the ranges are stored in *boundaries in ascending order,
+  // range i is [boundaries[i-1], boundaries[i]).
+  // Only reads the inputs of "*c", so the lock need not be held.
+  void splitCompaction(Compaction* c, int maxRanges, std::vector<std::string>* boundaries);
+
+  // Returns true iff some level needs a compaction.
+  bool needsCompaction() const
+  {
+    return (_cur->_compactionScore >= 1) || (_cur->_nextCompactFile != nullptr);
+  }
 
  private:
   // Choice level for compaction
@@ -138,13 +233,17 @@ class VersionSet
 
   bool parseManifestFile(log:: Reader* reader, Version *version);
 
+  void setupOtherInputs(Compaction* c);
+
   class Builder;
+  friend class Compaction;
   friend class Version;
   friend class VersionEdit;
-  
+
   const std::string _dbName;
   const Options _options;
-  std::shared_ptr<Comparator> _comparator;
+  // User key comparator
+  const Comparator* _comparator;
   uint64_t _nextFileNumber;
   uint64_t _manifestFileNumber;
   uint64_t _lastSequence;
@@ -152,7 +251,7 @@ class VersionSet
   uint64_t _preLogNumber;
 
   std::shared_ptr<TableCache> _tableCache;
-  // Opened lazily
+  // Opened lazily, owned by _descriptorLog
   WritableFile* _descriptorFile;
   log::Writer* _descriptorLog;
   // Cur version
@@ -166,4 +265,4 @@ class VersionSet
 
 }
 
-#endif // YUNDB_DB_VERSION_SET_H
\ No newline at end of file
+#endif // YUNDB_DB_VERSION_SET_H
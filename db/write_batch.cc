@@ -2,6 +2,8 @@
 
 #include "util/coding.h"
 #include "db/dbformat.h"
+#include "db/memtable.h"
+#include "db/write_batch_internal.h"
 
 // WriteBatch::rep_ :=
 //    sequence: fixed64
@@ -14,12 +16,13 @@
 //    len: varint32
 //    data: uint8[len]
 
-constexpr size_t HeaderSize = 8;
-
 namespace yundb
 {
 
-WriteBatch::WriteBatch() : rep_() {}
+// Sequence fixed64 + count fixed32
+constexpr size_t HeaderSize = 12;
+
+WriteBatch::WriteBatch() : rep_() { clear(); }
 
 WriteBatch::~WriteBatch() { clear(); }
 
@@ -44,7 +47,7 @@ void WriteBatch::clear()
   rep_.resize(HeaderSize);
 }
 
-SequenceNumber WriteBatch::insert(MemTable* memtable, SequenceNumber seq) const
+SequenceNumber WriteBatch::insert(MemTable* memtable, SequenceNumber seq, bool concurrent) const
 {
   Slice input(rep_);
   if (input.size() < HeaderSize) {
@@ -66,14 +69,22 @@ SequenceNumber WriteBatch::insert(MemTable* memtable, SequenceNumber seq) const
     case TypeValue:
       GetLengthPrefixedSlice(&input, &key);
       GetLengthPrefixedSlice(&input, &value);
-      memtable->add(curSeq, TypeValue, key, value);
+      if (concurrent) {
+        memtable->addConcurrently(curSeq, TypeValue, key, value);
+      } else {
+        memtable->add(curSeq, TypeValue, key, value);
+      }
       break;
     case TypeDeletion:
       GetLengthPrefixedSlice(&input, &key);
-      memtable->add(curSeq, TypeDeletion, key, Slice());
+      if (concurrent) {
+        memtable->addConcurrently(curSeq, TypeDeletion, key, Slice());
+      } else {
+        memtable->add(curSeq, TypeDeletion, key, Slice());
+      }
       break;
     default:
-      printError("WriteBatch::insert: unknown WriteBatch tag type %d", type);
+      printError("WriteBatch::insert: unknown WriteBatch tag type", static_cast<int>(type));
       break;
     } 
     found++;
@@ -89,14 +100,34 @@ size_t WriteBatch::approximateSize() const
 void WriteBatch::append(const WriteBatch& source)
 {
   setCount(count() + source.count());
-  rep_.append(source.rep_.data() + HeaderSize + 4,
-              source.rep_.size() - HeaderSize - 4);
+  rep_.append(source.rep_.data() + HeaderSize,
+              source.rep_.size() - HeaderSize);
 }
 
 uint32_t WriteBatch::count() const
-{ return DecodeFixed32(&rep_[HeaderSize]); }
+{ return DecodeFixed32(&rep_[8]); }
 
 void WriteBatch::setCount(uint32_t n)
-{ EncodeFixed32(&rep_[HeaderSize], n); }
+{ EncodeFixed32(&rep_[8], n); }
+
+SequenceNumber WriteBatchInternal::sequence(const WriteBatch* batch)
+{ return DecodeFixed64(batch->rep_.data()); }
+
+void WriteBatchInternal::setSequence(WriteBatch* batch, SequenceNumber seq)
+{ EncodeFixed64(&batch->rep_[0], seq); }
+
+bool WriteBatchInternal::setContents(WriteBatch* batch, const Slice& contents)
+{
+  if (contents.size() < HeaderSize) {
+    printError("WriteBatch: malformed contents, too small");
+    return false;
+  }
+  batch->rep_.assign(contents.data(), contents.size());
+  return true;
+}
+
+SequenceNumber WriteBatchInternal::insertInto(const WriteBatch* batch, MemTable* memtable,
+                                              bool concurrent)
+{ return batch->insert(memtable, sequence(batch), concurrent); }
 
 }
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef YUNDB_DB_WRITE_BATCH_INTERNAL_H
+#define YUNDB_DB_WRITE_BATCH_INTERNAL_H
+
+#include "yundb/write_batch.h"
+
+namespace yundb
+{
+
+class MemTable;
+
+// WriteBatchInternal provides static methods for manipulating a
+// WriteBatch that we don't want in the public WriteBatch interface.
+class WriteBatchInternal
+{
+ public:
+  // Return the number of entries in the batch.
+  static uint32_t count(const WriteBatch* batch) { return batch->count(); }
+
+  // Set the count for the number of entries in the batch.
+  static void setCount(WriteBatch* batch, uint32_t n) { batch->setCount(n); }
+
+  // Return the sequence number for the start of this batch.
+  static SequenceNumber sequence(const WriteBatch* batch);
+
+  // Store the specified number as the sequence number for the start of
+  // this batch.
+  static void setSequence(WriteBatch* batch, SequenceNumber seq);
+
+  static Slice contents(const WriteBatch* batch) { return Slice(batch->rep_); }
+
+  static size_t byteSize(const WriteBatch* batch) { return batch->rep_.size(); }
+
+  // Return false if contents is not a batch
+  static bool setContents(WriteBatch* batch, const Slice& contents);
+
+  // Insert the batch at its own sequence, return the next sequence.
+  // concurrent lets other batches be inserted into memtable meanwhile.
+  static SequenceNumber insertInto(const WriteBatch* batch, MemTable* memtable,
+                                   bool concurrent = false);
+};
+
+}
+
+#endif // YUNDB_DB_WRITE_BATCH_INTERNAL_H
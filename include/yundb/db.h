@@ -74,6 +74,13 @@ class DB
   virtual bool Get(const ReadOptions& options, const Slice& key,
                    std::string* value) = 0;
 
+  // Look up keys[0..n-1] as if by Get() on one snapshot of the database.
+  // Sets found[i] to what Get() would return for keys[i] and values[i] to
+  // its value when found[i] is true. Lookups that fall in the same table
+  // or data block share one read of it.
+  virtual void MultiGet(const ReadOptions& options, const Slice* keys, int n,
+                        std::string* values, bool* found) = 0;
+
   // Return a heap-allocated iterator over the contents of the database.
   // The result of NewIterator() is initially invalid (caller must
   // call one of the Seek methods on the iterator before using it).
@@ -100,14 +107,17 @@ class DB
   //
   // Valid property names include:
   //
-  //  "leveldb.num-files-at-level<N>" - return the number of files at level <N>,
+  //  "yundb.num-files-at-level<N>" - return the number of files at level <N>,
   //     where <N> is an ASCII representation of a level number (e.g. "0").
-  //  "leveldb.stats" - returns a multi-line string that describes statistics
-  //     about the internal operation of the DB.
-  //  "leveldb.sstables" - returns a multi-line string that describes all
-  //     of the sstables that make up the db contents.
-  //  "leveldb.approximate-memory-usage" - returns the approximate number of
-  //     bytes of memory in use by the DB.
+  //  "yundb.approximate-memory-usage" - returns the approximate number of
+  //     bytes of memory used by the memtables.
+  //  "yundb.num-immutable-mem-table" - returns the number of full
+  //     memtables that have not been flushed yet.
+  //  "yundb.block-cache-hits" - returns the number of data block reads
+  //     served by the block cache.
+  //  "yundb.block-cache-misses" - returns the number of data block reads
+  //     that went to the table file.
+  //  "yundb.block-cache-usage" - returns the bytes charged to the block cache.
   virtual bool GetProperty(const Slice& property, std::string* value) = 0;
 
   // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -22,6 +22,17 @@ class FileLock;
 class Env
 {
  public:
+  // Background work runs on one thread pool per priority, so work of
+  // one priority never waits behind work of another
+  enum Priority
+  {
+    // Compactions
+    LowPriority = 0,
+    // Memtable flushes
+    HighPriority = 1,
+    PriorityNum = 2
+  };
+
   Env();
 
   virtual ~Env();
@@ -40,6 +51,28 @@ class Env
 
   virtual void newRandomAccessFile(const std::string& fileName, RandomAccessFile** result) = 0;
 
+  // Same as newWritableFile, but the file is written with O_DIRECT and
+  // bypasses the page cache. Falls back to newWritableFile where the
+  // file system does not support direct I/O.
+  virtual void newDirectWritableFile(const std::string& fileName, WritableFile** result);
+
+  // Same as newRandomAccessFile, but reads bypass the page cache. Falls
+  // back to newRandomAccessFile where direct I/O is not supported.
+  virtual void newDirectRandomAccessFile(const std::string& fileName,
+                                         RandomAccessFile** result);
+
+  // Rename oldFileName to fileName and open it for writing from the
+  // start without truncating it, so writes overwrite blocks that are
+  // already allocated. The default renames and calls newWritableFile.
+  virtual void reuseWritableFile(const std::string& oldFileName,
+                                 const std::string& fileName, WritableFile** result);
+
+  // Serve RandomAccessFile::multiRead of the files opened afterwards with
+  // io_uring, so the reads of a batch are in flight together. Return
+  // false if the kernel does not support it, reads then use pread.
+  // Files opened with io_uring are not memory mapped.
+  virtual bool setUseIoUring(bool use);
+
   // Returns true iff the named file exists.
   virtual bool fileExists(const std::string& fileName) = 0;
 
@@ -79,13 +112,24 @@ class Env
   // REQUIRES: lock has not already been unlocked.
   virtual bool unlockFile(FileLock* lock) = 0;
 
-    // Arrange to run "(*function)(arg)" once in a background thread.
+  // Arrange to run "(*function)(arg)" once in a background thread of
+  // the pool of priority pri.
   //
   // "function" may run in an unspecified thread.  Multiple functions
   // added to the same Env may run concurrently in different threads.
   // I.e., the caller may not assume that background work items are
   // serialized.
-  virtual void schedule(void (*function)(void* arg), void* arg) = 0;
+  virtual void schedule(void (*function)(void* arg), void* arg,
+                        Priority pri = LowPriority) = 0;
+
+  // Set the number of threads of the pool of priority pri. Extra threads
+  // exit once they are idle. Every pool has one thread by default.
+  virtual void setBackgroundThreads(int number, Priority pri) = 0;
+
+  virtual int getBackgroundThreads(Priority pri) = 0;
+
+  // Number of scheduled functions of pool pri that have not started yet
+  virtual int getThreadPoolQueueLen(Priority pri) = 0;
 
   // Start a new thread, invoking "function(arg)" within the new thread.
   // When "function(arg)" returns, the thread will be destroyed.
@@ -112,6 +156,18 @@ class SequentialFile
   virtual bool read(Slice* str, char* scratch, uint64_t bytes) = 0;
 };
 
+// One read of RandomAccessFile::multiRead
+struct ReadRequest
+{
+  uint64_t offset;
+  uint64_t bytes;
+  // Room for bytes, result may point into it
+  char* scratch;
+  // Set by multiRead as read() sets *str and its return value
+  Slice result;
+  bool ok;
+};
+
 /* Random read a file */
 class RandomAccessFile
 {
@@ -130,6 +186,26 @@ class RandomAccessFile
   // Safe for concurrent use by multiple threads.
   virtual bool read(uint64_t offset, Slice* str,
                     char* scratch, uint64_t bytes) const = 0;
+
+  // True if read() returns slices into memory that stays valid and
+  // unchanged as long as the file is open, such as a memory mapping.
+  // Callers may then keep the slices instead of copying them.
+  virtual bool isMemoryMapped() const { return false; }
+
+  // Hint that [offset, offset + bytes) will be read soon, so the file
+  // system can start to read it. Does nothing by default.
+  virtual void prefetch(uint64_t offset, uint64_t bytes) const
+  {
+    (void)offset;
+    (void)bytes;
+  }
+
+  // Submit the reads of requests[0..n-1] and return once all of them
+  // have completed. Files that can keep several reads in flight override
+  // this, the default calls read() for each request.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual void multiRead(ReadRequest* requests, int n) const;
 };
 
 /* A writable file abstract */
@@ -145,6 +221,14 @@ class WritableFile
   virtual void close() = 0;
   virtual void flush() = 0;
   virtual void sync() = 0;
+
+  // Hint that the file will grow to bytes. Reserving the space up front
+  // keeps the appends from allocating blocks, which sync would have to
+  // write out as metadata.
+  virtual void preallocate(uint64_t bytes)
+  {
+    (void)bytes;
+  }
 };
 
 // Identifies a locked file.
@@ -56,6 +56,12 @@ class Iterator
   // REQUIRES: Valid()
   virtual Slice value() const = 0;
 
+  // Return false if the iterator met an error, such as a table that can
+  // not be opened or a block that can not be read. The iterator turns
+  // not valid on an error just like at the end of the source, so callers
+  // that need every entry check this once valid() is false.
+  virtual bool status() const { return true; }
+
   // Clients are allowed to register function/arg1/arg2 triples that
   // will be invoked when this iterator is destroyed.
   //
@@ -85,6 +91,12 @@ class Iterator
   CleanupNode cleanup_head_;
 }; 
 
+// Return an empty iterator (yields nothing).
+Iterator* newEmptyIterator();
+
+// Return an empty iterator whose status() is false.
+Iterator* newErrorIterator();
+
 }
 
 #endif // YUNDB_INCLUDE_YUNDB_ITERATOR_H
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace yundb
 class Comparator;
 class Env;
 class FilterPolicy;
+class SliceTransform;
 class Snapshot;
 class Logger;
 
@@ -34,6 +35,11 @@ struct Options
   // default use the bloom filter
   const FilterPolicy* filter_policy;
 
+  // If non-null, the filters of new tables also hold the prefix of every
+  // key, so iterators with ReadOptions::prefix_same_as_start skip the
+  // tables and blocks without the prefix they seek to.
+  const SliceTransform* prefix_extractor = nullptr;
+
   // If true, the database will be created if it is missing.
   bool create_if_missing = false;
 
@@ -49,6 +55,31 @@ struct Options
   // on disk) before converting to a sorted on-disk file.
   size_t write_buffer_size = 4 * 1024 * 1024;
 
+  // Space reserved for a new log file when it is created, so appends
+  // do not allocate blocks. 0 uses write_buffer_size plus a tenth.
+  size_t log_preallocate_size = 0;
+
+  // Number of retired log files kept to be reused by new logs instead of
+  // being deleted. Overwriting a reused log does not grow the file, so
+  // synced writes only flush data. 0 deletes retired logs. Logs are
+  // written in a format that older versions can not read when this is
+  // not 0.
+  size_t recycle_log_file_num = 0;
+
+  // Number of memtables kept in memory, the one taking writes and the
+  // full ones waiting to be flushed. Writes stall only when all of them
+  // are full. Full memtables that pile up are merged into one level-0
+  // table. Values below 2 are treated as 2.
+  int max_write_buffer_number = 2;
+
+  // Size of the blocks the memtable arena allocates at once.
+  // 0 uses write_buffer_size / 8.
+  size_t arena_block_size = 0;
+
+  // If true, arena blocks are mmaped in multiples of 2 MB and advised
+  // to be backed by transparent huge pages.
+  bool arena_huge_page = false;
+
   // Approximate size of user data packed per block.
   size_t block_size = 4 * 1024;
 
@@ -59,14 +90,64 @@ struct Options
   // Cache Max Size
   size_t max_cache_size = 8 * 1024 * 1024;
 
+  // Cache is split into 1 << cache_shard_bits shards, each shard has its
+  // own lock. Use more shards when many threads read concurrently.
+  // Clamped into [0, 16].
+  int cache_shard_bits = 4;
+
+  // Capacity of the uncompressed data block cache, charged by
+  // uncompressed block size.
+  size_t block_cache_size = 8 * 1024 * 1024;
+
+  // A compaction is split into up to this many key ranges that are
+  // merged on the low priority background threads of env. DB::Open
+  // raises that pool to at least this many threads, see
+  // Env::setBackgroundThreads. 1 merges every compaction on one thread.
+  int max_subcompactions = 1;
+
+  // If true, the writers of a write group insert their own batches into
+  // the memtable in parallel once the group is logged, instead of the
+  // group leader inserting the whole group.
+  bool allow_concurrent_memtable_write = false;
+
   // Number of open files that can be used by the DB.
   int max_open_file = 1000;
 
+  // Table iterators that read data blocks in file order start to read
+  // ahead after two such blocks, doubling the readahead on every refill
+  // up to this many bytes. 0 turns the adaptive readahead off.
+  size_t max_auto_readahead_size = 256 * 1024;
+
+  // Fixed readahead of the tables read by a compaction.
+  // 0 reads them block by block.
+  size_t compaction_readahead_size = 2 * 1024 * 1024;
+
+  // If true, the tables written by memtable flushes and compactions are
+  // written with direct I/O, so they do not evict the pages of the tables
+  // being read from the page cache.
+  bool use_direct_io_for_flush_and_compaction = false;
+
+  // If true, tables are read with direct I/O instead of being memory
+  // mapped or read through the page cache. Only the block cache then
+  // keeps data blocks in memory.
+  bool use_direct_reads = false;
+
   // Number of keys between restart points for delta encoding of keys.
   int block_restart_interval = 16;
 
+  // If true, a table gets one filter over all of its keys instead of one
+  // filter per data block. The filter is probed before the index block is
+  // searched, and one large filter takes less space than many small ones
+  // at the same false positive rate. Both kinds of tables can be read.
+  bool whole_table_filter = false;
+
   // Use google Snappy compression
   CompressionType compression = SnappyCompression;
+
+  // Number of threads a table builder uses to compress and checksum its
+  // data blocks. The blocks are still written in order by the building
+  // thread. 1 compresses every block on the building thread.
+  int compression_parallel_threads = 1;
 };
 
 // Options that control read operations
@@ -85,6 +166,17 @@ struct ReadOptions
   // not have been released).  If "snapshot" is null, use an implicit
   // snapshot of the state at the beginning of this read operation.
   const Snapshot* snapshot = nullptr;
+
+  // If true and Options::prefix_extractor is set, an iterator only yields
+  // the keys with the prefix of the key it was positioned with by seek()
+  // or seekToFirst(), and becomes invalid past them. Tables whose filter
+  // rules out the prefix are not read. Only seek(), seekToFirst() and
+  // next() are supported, prev() and seekToLast() make it invalid.
+  bool prefix_same_as_start = false;
+
+  // If non-zero, table iterators read this many bytes ahead from their
+  // first data block on, instead of adapting the readahead to the scan.
+  size_t readahead_size = 0;
 };
 
 // Options that control write operations
@@ -0,0 +1,39 @@
+#ifndef YUNDB_INCLUDE_YUNDB_SLICE_TRANSFORM_H
+#define YUNDB_INCLUDE_YUNDB_SLICE_TRANSFORM_H
+
+#include "yundb/slice.h"
+
+namespace yundb
+{
+
+// Map a user key to its prefix. Keys with the same prefix must be next
+// to each other in comparator order, which holds for prefixes of the
+// bytewise comparator.
+class SliceTransform
+{
+ public:
+  SliceTransform() = default;
+  virtual ~SliceTransform() = default;
+
+  // Stored in the tables, a table is only checked for prefixes by a
+  // transform of the same name
+  virtual const char* name() const = 0;
+  // Return the prefix of key.
+  // REQUIRES: inDomain(key)
+  virtual Slice transform(const Slice& key) const = 0;
+  // Return true if key has a prefix
+  virtual bool inDomain(const Slice& key) const = 0;
+};
+
+// The first len bytes of a key, shorter keys have no prefix.
+// Caller should delete the result.
+SliceTransform* newFixedPrefixTransform(size_t len);
+
+// A key up to and including its fields-th delim, e.g. fields 2 and delim
+// '|' map "tenant|entity|ts" to "tenant|entity|". Keys with fewer
+// delimiters have no prefix. Caller should delete the result.
+SliceTransform* newDelimitedPrefixTransform(char delim, int fields);
+
+}
+
+#endif // YUNDB_INCLUDE_YUNDB_SLICE_TRANSFORM_H
@@ -9,9 +9,6 @@
 namespace yundb
 {
 
-class Block;
-class BlockHandle;
-class Footer;
 struct Options;
 class RandomAccessFile;
 struct ReadOptions;
@@ -30,11 +27,10 @@ class Table
   // If successful, returns true and sets "*table" to the newly opened
   // table.  The client should delete "*table" when no longer needed.
   // If there was an error while initializing the table, sets "*table"
-  // to nullptr and returns true.  Does not take ownership of
-  // "*source", but the client must ensure that "source" remains live
-  // for the duration of the returned table's lifetime.
+  // to nullptr and returns false.
   //
-  // *file must remain live while this Table is in use.
+  // Take the ownership of file, it is deleted together with the table
+  // or when open fails.
   static bool open(const Options& options, RandomAccessFile* file,
                    uint64_t file_size, Table** table);
 
@@ -43,9 +39,10 @@ class Table
 
   ~Table();
 
-  // Returns a new iterator over the table contents.
-  // The result of NewIterator() is initially invalid (caller must
-  // call one of the Seek methods on the iterator before using it).
+  // Returns a new iterator over the table contents.  Keys are internal
+  // keys.  The result of newIterator() is initially invalid (caller must
+  // call one of the seek methods on the iterator before using it).
+  // The table must outlive the iterator.
   Iterator* newIterator(const ReadOptions&) const;
 
   // Given a key, return an approximate byte offset in the file where
@@ -60,20 +57,16 @@ class Table
   friend class TableCache;
   struct Rep;
 
-  static Iterator* blockReader(void*, const ReadOptions&, const Slice&);
-
   explicit Table(Rep* rep) : rep_(rep) {}
 
-  // Calls (*handle_result)(arg, ...) with the entry found after a call
-  // to Seek(key).  May not make such a call if filter policy says
-  // that key is not present.
+  // Calls (*handle_result)(arg, ...) with the newest entry of key's user
+  // key whose sequence is not greater than key's.  May not make such a
+  // call if filter policy says that key is not present.
+  // Returns true iff handle_result was called.
   bool internalGet(const ReadOptions&, const Slice& key, void* arg,
                    void (*handle_result)(void* arg, const Slice& k,
                    const Slice& v));
 
-  void readMeta(const Footer& footer);
-  void readFilter(const Slice& filter_handle_value);
-
   Rep* const rep_;
 };
 
@@ -1,12 +1,18 @@
-#ifndef YUNDB_INCLUDE_YUNDB_DB_H
-#define YUNDB_INCLUDE_YUNDB_DB_H
+#ifndef YUNDB_INCLUDE_YUNDB_WRITE_BATCH_H
+#define YUNDB_INCLUDE_YUNDB_WRITE_BATCH_H
 
 #include "slice.h"
-#include "memtable.h"
+
+#include <cstdint>
+#include <string>
 
 namespace yundb
 {
 
+class MemTable;
+
+using SequenceNumber = uint64_t;
+
 class WriteBatch
 {
  public:
@@ -31,7 +37,10 @@ class WriteBatch
   // Insert all of the updates from "rep_" into this batch.
   // seq is first sequence number for the first update in this batch.
   // Returns SequenceNumber of next new Sequence.
-  SequenceNumber insert(MemTable* memtable, SequenceNumber seq) const;
+  // concurrent inserts with MemTable::addConcurrently, so other batches
+  // can be inserted into memtable at the same time.
+  SequenceNumber insert(MemTable* memtable, SequenceNumber seq,
+                        bool concurrent = false) const;
 
   // The size of the database changes caused by this batch.
   //
@@ -47,6 +56,8 @@ class WriteBatch
   void append(const WriteBatch& source);
 
  private:
+  friend class WriteBatchInternal;
+
   // Get the number of entries in this batch.
   uint32_t count() const;
   // Store the number of entries in this batch.
@@ -58,4 +69,4 @@ class WriteBatch
 
 }
 
-#endif // YUNDB_INCLUDE_YUNDB_DB_H
\ No newline at end of file
+#endif // YUNDB_INCLUDE_YUNDB_WRITE_BATCH_H
\ No newline at end of file
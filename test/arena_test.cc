@@ -0,0 +1,111 @@
+#include "util/arena.h"
+#include "util/random.h"
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fill every allocation with a pattern of its index, so overlapping
+// allocations are caught when the patterns are checked
+static void fill(char* p, size_t bytes, size_t index)
+{ memset(p, static_cast<int>(index % 256), bytes); }
+
+static bool check(const char* p, size_t bytes, size_t index)
+{
+  for (size_t i = 0; bytes > i; i++)
+  {
+    if (p[i] != static_cast<char>(index % 256)) return false;
+  }
+  return true;
+}
+
+TEST(ArenaTest, allocate)
+{
+  yundb::Arena arena(64 * 1024);
+  EXPECT_EQ(64 * 1024, arena.blockSize());
+  EXPECT_EQ(0, arena.getMemoryUsage());
+
+  std::vector<std::pair<char*, size_t>> allocated;
+  yundb::Random rand(301);
+  size_t bytes = 0;
+  for (size_t i = 0; 10000 > i; i++)
+  {
+    // Mostly small, now and then larger than a quarter block
+    size_t size = (i % 100 == 0) ? rand.Uniform(40000) + 1 : rand.Uniform(200) + 1;
+    char* p = (i % 2 == 0) ? arena.allocateAligned(size) : arena.allocate(size);
+    if (i % 2 == 0) {
+      EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) & (sizeof(void*) - 1));
+    }
+    fill(p, size, i);
+    allocated.emplace_back(p, size);
+    bytes += size;
+
+    // Unused tails of the blocks are not counted
+    EXPECT_LE(bytes, arena.getMemoryUsage());
+    EXPECT_GE(bytes + 64 * 1024 + 64 * 1024 / 4, arena.getMemoryUsage());
+  }
+  for (size_t i = 0; allocated.size() > i; i++)
+  {
+    ASSERT_TRUE(check(allocated[i].first, allocated[i].second, i));
+  }
+}
+
+TEST(ArenaTest, hugePage)
+{
+  // Blocks are rounded up to the huge page size
+  yundb::Arena arena(1024 * 1024, true);
+  EXPECT_EQ(yundb::Arena::HugePageSize, arena.blockSize());
+
+  std::vector<char*> allocated;
+  for (size_t i = 0; 3 * yundb::Arena::HugePageSize / 1000 > i; i++)
+  {
+    char* p = arena.allocateAligned(1000);
+    fill(p, 1000, i);
+    allocated.push_back(p);
+  }
+  for (size_t i = 0; allocated.size() > i; i++)
+  {
+    ASSERT_TRUE(check(allocated[i], 1000, i));
+  }
+  EXPECT_LE(allocated.size() * 1000, arena.getMemoryUsage());
+}
+
+TEST(ArenaTest, allocateConcurrent)
+{
+  constexpr int ThreadNum = 8;
+  constexpr size_t AllocationsPerThread = 20000;
+  yundb::Arena arena(256 * 1024);
+
+  std::vector<std::vector<std::pair<char*, size_t>>> allocated(ThreadNum);
+  std::vector<std::thread> threads;
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    threads.emplace_back([&arena, &allocated, t]() {
+      yundb::Random rand(t + 1);
+      for (size_t i = 0; AllocationsPerThread > i; i++)
+      {
+        size_t size = (i % 500 == 0) ? rand.Uniform(50000) + 1 : rand.Uniform(100) + 1;
+        char* p = arena.allocateAlignedConcurrent(size);
+        fill(p, size, t * AllocationsPerThread + i);
+        allocated[t].emplace_back(p, size);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  size_t bytes = 0;
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    for (size_t i = 0; AllocationsPerThread > i; i++)
+    {
+      const auto& a = allocated[t][i];
+      ASSERT_TRUE(check(a.first, a.second, t * AllocationsPerThread + i));
+      bytes += a.second;
+    }
+  }
+  EXPECT_LE(bytes, arena.getMemoryUsage());
+}
@@ -0,0 +1,98 @@
+#include "db/block_builder.h"
+#include "db/block_reader.h"
+#include "db/dbformat.h"
+#include "yundb/comparator.h"
+#include "util/coding.h"
+#include "test_util.h"
+
+#include <gtest/gtest.h>
+#include <map>
+
+class BlockReaderTest : public testing::Test
+{
+ public:
+  BlockReaderTest();
+ protected:
+  static std::string internalKey(const std::string& userKey, yundb::SequenceNumber seq)
+  {
+    std::string key = userKey;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::TypeValue));
+    return key;
+  }
+
+  yundb::Options options;
+  std::map<std::string, std::string> kvMap;
+  std::string block;
+};
+
+BlockReaderTest::BlockReaderTest()
+{
+  options.comparator = yundb::BytewiseCmp();
+  StringGenerater generater(0xdeadbeef, 30);
+
+  while (kvMap.size() < 500) {
+    kvMap[generater.getRandString()] = generater.getRandString();
+  }
+
+  yundb::DataBlockBuilder builder(options);
+  for (const auto& kv : kvMap) {
+    builder.put(internalKey(kv.first, 1), kv.second);
+  }
+  block = builder.finish();
+}
+
+TEST_F(BlockReaderTest, iterate)
+{
+  yundb::BlockIterator iter(options.comparator, block);
+  EXPECT_FALSE(iter.valid());
+
+  auto kv = kvMap.begin();
+  for (iter.seekToFirst(); iter.valid(); iter.next(), ++kv) {
+    ASSERT_TRUE(kv != kvMap.end());
+    EXPECT_EQ(iter.key().toString(), internalKey(kv->first, 1));
+    EXPECT_EQ(iter.value().toString(), kv->second);
+  }
+  EXPECT_TRUE(kv == kvMap.end());
+
+  auto rkv = kvMap.rbegin();
+  for (iter.seekToLast(); iter.valid(); iter.prev(), ++rkv) {
+    ASSERT_TRUE(rkv != kvMap.rend());
+    EXPECT_EQ(iter.key().toString(), internalKey(rkv->first, 1));
+    EXPECT_EQ(iter.value().toString(), rkv->second);
+  }
+  EXPECT_TRUE(rkv == kvMap.rend());
+}
+
+TEST_F(BlockReaderTest, seek)
+{
+  yundb::BlockIterator iter(options.comparator, block);
+
+  for (const auto& kv : kvMap)
+  {
+    iter.seek(internalKey(kv.first, 1));
+    ASSERT_TRUE(iter.valid());
+    EXPECT_EQ(iter.key().toString(), internalKey(kv.first, 1));
+    EXPECT_EQ(iter.value().toString(), kv.second);
+
+    // Bigger seq is after the entry
+    auto next = kvMap.upper_bound(kv.first);
+    iter.seek(internalKey(kv.first, 2));
+    EXPECT_EQ(iter.valid(), next != kvMap.end());
+    if (next != kvMap.end()) {
+      EXPECT_EQ(iter.key().toString(), internalKey(next->first, 1));
+    }
+  }
+}
+
+TEST_F(BlockReaderTest, queryValue)
+{
+  yundb::DataBlockReader reader(options);
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value;
+    EXPECT_TRUE(reader.queryValue(block, internalKey(kv.first, 2), &value));
+    EXPECT_EQ(value, kv.second);
+    EXPECT_FALSE(reader.queryValue(block, internalKey(kv.first, 1), &value));
+  }
+}
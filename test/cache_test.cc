@@ -0,0 +1,128 @@
+#include "util/cache.h"
+#include "util/coding.h"
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+class CacheTest : public testing::Test
+{
+ public:
+  CacheTest() : cache(CacheSize) {}
+ protected:
+  static constexpr size_t CacheSize = 1000;
+
+  static void deleter(const yundb::Slice& /* key */, void* value)
+  { deletedValues.push_back(static_cast<int>(reinterpret_cast<intptr_t>(value))); }
+
+  static std::string encodeKey(int k)
+  {
+    std::string result;
+    yundb::PutFixed32(&result, k);
+    return result;
+  }
+
+  void insert(int key, int value, size_t charge = 1)
+  {
+    cache.insert(encodeKey(key), reinterpret_cast<void*>(value), charge, deleter);
+    cache.unRef(encodeKey(key));
+  }
+
+  // Return -1 if not found
+  int lookup(int key)
+  {
+    void* value = cache.lookup(encodeKey(key));
+    if (value == nullptr) return -1;
+    cache.unRef(encodeKey(key));
+    return static_cast<int>(reinterpret_cast<intptr_t>(value));
+  }
+
+  static std::vector<int> deletedValues;
+  yundb::Cache cache;
+};
+
+std::vector<int> CacheTest::deletedValues;
+
+TEST_F(CacheTest, hitAndMiss)
+{
+  deletedValues.clear();
+  EXPECT_EQ(-1, lookup(100));
+
+  insert(100, 101);
+  EXPECT_EQ(101, lookup(100));
+  EXPECT_EQ(-1, lookup(200));
+
+  insert(200, 201);
+  EXPECT_EQ(101, lookup(100));
+  EXPECT_EQ(201, lookup(200));
+
+  // Cached entry is kept, the new value is deleted
+  insert(100, 102);
+  EXPECT_EQ(101, lookup(100));
+  ASSERT_EQ(1u, deletedValues.size());
+  EXPECT_EQ(102, deletedValues[0]);
+}
+
+TEST_F(CacheTest, evictionKeepsInUseEntry)
+{
+  deletedValues.clear();
+  insert(100, 101);
+  ASSERT_NE(nullptr, cache.lookup(encodeKey(100)));
+
+  // Push far more than capacity through the cache
+  for (size_t i = 0; CacheSize * 4 > i; i++) {
+    insert(static_cast<int>(1000 + i), static_cast<int>(2000 + i));
+  }
+
+  // Referenced entry is not evicted
+  EXPECT_EQ(101, lookup(100));
+  cache.unRef(encodeKey(100));
+  // Per shard capacity is rounded up
+  EXPECT_LE(cache.getUsage(), CacheSize + (1 << yundb::DefaultCacheShardBits));
+  EXPECT_FALSE(deletedValues.empty());
+}
+
+TEST_F(CacheTest, insertPinsEntry)
+{
+  deletedValues.clear();
+  // Charge alone exceeds the capacity of its shard
+  void* value = cache.insert(encodeKey(1), reinterpret_cast<void*>(100), CacheSize * 2, deleter);
+  EXPECT_EQ(reinterpret_cast<void*>(100), value);
+  EXPECT_EQ(100, lookup(1));
+  EXPECT_TRUE(deletedValues.empty());
+
+  // Inserting a cached key returns the cached value pinned
+  value = cache.insert(encodeKey(1), reinterpret_cast<void*>(101), 1, deleter);
+  EXPECT_EQ(reinterpret_cast<void*>(100), value);
+  cache.unRef(encodeKey(1));
+  cache.unRef(encodeKey(1));
+
+  ASSERT_EQ(1u, deletedValues.size());
+  EXPECT_EQ(101, deletedValues[0]);
+}
+
+TEST_F(CacheTest, prune)
+{
+  insert(1, 100);
+  insert(2, 200);
+  ASSERT_NE(nullptr, cache.lookup(encodeKey(1)));
+  cache.prune();
+  cache.unRef(encodeKey(1));
+
+  EXPECT_EQ(100, lookup(1));
+  EXPECT_EQ(-1, lookup(2));
+}
+
+TEST_F(CacheTest, shardBitsOutOfRange)
+{
+  // Clamped instead of shifting by a negative or too large count
+  for (int shardBits : {-1, 40})
+  {
+    yundb::Cache clamped(CacheSize, shardBits);
+    clamped.insert(encodeKey(1), reinterpret_cast<void*>(100), 1, nullptr);
+    clamped.unRef(encodeKey(1));
+    void* value = clamped.lookup(encodeKey(1));
+    EXPECT_EQ(reinterpret_cast<void*>(100), value);
+    if (value != nullptr) clamped.unRef(encodeKey(1));
+  }
+}
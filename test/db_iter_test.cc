@@ -0,0 +1,171 @@
+#include "db/db_iter.h"
+#include "db/merging_iterator.h"
+#include "db/memtable.h"
+#include "db/sstable_builder.h"
+#include "db/table_cache.h"
+#include "db/dbformat.h"
+#include "yundb/en.h"
+#include "yundb/comparator.h"
+#include "util/file_name.h"
+#include "util/cache.h"
+#include "test_util.h"
+
+#include <gtest/gtest.h>
+#include <map>
+#include <vector>
+
+class DBIterTest : public testing::Test
+{
+ public:
+  DBIterTest();
+  ~DBIterTest();
+ protected:
+  std::shared_ptr<yundb::MemTable> newMemTable()
+  { return std::make_shared<yundb::MemTable>(std::make_shared<yundb::Arena>(), options); }
+
+  // Collect user keys and values from first to last
+  static std::vector<std::pair<std::string, std::string>> scan(yundb::Iterator* iter)
+  {
+    std::vector<std::pair<std::string, std::string>> result;
+    for (iter->seekToFirst(); iter->valid(); iter->next())
+    {
+      result.emplace_back(iter->key().toString(), iter->value().toString());
+    }
+    return result;
+  }
+
+  static std::vector<std::pair<std::string, std::string>> reverseScan(yundb::Iterator* iter)
+  {
+    std::vector<std::pair<std::string, std::string>> result;
+    for (iter->seekToLast(); iter->valid(); iter->prev())
+    {
+      result.emplace_back(iter->key().toString(), iter->value().toString());
+    }
+    return result;
+  }
+
+  yundb::Options options;
+  std::string dbName;
+  std::string fileName;
+};
+
+DBIterTest::DBIterTest()
+{
+  options.comparator = yundb::BytewiseCmp();
+  dbName = TEST_TEMP_DIR;
+  fileName = yundb::generateTableFileName(888888, dbName);
+}
+
+DBIterTest::~DBIterTest()
+{
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(DBIterTest, memTableIterator)
+{
+  auto memTable = newMemTable();
+  std::map<std::string, std::string> kvMap;
+  StringGenerater generater;
+  yundb::SequenceNumber seq = 0;
+  for (int i = 0; 1000 > i; i++)
+  {
+    std::string key = generater.getRandString();
+    if (kvMap.count(key) != 0) continue;
+    kvMap[key] = generater.getRandString();
+    memTable->add(seq++, yundb::TypeValue, key, kvMap[key]);
+  }
+
+  std::unique_ptr<yundb::Iterator> iter(memTable->newIterator());
+  auto kv = kvMap.begin();
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    EXPECT_EQ(kv->first, iter->key().toString().substr(0, kv->first.size()));
+    EXPECT_EQ(kv->second, iter->value().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+
+  auto rkv = kvMap.rbegin();
+  for (iter->seekToLast(); iter->valid(); iter->prev(), ++rkv)
+  {
+    ASSERT_NE(kvMap.rend(), rkv);
+    EXPECT_EQ(rkv->second, iter->value().toString());
+  }
+  EXPECT_EQ(kvMap.rend(), rkv);
+}
+
+TEST_F(DBIterTest, mergeAndSnapshot)
+{
+  // Table holds the oldest data: a..e at seq 1..5
+  auto old = newMemTable();
+  yundb::SequenceNumber seq = 1;
+  for (char c = 'a'; 'e' >= c; c++)
+  {
+    old->add(seq++, yundb::TypeValue, std::string(1, c), std::string("old") + c);
+  }
+
+  yundb::WritableFile* writeFile = nullptr;
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(old.get());
+  uint64_t fileSize = 0;
+  options.env->getFileSize(fileName, &fileSize);
+
+  // Immutable memtable overwrites b and deletes c at seq 6, 7
+  auto imm = newMemTable();
+  imm->add(seq++, yundb::TypeValue, "b", "immb");
+  imm->add(seq++, yundb::TypeDeletion, "c", "");
+  const yundb::SequenceNumber snapshot = seq - 1;
+
+  // Memtable overwrites d, deletes a and adds f at seq 8, 9, 10
+  auto mem = newMemTable();
+  mem->add(seq++, yundb::TypeValue, "d", "memd");
+  mem->add(seq++, yundb::TypeDeletion, "a", "");
+  mem->add(seq++, yundb::TypeValue, "f", "memf");
+  const yundb::SequenceNumber last = seq - 1;
+
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size));
+  auto newIter = [&](yundb::SequenceNumber s) {
+    yundb::Iterator* children[3] = {
+      mem->newIterator(), imm->newIterator(), tableCache.newIterator(888888, fileSize)
+    };
+    return std::unique_ptr<yundb::Iterator>(yundb::newDBIterator(
+      options.comparator, yundb::newMergingIterator(options.comparator, children, 3), s));
+  };
+
+  using KVs = std::vector<std::pair<std::string, std::string>>;
+  KVs latest = {{"b", "immb"}, {"d", "memd"}, {"e", "olde"}, {"f", "memf"}};
+  KVs atSnapshot = {{"a", "olda"}, {"b", "immb"}, {"d", "oldd"}, {"e", "olde"}};
+
+  auto iter = newIter(last);
+  EXPECT_EQ(latest, scan(iter.get()));
+  EXPECT_EQ(KVs(latest.rbegin(), latest.rend()), reverseScan(iter.get()));
+
+  iter = newIter(snapshot);
+  EXPECT_EQ(atSnapshot, scan(iter.get()));
+  EXPECT_EQ(KVs(atSnapshot.rbegin(), atSnapshot.rend()), reverseScan(iter.get()));
+
+  // Seek and change direction
+  iter = newIter(last);
+  iter->seek("c");
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ("d", iter->key().toString());
+  iter->prev();
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ("b", iter->key().toString());
+  iter->next();
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ("d", iter->key().toString());
+  iter->next();
+  iter->next();
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ("f", iter->key().toString());
+  iter->next();
+  EXPECT_FALSE(iter->valid());
+
+  iter->seek("g");
+  EXPECT_FALSE(iter->valid());
+}
@@ -0,0 +1,805 @@
+#include "yundb/db.h"
+#include "yundb/en.h"
+#include "yundb/comparator.h"
+#include "yundb/iterator.h"
+#include "yundb/slice_transform.h"
+#include "yundb/write_batch.h"
+#include "db/log_writer.h"
+#include "util/file_name.h"
+#include "test_util.h"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class DBTest : public testing::Test
+{
+ public:
+  DBTest();
+  ~DBTest();
+ protected:
+  void open()
+  {
+    yundb::DB* db = nullptr;
+    ASSERT_TRUE(yundb::DB::Open(options, dbName, &db));
+    _db.reset(db);
+  }
+
+  std::string get(const std::string& key, const yundb::Snapshot* snapshot = nullptr)
+  {
+    yundb::ReadOptions readOptions;
+    readOptions.snapshot = snapshot;
+    std::string value;
+    if (!_db->Get(readOptions, key, &value)) return "NOT_FOUND";
+    return value;
+  }
+
+  yundb::Options options;
+  std::string dbName;
+  std::unique_ptr<yundb::DB> _db;
+};
+
+DBTest::DBTest()
+{
+  options.comparator = yundb::BytewiseCmp();
+  options.create_if_missing = true;
+  dbName = std::string(TEST_TEMP_DIR) + "/db_test";
+  yundb::DestroyDB(dbName, options);
+}
+
+DBTest::~DBTest()
+{
+  _db.reset();
+  yundb::DestroyDB(dbName, options);
+}
+
+TEST_F(DBTest, putGetDelete)
+{
+  open();
+  yundb::WriteOptions writeOptions;
+  ASSERT_TRUE(_db->Put(writeOptions, "foo", "v1"));
+  EXPECT_EQ("v1", get("foo"));
+  ASSERT_TRUE(_db->Put(writeOptions, "foo", "v2"));
+  EXPECT_EQ("v2", get("foo"));
+
+  const yundb::Snapshot* snapshot = _db->GetSnapshot();
+  ASSERT_TRUE(_db->Delete(writeOptions, "foo"));
+  EXPECT_EQ("NOT_FOUND", get("foo"));
+  EXPECT_EQ("v2", get("foo", snapshot));
+  _db->ReleaseSnapshot(snapshot);
+
+  yundb::WriteBatch batch;
+  batch.insert("a", "va");
+  batch.insert("b", "vb");
+  batch.remove("a");
+  ASSERT_TRUE(_db->Write(writeOptions, &batch));
+  EXPECT_EQ("NOT_FOUND", get("a"));
+  EXPECT_EQ("vb", get("b"));
+
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+  iter->seekToFirst();
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ("b", iter->key().toString());
+  iter->next();
+  EXPECT_FALSE(iter->valid());
+}
+
+TEST_F(DBTest, concurrentWriters)
+{
+  open();
+  constexpr int ThreadNum = 8;
+  constexpr int KeysPerThread = 500;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    threads.emplace_back([this, t]() {
+      yundb::WriteOptions writeOptions;
+      // Mix sync and non-sync writers in one queue
+      writeOptions.sync = (t % 4 == 0);
+      for (int i = 0; KeysPerThread > i; i++)
+      {
+        std::string key = std::to_string(t) + "_" + std::to_string(i);
+        EXPECT_TRUE(_db->Put(writeOptions, key, key + "_value"));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    for (int i = 0; KeysPerThread > i; i++)
+    {
+      std::string key = std::to_string(t) + "_" + std::to_string(i);
+      ASSERT_EQ(key + "_value", get(key));
+    }
+  }
+
+  int count = 0;
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+  for (iter->seekToFirst(); iter->valid(); iter->next()) count++;
+  EXPECT_EQ(ThreadNum * KeysPerThread, count);
+}
+
+TEST_F(DBTest, concurrentMemTableWrites)
+{
+  options.allow_concurrent_memtable_write = true;
+  open();
+  constexpr int ThreadNum = 8;
+  constexpr int KeysPerThread = 500;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    threads.emplace_back([this, t]() {
+      yundb::WriteOptions writeOptions;
+      for (int i = 0; KeysPerThread > i; i++)
+      {
+        // Batches of two keep the sequence of every writer in the group apart
+        yundb::WriteBatch batch;
+        std::string key = std::to_string(t) + "_" + std::to_string(i);
+        batch.insert(key, "old");
+        batch.insert(key, key + "_value");
+        EXPECT_TRUE(_db->Write(writeOptions, &batch));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    for (int i = 0; KeysPerThread > i; i++)
+    {
+      std::string key = std::to_string(t) + "_" + std::to_string(i);
+      ASSERT_EQ(key + "_value", get(key));
+    }
+  }
+
+  // The log holds the same sequences as the memtable
+  _db.reset();
+  open();
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    for (int i = 0; KeysPerThread > i; i++)
+    {
+      std::string key = std::to_string(t) + "_" + std::to_string(i);
+      ASSERT_EQ(key + "_value", get(key));
+    }
+  }
+}
+
+TEST_F(DBTest, recoverFromLog)
+{
+  open();
+  std::map<std::string, std::string> kvMap;
+  StringGenerater generater;
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 2000 > i; i++)
+  {
+    std::string key = generater.getRandString();
+    kvMap[key] = generater.getRandString();
+    ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+  }
+  auto removed = kvMap.begin();
+  ASSERT_TRUE(_db->Delete(writeOptions, removed->first));
+  kvMap.erase(removed);
+
+  // Reopen twice so that more than one log is replayed
+  _db.reset();
+  open();
+  ASSERT_TRUE(_db->Put(writeOptions, "after_reopen", "v"));
+  kvMap["after_reopen"] = "v";
+  _db.reset();
+  open();
+
+  for (const auto& kv : kvMap)
+  {
+    ASSERT_EQ(kv.second, get(kv.first));
+  }
+
+  auto kv = kvMap.begin();
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    EXPECT_EQ(kv->first, iter->key().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+}
+
+TEST_F(DBTest, brokenLogRecordFailsRecovery)
+{
+  open();
+  ASSERT_TRUE(_db->Put(yundb::WriteOptions(), "foo", "v"));
+  _db.reset();
+
+  // A record with a valid checksum that is not a write batch
+  yundb::WritableFile* file = nullptr;
+  options.env->newWritableFile(yundb::generateLogFileName(1000, dbName), &file);
+  ASSERT_NE(nullptr, file);
+  {
+    yundb::log::Writer writer(file);
+    writer.appendRecord("broken");
+    writer.sync();
+  }
+
+  yundb::DB* db = nullptr;
+  EXPECT_FALSE(yundb::DB::Open(options, dbName, &db));
+  EXPECT_EQ(nullptr, db);
+}
+
+TEST_F(DBTest, recycleLogFiles)
+{
+  options.write_buffer_size = 32 * 1024;
+  options.recycle_log_file_num = 2;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  yundb::WriteOptions writeOptions;
+  // Records of the same size, so the stale records of a reused log start
+  // right where the new ones end and only their log number tells them apart
+  auto put = [&](int i, const std::string& round) {
+    std::string key = "key" + std::to_string(10000 + i);
+    kvMap[key] = round + std::string(100, 'v');
+    ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+  };
+  for (int i = 0; 2000 > i; i++) put(i, "r0");
+  // Flushes the logs written so far, they are kept for reuse
+  _db->CompactRange(nullptr, nullptr);
+
+  // Few enough deletes to stay in one log, the next log reuses one that
+  // holds puts of deleted keys
+  for (int i = 0; 2000 > i; i += 10)
+  {
+    std::string key = "key" + std::to_string(10000 + i);
+    ASSERT_TRUE(_db->Delete(writeOptions, key));
+    kvMap.erase(key);
+  }
+  _db->CompactRange(nullptr, nullptr);
+  put(2000, "r1");
+  _db.reset();
+
+  // The newest log is a reused one, it is longer than its record
+  std::vector<std::string> children;
+  ASSERT_TRUE(options.env->getChildren(dbName, &children));
+  uint64_t lastLog = 0;
+  std::string lastLogName;
+  for (const auto& child : children)
+  {
+    if (child.size() > 4 && child.compare(child.size() - 4, 4, ".log") == 0 &&
+        std::stoull(child) > lastLog) {
+      lastLog = std::stoull(child);
+      lastLogName = child;
+    }
+  }
+  ASSERT_NE(0u, lastLog);
+  uint64_t logSize = 0;
+  ASSERT_TRUE(options.env->getFileSize(dbName + "/" + lastLogName, &logSize));
+  EXPECT_LT(static_cast<uint64_t>(options.write_buffer_size) / 2, logSize);
+
+  // Replay stops at the stale records
+  for (int reopen = 0; 2 > reopen; reopen++)
+  {
+    open();
+    for (const auto& kv : kvMap)
+    {
+      ASSERT_EQ(kv.second, get(kv.first));
+    }
+    EXPECT_EQ("NOT_FOUND", get("key10000"));
+    auto kv = kvMap.begin();
+    std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+    for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+    {
+      ASSERT_NE(kvMap.end(), kv);
+      ASSERT_EQ(kv->first, iter->key().toString());
+    }
+    EXPECT_EQ(kvMap.end(), kv);
+    iter.reset();
+    _db.reset();
+  }
+}
+
+TEST_F(DBTest, immutableMemTables)
+{
+  options.write_buffer_size = 32 * 1024;
+  options.max_write_buffer_number = 4;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  StringGenerater generater;
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 6000 > i; i++)
+  {
+    std::string key = generater.getRandString();
+    kvMap[key] = generater.getRandString();
+    ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+
+    // Full memtables stay readable until they are flushed
+    if (i % 500 == 0) {
+      ASSERT_EQ(kvMap[key], get(key));
+    }
+  }
+  std::string number;
+  ASSERT_TRUE(_db->GetProperty("yundb.num-immutable-mem-table", &number));
+  EXPECT_GE(3, std::stoi(number));
+
+  for (int reopen = 0; 2 > reopen; reopen++)
+  {
+    for (const auto& kv : kvMap)
+    {
+      ASSERT_EQ(kv.second, get(kv.first));
+    }
+    auto kv = kvMap.begin();
+    std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+    for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+    {
+      ASSERT_NE(kvMap.end(), kv);
+      ASSERT_EQ(kv->first, iter->key().toString());
+    }
+    EXPECT_EQ(kvMap.end(), kv);
+    iter.reset();
+
+    // Logs of memtables that were not flushed yet are replayed
+    _db.reset();
+    open();
+  }
+}
+
+TEST_F(DBTest, compaction)
+{
+  // Small buffers so that the data is spread over several levels
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 64 * 1024;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  yundb::WriteOptions writeOptions;
+  for (int round = 0; 3 > round; round++)
+  {
+    for (int i = 0; 5000 > i; i++)
+    {
+      std::string key = "key" + std::to_string(i * 7 % 5000);
+      std::string value = std::to_string(round) + std::string(100, 'v');
+      ASSERT_TRUE(_db->Put(writeOptions, key, value));
+      kvMap[key] = value;
+    }
+  }
+  for (int i = 0; 5000 > i; i += 3)
+  {
+    std::string key = "key" + std::to_string(i);
+    ASSERT_TRUE(_db->Delete(writeOptions, key));
+    kvMap.erase(key);
+  }
+
+  const yundb::Snapshot* snapshot = _db->GetSnapshot();
+  ASSERT_TRUE(_db->Put(writeOptions, "key1", "after_snapshot"));
+  _db->CompactRange(nullptr, nullptr);
+
+  std::string files;
+  ASSERT_TRUE(_db->GetProperty("yundb.num-files-at-level0", &files));
+  EXPECT_EQ("0", files);
+  int tableFiles = 0;
+  for (int level = 1; 7 > level; level++)
+  {
+    ASSERT_TRUE(_db->GetProperty("yundb.num-files-at-level" + std::to_string(level), &files));
+    tableFiles += std::stoi(files);
+  }
+  EXPECT_LT(1, tableFiles);
+  EXPECT_FALSE(_db->GetProperty("yundb.num-files-at-level7", &files));
+
+  // Entries hidden by the snapshot survive the compaction
+  EXPECT_EQ(kvMap["key1"], get("key1", snapshot));
+  _db->ReleaseSnapshot(snapshot);
+  kvMap["key1"] = "after_snapshot";
+
+  for (int reopen = 0; 2 > reopen; reopen++)
+  {
+    for (const auto& kv : kvMap)
+    {
+      ASSERT_EQ(kv.second, get(kv.first));
+    }
+    EXPECT_EQ("NOT_FOUND", get("key0"));
+
+    auto kv = kvMap.begin();
+    std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+    for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+    {
+      ASSERT_NE(kvMap.end(), kv);
+      EXPECT_EQ(kv->first, iter->key().toString());
+      EXPECT_EQ(kv->second, iter->value().toString());
+    }
+    EXPECT_EQ(kvMap.end(), kv);
+    iter.reset();
+
+    _db.reset();
+    open();
+  }
+}
+
+TEST_F(DBTest, unreadableCompactionInput)
+{
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 64 * 1024;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  yundb::WriteOptions writeOptions;
+  auto putAll = [&](const std::string& round) {
+    for (int i = 0; 3000 > i; i++)
+    {
+      std::string key = "key" + std::to_string(10000 + i);
+      kvMap[key] = round + std::string(100, 'v');
+      ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+    }
+  };
+  putAll("r0");
+  _db->CompactRange(nullptr, nullptr);
+  _db.reset();
+
+  // Hide the first table, the compaction below has it as an input
+  std::vector<std::string> children;
+  ASSERT_TRUE(options.env->getChildren(dbName, &children));
+  uint64_t firstTable = 0;
+  for (const auto& child : children)
+  {
+    if (child.size() > 4 && child.compare(child.size() - 4, 4, ".sst") == 0 &&
+        (firstTable == 0 || std::stoull(child) < firstTable)) {
+      firstTable = std::stoull(child);
+    }
+  }
+  ASSERT_NE(0u, firstTable);
+  const std::string tableName = yundb::generateTableFileName(firstTable, dbName);
+  ASSERT_TRUE(options.env->renameFile(tableName, tableName + ".hidden"));
+
+  // The compaction fails instead of writing outputs without the hidden table
+  open();
+  for (int i = 0; 100 > i; i++)
+  {
+    std::string key = "key" + std::to_string(10000 + i * 30);
+    ASSERT_TRUE(_db->Put(writeOptions, key, "r1"));
+    kvMap[key] = "r1";
+  }
+  _db->CompactRange(nullptr, nullptr);
+  EXPECT_FALSE(_db->Put(writeOptions, "key", "value"));
+  _db.reset();
+
+  // Nothing is lost once the table is back
+  ASSERT_TRUE(options.env->renameFile(tableName + ".hidden", tableName));
+  open();
+  for (const auto& kv : kvMap)
+  {
+    ASSERT_EQ(kv.second, get(kv.first));
+  }
+}
+
+TEST_F(DBTest, unreadableTableFailsRead)
+{
+  open();
+  yundb::WriteOptions writeOptions;
+  ASSERT_TRUE(_db->Put(writeOptions, "key", "old"));
+  ASSERT_TRUE(_db->Put(writeOptions, "other", "old"));
+  _db->CompactRange(nullptr, nullptr);
+  // Recovery writes the newer entry to a level-0 table over the old one
+  ASSERT_TRUE(_db->Put(writeOptions, "key", "new"));
+  _db.reset();
+  open();
+  EXPECT_EQ("new", get("key"));
+  _db.reset();
+
+  std::vector<std::string> children;
+  ASSERT_TRUE(options.env->getChildren(dbName, &children));
+  uint64_t lastTable = 0;
+  for (const auto& child : children)
+  {
+    if (child.size() > 4 && child.compare(child.size() - 4, 4, ".sst") == 0) {
+      lastTable = std::max<uint64_t>(lastTable, std::stoull(child));
+    }
+  }
+  ASSERT_NE(0u, lastTable);
+  const std::string tableName = yundb::generateTableFileName(lastTable, dbName);
+  ASSERT_TRUE(options.env->renameFile(tableName, tableName + ".hidden"));
+
+  // The stale value under the unreadable table is not returned
+  open();
+  EXPECT_EQ("NOT_FOUND", get("key"));
+  EXPECT_EQ("old", get("other"));
+  std::vector<yundb::Slice> keys{"key", "other"};
+  std::string values[2];
+  bool found[2];
+  _db->MultiGet(yundb::ReadOptions(), keys.data(), 2, values, found);
+  EXPECT_FALSE(found[0]);
+  EXPECT_TRUE(found[1]);
+  _db.reset();
+  ASSERT_TRUE(options.env->renameFile(tableName + ".hidden", tableName));
+}
+
+TEST_F(DBTest, tableCacheSmallerThanTable)
+{
+  // Each shard holds less than one table reader, readers are dropped as
+  // soon as they are released but must stay usable while pinned
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 64 * 1024;
+  options.max_cache_size = 1024;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  yundb::WriteOptions writeOptions;
+  for (int round = 0; 2 > round; round++)
+  {
+    for (int i = 0; 5000 > i; i++)
+    {
+      std::string key = "key" + std::to_string(i * 7 % 5000);
+      std::string value = std::to_string(round) + std::string(100, 'v');
+      ASSERT_TRUE(_db->Put(writeOptions, key, value));
+      kvMap[key] = value;
+    }
+  }
+  _db->CompactRange(nullptr, nullptr);
+
+  for (const auto& kv : kvMap)
+  {
+    ASSERT_EQ(kv.second, get(kv.first));
+  }
+  auto kv = kvMap.begin();
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    EXPECT_EQ(kv->first, iter->key().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+}
+
+TEST_F(DBTest, approximateSizes)
+{
+  options.max_file_size = 8 * 1024 * 1024;
+  options.compression = yundb::NoCompression;
+  open();
+
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 10000 > i; i++) {
+    ASSERT_TRUE(_db->Put(writeOptions, "key" + std::to_string(100000 + i), std::string(200, 'v')));
+  }
+  _db->CompactRange(nullptr, nullptr);
+
+  int tableFiles = 0;
+  std::string files;
+  for (int level = 0; 7 > level; level++)
+  {
+    ASSERT_TRUE(_db->GetProperty("yundb.num-files-at-level" + std::to_string(level), &files));
+    tableFiles += std::stoi(files);
+  }
+  ASSERT_EQ(1, tableFiles);
+
+  yundb::Range ranges[3] = {
+    yundb::Range("a", "z"),
+    yundb::Range("key105000", "key105100"),
+    yundb::Range("key200000", "key300000"),
+  };
+  uint64_t sizes[3];
+  _db->GetApproximateSizes(ranges, 3, sizes);
+  EXPECT_LT(10000u * 200, sizes[0]);
+  // A narrow range inside the table is charged about its own entries
+  EXPECT_LT(0u, sizes[1]);
+  EXPECT_GT(sizes[0] / 20, sizes[1]);
+  EXPECT_EQ(0u, sizes[2]);
+}
+
+TEST_F(DBTest, parallelSubcompactions)
+{
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 32 * 1024;
+  options.max_subcompactions = 4;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  StringGenerater generater;
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 8000 > i; i++)
+  {
+    std::string key = generater.getRandString();
+    kvMap[key] = generater.getRandString();
+    ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+  }
+  int removed = 0;
+  for (auto kv = kvMap.begin(); kv != kvMap.end() && 500 > removed; removed++)
+  {
+    ASSERT_TRUE(_db->Delete(writeOptions, kv->first));
+    kv = kvMap.erase(kv);
+    if (kv != kvMap.end()) ++kv;
+  }
+
+  _db->CompactRange(nullptr, nullptr);
+  std::string files;
+  ASSERT_TRUE(_db->GetProperty("yundb.num-files-at-level0", &files));
+  EXPECT_EQ("0", files);
+
+  for (const auto& kv : kvMap)
+  {
+    ASSERT_EQ(kv.second, get(kv.first));
+  }
+
+  // Outputs of different ranges must not overlap
+  auto kv = kvMap.begin();
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    ASSERT_EQ(kv->first, iter->key().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+}
+
+TEST_F(DBTest, directIo)
+{
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 64 * 1024;
+  options.use_direct_io_for_flush_and_compaction = true;
+  options.use_direct_reads = true;
+  open();
+
+  std::map<std::string, std::string> kvMap;
+  StringGenerater generater;
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 5000 > i; i++)
+  {
+    std::string key = generater.getRandString();
+    kvMap[key] = generater.getRandString();
+    ASSERT_TRUE(_db->Put(writeOptions, key, kvMap[key]));
+  }
+  _db->CompactRange(nullptr, nullptr);
+
+  for (int reopen = 0; 2 > reopen; reopen++)
+  {
+    for (const auto& kv : kvMap)
+    {
+      ASSERT_EQ(kv.second, get(kv.first));
+    }
+    auto kv = kvMap.begin();
+    std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(yundb::ReadOptions()));
+    for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+    {
+      ASSERT_NE(kvMap.end(), kv);
+      ASSERT_EQ(kv->first, iter->key().toString());
+    }
+    EXPECT_EQ(kvMap.end(), kv);
+    iter.reset();
+
+    _db.reset();
+    open();
+  }
+}
+
+TEST_F(DBTest, prefixScan)
+{
+  // Keys are tenant|entity|timestamp, scans stay inside tenant|entity|
+  std::unique_ptr<yundb::SliceTransform> extractor(
+    yundb::newDelimitedPrefixTransform('|', 2));
+  options.prefix_extractor = extractor.get();
+  options.write_buffer_size = 64 * 1024;
+  open();
+
+  yundb::WriteOptions writeOptions;
+  std::map<std::string, std::string> kvMap;
+  for (int tenant = 0; 20 > tenant; tenant++)
+  {
+    // Every other entity is left out, so half of the prefixes are absent
+    for (int entity = 0; 20 > entity; entity += 2)
+    {
+      for (int ts = 0; 20 > ts; ts++)
+      {
+        std::string key = "t" + std::to_string(tenant) + "|e" + std::to_string(entity) +
+                          "|" + std::to_string(1000 + ts);
+        std::string value = key + std::string(50, 'v');
+        ASSERT_TRUE(_db->Put(writeOptions, key, value));
+        kvMap[key] = value;
+      }
+    }
+  }
+  _db->CompactRange(nullptr, nullptr);
+
+  yundb::ReadOptions prefixOptions;
+  prefixOptions.prefix_same_as_start = true;
+  for (int tenant = 0; 20 > tenant; tenant++)
+  {
+    for (int entity = 0; 20 > entity; entity++)
+    {
+      std::string prefix = "t" + std::to_string(tenant) + "|e" + std::to_string(entity) + "|";
+      std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(prefixOptions));
+      int count = 0;
+      auto kv = kvMap.lower_bound(prefix);
+      for (iter->seek(prefix); iter->valid(); iter->next(), ++kv, count++)
+      {
+        ASSERT_NE(kvMap.end(), kv);
+        EXPECT_EQ(kv->first, iter->key().toString());
+        EXPECT_EQ(kv->second, iter->value().toString());
+      }
+      EXPECT_EQ(entity % 2 == 0 ? 20 : 0, count) << prefix;
+    }
+  }
+
+  // Seek into the middle of a prefix
+  std::unique_ptr<yundb::Iterator> iter(_db->NewIterator(prefixOptions));
+  int count = 0;
+  for (iter->seek("t3|e4|1010"); iter->valid(); iter->next()) count++;
+  EXPECT_EQ(10, count);
+  iter->seek("t3|e4|");
+  ASSERT_TRUE(iter->valid());
+  iter->prev();
+  EXPECT_FALSE(iter->valid());
+
+  // Without the option iteration goes past the prefix
+  iter.reset(_db->NewIterator(yundb::ReadOptions()));
+  count = 0;
+  for (iter->seek("t3|e4|1010"); iter->valid(); iter->next()) count++;
+  EXPECT_LT(10, count);
+  iter.reset();
+
+  _db.reset();
+}
+
+TEST_F(DBTest, multiGet)
+{
+  options.write_buffer_size = 64 * 1024;
+  options.max_file_size = 64 * 1024;
+  open();
+
+  yundb::WriteOptions writeOptions;
+  for (int i = 0; 3000 > i; i++)
+  {
+    ASSERT_TRUE(_db->Put(writeOptions, "key" + std::to_string(i), "table" + std::to_string(i)));
+  }
+  _db->CompactRange(nullptr, nullptr);
+  // Newer entries in level-0 and in the memtable shadow the older ones
+  for (int i = 0; 3000 > i; i += 7)
+  {
+    ASSERT_TRUE(_db->Put(writeOptions, "key" + std::to_string(i), "level0" + std::to_string(i)));
+  }
+  ASSERT_TRUE(_db->Delete(writeOptions, "key10"));
+  _db->CompactRange(nullptr, nullptr);
+  const yundb::Snapshot* snapshot = _db->GetSnapshot();
+  for (int i = 0; 3000 > i; i += 11)
+  {
+    ASSERT_TRUE(_db->Put(writeOptions, "key" + std::to_string(i), "mem" + std::to_string(i)));
+  }
+  ASSERT_TRUE(_db->Delete(writeOptions, "key20"));
+
+  // Unsorted keys with duplicates and missing keys
+  std::vector<std::string> keyStrs;
+  for (int i = 0; 300 > i; i++)
+  {
+    keyStrs.push_back("key" + std::to_string(i * 37 % 3100));
+  }
+  keyStrs.push_back("key22");
+  keyStrs.push_back("key22");
+  keyStrs.push_back("a");
+  keyStrs.push_back("z");
+  const int n = static_cast<int>(keyStrs.size());
+  std::vector<yundb::Slice> keys(keyStrs.begin(), keyStrs.end());
+
+  for (const yundb::Snapshot* s : {static_cast<const yundb::Snapshot*>(nullptr), snapshot})
+  {
+    yundb::ReadOptions readOptions;
+    readOptions.snapshot = s;
+    std::vector<std::string> values(n);
+    std::unique_ptr<bool[]> found(new bool[n]);
+    _db->MultiGet(readOptions, keys.data(), n, values.data(), found.get());
+    for (int i = 0; n > i; i++)
+    {
+      std::string expected = get(keyStrs[i], s);
+      ASSERT_EQ(expected != "NOT_FOUND", found[i]) << keyStrs[i];
+      if (found[i]) {
+        EXPECT_EQ(expected, values[i]) << keyStrs[i];
+      }
+    }
+  }
+  _db->ReleaseSnapshot(snapshot);
+}
@@ -0,0 +1,209 @@
+#include "yundb/en.h"
+#include "util/sync.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EnvTest : public testing::Test
+{
+ public:
+  EnvTest() : env(yundb::Env::Default()), done(&mu) {}
+ protected:
+  // Blocks its pool thread until released
+  struct Blocker
+  {
+    EnvTest* test;
+    bool started;
+    bool released;
+  };
+
+  static void block(void* arg)
+  {
+    auto blocker = static_cast<Blocker*>(arg);
+    EnvTest* test = blocker->test;
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(test->mu);
+    blocker->started = true;
+    test->running++;
+    test->done.signalAll();
+    while (!blocker->released)
+    {
+      test->done.wait();
+    }
+    test->running--;
+    test->finished++;
+    test->done.signalAll();
+  }
+
+  static void count(void* arg)
+  {
+    auto test = static_cast<EnvTest*>(arg);
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(test->mu);
+    test->finished++;
+    test->done.signalAll();
+  }
+
+  void release(Blocker* blockers, int number)
+  {
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(mu);
+    for (int i = 0; number > i; i++) {
+      blockers[i].released = true;
+    }
+    done.signalAll();
+  }
+
+  void waitFinished(int number)
+  {
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(mu);
+    while (finished < number)
+    {
+      done.wait();
+    }
+  }
+
+  yundb::Env* env;
+  yundb::sync::Mutex mu;
+  yundb::sync::CondVar done;
+  int running = 0;
+  int finished = 0;
+};
+
+TEST_F(EnvTest, highPriorityDoesNotWaitForLow)
+{
+  Blocker blocker{this, false, false};
+  env->schedule(&EnvTest::block, &blocker, yundb::Env::LowPriority);
+  {
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(mu);
+    while (!blocker.started)
+    {
+      done.wait();
+    }
+  }
+
+  // The low pool is busy, work behind it waits in its queue
+  const int lowThreads = env->getBackgroundThreads(yundb::Env::LowPriority);
+  for (int i = 0; lowThreads > i + 1; i++) {
+    env->schedule(&EnvTest::block, &blocker, yundb::Env::LowPriority);
+  }
+  env->schedule(&EnvTest::count, this, yundb::Env::LowPriority);
+  env->schedule(&EnvTest::count, this, yundb::Env::HighPriority);
+  waitFinished(1);
+  EXPECT_EQ(1, env->getThreadPoolQueueLen(yundb::Env::LowPriority));
+  EXPECT_EQ(0, env->getThreadPoolQueueLen(yundb::Env::HighPriority));
+
+  release(&blocker, 1);
+  waitFinished(lowThreads + 2);
+}
+
+TEST_F(EnvTest, lowPoolRunsConcurrently)
+{
+  constexpr int ThreadNum = 4;
+  env->setBackgroundThreads(ThreadNum, yundb::Env::LowPriority);
+  EXPECT_EQ(ThreadNum, env->getBackgroundThreads(yundb::Env::LowPriority));
+
+  Blocker blockers[ThreadNum];
+  for (auto& blocker : blockers)
+  {
+    blocker = Blocker{this, false, false};
+    env->schedule(&EnvTest::block, &blocker, yundb::Env::LowPriority);
+  }
+  {
+    // Every task runs at once, or this waits forever
+    yundb::sync::LockGuard<yundb::sync::Mutex> lock(mu);
+    while (running < ThreadNum)
+    {
+      done.wait();
+    }
+  }
+  release(blockers, ThreadNum);
+  waitFinished(ThreadNum);
+
+  env->setBackgroundThreads(1, yundb::Env::LowPriority);
+  EXPECT_EQ(1, env->getBackgroundThreads(yundb::Env::LowPriority));
+  env->schedule(&EnvTest::count, this, yundb::Env::LowPriority);
+  waitFinished(ThreadNum + 1);
+}
+
+TEST_F(EnvTest, multiRead)
+{
+  const std::string fileName = std::string(TEST_TEMP_DIR) + "/env_test_multi_read";
+  std::string contents;
+  for (int i = 0; 100000 > i; i++) contents.push_back(static_cast<char>('a' + i % 26));
+  ASSERT_TRUE(yundb::writeStringToFile(env, contents, fileName));
+
+  // Read the same blocks through pread or mmap and through io_uring when
+  // the kernel has it
+  const bool ioUring = env->setUseIoUring(true);
+  for (int round = 0; 2 > round; round++)
+  {
+    yundb::RandomAccessFile* file = nullptr;
+    env->newRandomAccessFile(fileName, &file);
+    ASSERT_NE(nullptr, file);
+    std::unique_ptr<yundb::RandomAccessFile> guard(file);
+
+    // More reads than fit in flight at once
+    constexpr int ReadNum = 200;
+    constexpr uint64_t ReadSize = 300;
+    std::vector<char> scratch(ReadNum * ReadSize);
+    std::vector<yundb::ReadRequest> requests(ReadNum);
+    for (int i = 0; ReadNum > i; i++)
+    {
+      requests[i].offset = (i * 7919) % (contents.size() - ReadSize);
+      requests[i].bytes = ReadSize;
+      requests[i].scratch = &scratch[i * ReadSize];
+    }
+    file->multiRead(requests.data(), ReadNum);
+    for (int i = 0; ReadNum > i; i++)
+    {
+      ASSERT_TRUE(requests[i].ok);
+      EXPECT_EQ(contents.substr(requests[i].offset, ReadSize), requests[i].result.toString());
+    }
+
+    env->setUseIoUring(!ioUring);
+  }
+  env->setUseIoUring(false);
+  env->removeFile(fileName);
+}
+
+TEST_F(EnvTest, directIo)
+{
+  const std::string fileName = std::string(TEST_TEMP_DIR) + "/env_test_direct_io";
+  std::string contents;
+  yundb::WritableFile* file = nullptr;
+  env->newDirectWritableFile(fileName, &file);
+  ASSERT_NE(nullptr, file);
+  {
+    std::unique_ptr<yundb::WritableFile> guard(file);
+    // Appends that do not line up with blocks or the buffer, with a flush
+    // in the middle that writes a padded tail
+    for (int i = 0; 3000 > i; i++)
+    {
+      std::string piece(1 + i % 997, static_cast<char>('a' + i % 26));
+      file->append(piece);
+      contents += piece;
+      if (i == 1500) file->flush();
+    }
+    file->sync();
+    uint64_t size = 0;
+    ASSERT_TRUE(env->getFileSize(fileName, &size));
+    EXPECT_EQ(contents.size(), size);
+  }
+
+  std::string data;
+  ASSERT_TRUE(yundb::readFileToString(env, fileName, &data));
+  EXPECT_EQ(contents, data);
+
+  yundb::RandomAccessFile* reader = nullptr;
+  env->newDirectRandomAccessFile(fileName, &reader);
+  ASSERT_NE(nullptr, reader);
+  std::unique_ptr<yundb::RandomAccessFile> guard(reader);
+  std::vector<char> scratch(10000);
+  for (uint64_t offset = 0; contents.size() > offset; offset += 7919)
+  {
+    yundb::Slice result;
+    ASSERT_TRUE(reader->read(offset, &result, scratch.data(), 5000));
+    EXPECT_EQ(contents.substr(offset, 5000), result.toString());
+  }
+  env->removeFile(fileName);
+}
@@ -0,0 +1,83 @@
+#include "yundb/filter_policy.h"
+#include "util/coding.h"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+static yundb::Slice key(int i, std::string* buffer)
+{
+  buffer->clear();
+  yundb::PutFixed32(buffer, static_cast<uint32_t>(i));
+  return yundb::Slice(*buffer);
+}
+
+// Build a filter of n keys and return the false positive rate of keys
+// that were not added
+static double falsePositiveRate(const yundb::FilterPolicy* policy, int n)
+{
+  std::vector<std::string> buffers(n);
+  std::vector<yundb::Slice> keys;
+  for (int i = 0; n > i; i++) {
+    keys.push_back(key(i, &buffers[i]));
+  }
+  std::string filter;
+  policy->createFilter(keys.data(), n, &filter);
+
+  std::string buffer;
+  for (int i = 0; n > i; i++) {
+    EXPECT_TRUE(policy->keyMayMatch(keys[i], filter)) << "key " << i;
+  }
+
+  int falsePositives = 0;
+  for (int i = 0; 10000 > i; i++) {
+    if (policy->keyMayMatch(key(i + 1000000000, &buffer), filter)) falsePositives++;
+  }
+  return falsePositives / 10000.0;
+}
+
+TEST(FilterPolicyTest, noFalseNegatives)
+{
+  const yundb::FilterPolicy* policies[] = {
+    yundb::bloomPolicyFilter(), yundb::blockedBloomPolicyFilter()};
+  for (const auto* policy : policies)
+  {
+    for (int n = 1; 100000 >= n; n *= 10)
+    {
+      double rate = falsePositiveRate(policy, n);
+      // About 1% is expected at 10 bits per key
+      EXPECT_LT(rate, 0.03) << policy->Name() << " with " << n << " keys";
+    }
+  }
+}
+
+TEST(FilterPolicyTest, distinctNames)
+{
+  EXPECT_STRNE(yundb::bloomPolicyFilter()->Name(),
+               yundb::blockedBloomPolicyFilter()->Name());
+}
+
+TEST(FilterPolicyTest, keysMayMatch)
+{
+  const yundb::FilterPolicy* policies[] = {
+    yundb::bloomPolicyFilter(), yundb::blockedBloomPolicyFilter()};
+  for (const auto* policy : policies)
+  {
+    const int n = 1000;
+    std::vector<std::string> buffers(2 * n);
+    std::vector<yundb::Slice> keys;
+    for (int i = 0; 2 * n > i; i++) {
+      keys.push_back(key(i, &buffers[i]));
+    }
+    std::string filter;
+    policy->createFilter(keys.data(), n, &filter);
+
+    // Half of the probed keys were added
+    std::unique_ptr<bool[]> results(new bool[2 * n]);
+    policy->keysMayMatch(keys.data(), 2 * n, filter, results.get());
+    for (int i = 0; 2 * n > i; i++) {
+      EXPECT_EQ(policy->keyMayMatch(keys[i], filter), results[i]) << policy->Name();
+    }
+  }
+}
@@ -10,6 +10,11 @@
 
 
 #include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
 
 static yundb::SequenceNumber seq = 0;
 
@@ -75,6 +80,67 @@ TEST_F(MemTableTest, Get)
   }
 }
 
+TEST_F(MemTableTest, ConcurrentAdd)
+{
+  constexpr int ThreadNum = 8;
+  constexpr int KeysPerThread = 20000;
+
+  // Every thread inserts a stripe of the key space, a reader scans the
+  // list meanwhile and must always find it sorted
+  std::atomic<bool> writing(true);
+  std::thread reader([this, &writing]() {
+    while (writing.load(std::memory_order_acquire))
+    {
+      std::unique_ptr<yundb::Iterator> iter(memTable->newIterator());
+      std::string last;
+      for (iter->seekToFirst(); iter->valid(); iter->next())
+      {
+        std::string key = iter->key().toString();
+        EXPECT_LT(last, key);
+        last = key;
+      }
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int t = 0; ThreadNum > t; t++)
+  {
+    writers.emplace_back([this, t]() {
+      char key[32];
+      for (int i = 0; KeysPerThread > i; i++)
+      {
+        std::snprintf(key, sizeof(key), "%08d", i * ThreadNum + t);
+        memTable->addConcurrently(i * ThreadNum + t, yundb::ValueType::TypeValue,
+                                  key, std::string(key) + "_value");
+      }
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  writing.store(false, std::memory_order_release);
+  reader.join();
+
+  EXPECT_EQ(ThreadNum * KeysPerThread, memTable->getKvCount());
+  std::unique_ptr<yundb::Iterator> iter(memTable->newIterator());
+  int count = 0;
+  char key[32];
+  for (iter->seekToFirst(); iter->valid(); iter->next(), count++)
+  {
+    std::snprintf(key, sizeof(key), "%08d", count);
+    ASSERT_EQ(std::string(key), yundb::Slice(iter->key().data(),
+                                             iter->key().size() - yundb::KeyTagSize).toString());
+    ASSERT_EQ(std::string(key) + "_value", iter->value().toString());
+  }
+  EXPECT_EQ(ThreadNum * KeysPerThread, count);
+
+  std::string value;
+  bool found = true;
+  yundb::LookUpKey lookupKey(yundb::Slice("00012345"), ThreadNum * KeysPerThread);
+  ASSERT_TRUE(memTable->get(lookupKey, &value, found));
+  EXPECT_EQ("00012345_value", value);
+}
+
 /*
 TEST_F(MemTableTest, Delete)
 {
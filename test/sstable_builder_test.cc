@@ -8,6 +8,8 @@
 #include "util/cache.h"
 #include "util/coding.h"
 #include "db/table_cache.h"
+#include "db/sstable_reader.h"
+#include "yundb/slice_transform.h"
 
 
 #include <gtest/gtest.h>
@@ -36,6 +38,24 @@ SstableBuilderTest::SstableBuilderTest()
   fileName = yundb::generateTableFileName(666666, dbName);
 }
 
+// Counts the reads that reach the file
+class CountingFile : public yundb::RandomAccessFile
+{
+ public:
+  explicit CountingFile(yundb::RandomAccessFile* file) : _file(file), reads(0), bytesRead(0) {}
+
+  bool read(uint64_t offset, yundb::Slice* str, char* scratch, uint64_t bytes) const override
+  {
+    reads++;
+    bytesRead += bytes;
+    return _file->read(offset, str, scratch, bytes);
+  }
+
+  std::unique_ptr<yundb::RandomAccessFile> _file;
+  mutable int reads;
+  mutable uint64_t bytesRead;
+};
+
 TEST_F(SstableBuilderTest, sstableGenerate)
 {
   yundb::SequenceNumber seq = 0;
@@ -78,24 +98,17 @@ TEST_F(SstableBuilderTest, sstableRead)
   yundb::TableCache tableCache(dbName, options,
                                std::make_shared<yundb::Cache>(options.max_cache_size));
   
-  // Insert file into cache, so we can read data from cache when lookup
+  // Insert table into cache, the cache takes the ownership of file
   uint64_t fileSize = 0;
   options.env->getFileSize(fileName, &fileSize);
 
-  tableCache.insert(
-    666666,
-    randomAccessfile,
-    fileSize,
-    [](const yundb::Slice& key, void* value) {
-      (void)value; // do nothing, just for test
-    }
-  );
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSize));
 
   for (const auto& kv : kvMap)
   {
     std::string value, key = kv.first;
     yundb::PutFixed64(&key, yundb::packSeqAndType(seq++, yundb::ValueType::TypeValue));
-    bool found = tableCache.lookup(666666, fileSize, key, &value);
+    bool found = tableCache.lookup(yundb::ReadOptions(), 666666, fileSize, key, &value);
     EXPECT_TRUE(found);
     EXPECT_EQ(value, kv.second);
   }
@@ -128,24 +141,17 @@ TEST_F(SstableBuilderTest, sstableReadDeletion)
   yundb::TableCache tableCache(dbName, options,
                                std::make_shared<yundb::Cache>(options.max_cache_size));
 
-  // Insert file into cache, so we can read data from cache when lookup
+  // Insert table into cache, the cache takes the ownership of file
   uint64_t fileSize = 0;
   options.env->getFileSize(fileName, &fileSize);
 
-  tableCache.insert(
-    666666,
-    randomAccessfile,
-    fileSize,
-    [](const yundb::Slice& key, void* value) {
-      (void)value; // do nothing, just for test
-    }
-  );
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSize));
 
   for (const auto& kv : kvMap)
   {
     std::string value, key = kv.first;
     yundb::PutFixed64(&key, yundb::packSeqAndType(seq++, yundb::ValueType::TypeValue));
-    bool found = tableCache.lookup(666666, fileSize, key, &value);
+    bool found = tableCache.lookup(yundb::ReadOptions(), 666666, fileSize, key, &value);
     EXPECT_TRUE(found);
     EXPECT_TRUE(value.empty());
   }
@@ -154,3 +160,510 @@ TEST_F(SstableBuilderTest, sstableReadDeletion)
     options.env->removeFile(fileName);
   }
 }
+
+TEST_F(SstableBuilderTest, blockCache)
+{
+  yundb::SequenceNumber seq = 0;
+  yundb::WritableFile* writeFile;
+  yundb::RandomAccessFile* randomAccessfile = nullptr;
+
+  while (memTable->getMemoryUsage() <= options.write_buffer_size)
+  {
+    std::string key = generater.getRandString();
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable->add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(memTable.get());
+  // Blocks read in place from a mapped file are not cached, the wrapper
+  // makes the reader copy them
+  options.env->newRandomAccessFile(fileName, &randomAccessfile);
+  randomAccessfile = new CountingFile(randomAccessfile);
+
+  // Large enough to hold every data block of the table
+  options.block_cache_size = 4 * options.write_buffer_size;
+  auto blockCache = std::make_shared<yundb::Cache>(options.block_cache_size);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size),
+                               blockCache);
+
+  uint64_t fileSize = 0;
+  options.env->getFileSize(fileName, &fileSize);
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSize));
+
+  auto lookupAll = [&](const yundb::ReadOptions& readOptions) {
+    for (const auto& kv : kvMap)
+    {
+      std::string value, key = kv.first;
+      yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+      EXPECT_TRUE(tableCache.lookup(readOptions, 666666, fileSize, key, &value));
+      EXPECT_EQ(value, kv.second);
+    }
+  };
+
+  // Blocks are not kept without fill_cache
+  yundb::ReadOptions noFill;
+  noFill.fill_cache = false;
+  lookupAll(noFill);
+  EXPECT_EQ(0u, tableCache.getBlockCacheHits());
+  EXPECT_EQ(kvMap.size(), tableCache.getBlockCacheMisses());
+  EXPECT_EQ(0u, blockCache->getUsage());
+
+  // First pass loads every block, second pass is served by cache
+  lookupAll(yundb::ReadOptions());
+  uint64_t misses = tableCache.getBlockCacheMisses();
+  EXPECT_LT(misses, 2 * kvMap.size());
+  EXPECT_GT(blockCache->getUsage(), 0u);
+
+  lookupAll(yundb::ReadOptions());
+  EXPECT_EQ(misses, tableCache.getBlockCacheMisses());
+
+  std::string property;
+  ASSERT_TRUE(tableCache.getProperty("yundb.block-cache-misses", &property));
+  EXPECT_EQ(std::to_string(misses), property);
+  ASSERT_TRUE(tableCache.getProperty("yundb.block-cache-hits", &property));
+  EXPECT_EQ(std::to_string(tableCache.getBlockCacheHits()), property);
+  EXPECT_FALSE(tableCache.getProperty("yundb.unknown", &property));
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, incrementalAdd)
+{
+  yundb::SequenceNumber seq = 0;
+  yundb::WritableFile* writeFile;
+  yundb::RandomAccessFile* randomAccessfile = nullptr;
+
+  while (kvMap.size() < 10000)
+  {
+    kvMap[generater.getRandString()] = generater.getRandString();
+  }
+
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  uint64_t lastFileSize = 0;
+  for (const auto& kv : kvMap)
+  {
+    std::string key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq++, yundb::ValueType::TypeValue));
+    builder.add(key, kv.second);
+    EXPECT_GE(builder.fileSize(), lastFileSize);
+    lastFileSize = builder.fileSize();
+  }
+  EXPECT_EQ(kvMap.size(), builder.numEntries());
+  // Full data blocks are written while the table is built
+  EXPECT_GT(builder.fileSize(), 0u);
+  builder.finish();
+
+  uint64_t fileSize = 0;
+  options.env->getFileSize(fileName, &fileSize);
+  EXPECT_EQ(fileSize, builder.fileSize());
+
+  options.env->newRandomAccessFile(fileName, &randomAccessfile);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size));
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSize));
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value, key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_TRUE(tableCache.lookup(yundb::ReadOptions(), 666666, fileSize, key, &value));
+    EXPECT_EQ(value, kv.second);
+  }
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, abandon)
+{
+  yundb::WritableFile* writeFile;
+  options.env->newWritableFile(fileName, &writeFile);
+  {
+    yundb::SstableBuilder builder(options, writeFile);
+    std::string key = "key";
+    yundb::PutFixed64(&key, yundb::packSeqAndType(1, yundb::ValueType::TypeValue));
+    builder.add(key, "value");
+    builder.abandon();
+  }
+
+  // Nothing but full data blocks reaches the file
+  uint64_t fileSize = 1;
+  options.env->getFileSize(fileName, &fileSize);
+  EXPECT_EQ(0u, fileSize);
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, parallelCompression)
+{
+  yundb::SequenceNumber seq = 0;
+  while (kvMap.size() < 10000)
+  {
+    // Repeat the value, so most blocks are compressed
+    std::string value = generater.getRandString();
+    kvMap[generater.getRandString()] = value + value + value;
+  }
+
+  // Build the same table with every block compressed inline and with
+  // compression threads, the files must be the same
+  std::string contents[2];
+  for (int i = 0; 2 > i; i++)
+  {
+    options.compression_parallel_threads = i == 0 ? 1 : 4;
+    yundb::WritableFile* writeFile;
+    options.env->newWritableFile(fileName, &writeFile);
+    yundb::SstableBuilder builder(options, writeFile);
+    yundb::SequenceNumber s = seq;
+    for (const auto& kv : kvMap)
+    {
+      std::string key = kv.first;
+      yundb::PutFixed64(&key, yundb::packSeqAndType(s++, yundb::ValueType::TypeValue));
+      builder.add(key, kv.second);
+    }
+    builder.finish();
+
+    uint64_t fileSize = 0;
+    options.env->getFileSize(fileName, &fileSize);
+    EXPECT_EQ(fileSize, builder.fileSize());
+    yundb::RandomAccessFile* file = nullptr;
+    options.env->newRandomAccessFile(fileName, &file);
+    ASSERT_TRUE(file != nullptr);
+    std::string scratch(fileSize, '\0');
+    yundb::Slice result;
+    file->read(0, &result, &scratch[0], fileSize);
+    contents[i].assign(result.data(), result.size());
+    delete file;
+  }
+  EXPECT_EQ(contents[0], contents[1]);
+
+  yundb::RandomAccessFile* randomAccessfile = nullptr;
+  options.env->newRandomAccessFile(fileName, &randomAccessfile);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size));
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, contents[1].size()));
+  seq += kvMap.size();
+  for (const auto& kv : kvMap)
+  {
+    std::string value, key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_TRUE(tableCache.lookup(yundb::ReadOptions(), 666666, contents[1].size(), key, &value));
+    EXPECT_EQ(value, kv.second);
+  }
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, otherFilterPolicy)
+{
+  yundb::SequenceNumber seq = 0;
+  yundb::WritableFile* writeFile;
+  yundb::RandomAccessFile* randomAccessfile = nullptr;
+
+  while (memTable->getMemoryUsage() <= options.write_buffer_size)
+  {
+    std::string key = generater.getRandString();
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable->add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  options.filter_policy = yundb::bloomPolicyFilter();
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(memTable.get());
+
+  // A table of the old policy is read without its filter
+  options.filter_policy = yundb::blockedBloomPolicyFilter();
+  options.env->newRandomAccessFile(fileName, &randomAccessfile);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size));
+  uint64_t fileSize = 0;
+  options.env->getFileSize(fileName, &fileSize);
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSize));
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value, key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_TRUE(tableCache.lookup(yundb::ReadOptions(), 666666, fileSize, key, &value));
+    EXPECT_EQ(value, kv.second);
+  }
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, wholeTableFilter)
+{
+  yundb::SequenceNumber seq = 0;
+  while (memTable->getMemoryUsage() <= options.write_buffer_size)
+  {
+    std::string key = generater.getRandString();
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable->add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  uint64_t fileSizes[2];
+  for (int i = 0; 2 > i; i++)
+  {
+    options.whole_table_filter = i == 1;
+    yundb::WritableFile* writeFile;
+    options.env->newWritableFile(fileName, &writeFile);
+    yundb::SstableBuilder builder(options, writeFile);
+    builder.build(memTable.get());
+    fileSizes[i] = builder.fileSize();
+  }
+  // One filter needs no per block probe count, offset and size
+  EXPECT_LT(fileSizes[1], fileSizes[0]);
+
+  // The reader finds the kind of filter in the table, not in options
+  options.whole_table_filter = false;
+  yundb::RandomAccessFile* randomAccessfile = nullptr;
+  options.env->newRandomAccessFile(fileName, &randomAccessfile);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size),
+                               std::make_shared<yundb::Cache>(4 * options.write_buffer_size));
+  ASSERT_TRUE(tableCache.insert(666666, randomAccessfile, fileSizes[1]));
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value, key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_TRUE(tableCache.lookup(yundb::ReadOptions(), 666666, fileSizes[1], key, &value));
+    EXPECT_EQ(value, kv.second);
+  }
+
+  // Absent keys are mostly ruled out before any data block is read
+  const uint64_t misses = tableCache.getBlockCacheMisses();
+  int absent = 0;
+  for (int i = 0; 1000 > i; i++)
+  {
+    std::string value, key = "absent" + std::to_string(i);
+    if (kvMap.count(key) != 0) continue;
+    absent++;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_FALSE(tableCache.lookup(yundb::ReadOptions(), 666666, fileSizes[1], key, &value));
+  }
+  EXPECT_LT(tableCache.getBlockCacheMisses() - misses, static_cast<uint64_t>(absent / 20));
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, prefixFilter)
+{
+  std::unique_ptr<yundb::SliceTransform> extractor(yundb::newFixedPrefixTransform(4));
+  options.prefix_extractor = extractor.get();
+
+  // Prefixes "p000" to "p999", only the even ones are in the table
+  yundb::SequenceNumber seq = 0;
+  for (int p = 0; 1000 > p; p += 2)
+  {
+    char prefix[8];
+    std::snprintf(prefix, sizeof(prefix), "p%03d", p);
+    for (int i = 0; 10 > i; i++) {
+      memTable->add(seq++, yundb::ValueType::TypeValue,
+                    std::string(prefix) + std::to_string(i), generater.getRandString());
+    }
+  }
+
+  for (int whole = 0; 2 > whole; whole++)
+  {
+    options.whole_table_filter = whole == 1;
+    yundb::WritableFile* writeFile;
+    options.env->newWritableFile(fileName, &writeFile);
+    yundb::SstableBuilder builder(options, writeFile);
+    builder.build(memTable.get());
+
+    yundb::RandomAccessFile* file = nullptr;
+    options.env->newRandomAccessFile(fileName, &file);
+    yundb::SstableReader reader(options, file, builder.fileSize());
+    ASSERT_TRUE(reader.open());
+
+    int falsePositives = 0;
+    for (int p = 0; 1000 > p; p++)
+    {
+      char prefix[8];
+      std::snprintf(prefix, sizeof(prefix), "p%03d", p);
+      std::string target(prefix);
+      yundb::PutFixed64(&target, yundb::packSeqAndType(0, yundb::TypeForSeek));
+      bool mayMatch = reader.prefixMayMatch(target);
+      if (p % 2 == 0) {
+        EXPECT_TRUE(mayMatch) << prefix;
+      } else if (mayMatch) {
+        falsePositives++;
+      }
+    }
+    // Per block filters are small and a prefix may have to be checked in
+    // two of them, so they rule out fewer absent prefixes
+    EXPECT_LT(falsePositives, whole == 1 ? 50 : 150) << "whole table filter " << whole;
+
+    // A reader with another extractor can not use the prefixes
+    std::unique_ptr<yundb::SliceTransform> other(yundb::newFixedPrefixTransform(3));
+    yundb::Options otherOptions = options;
+    otherOptions.prefix_extractor = other.get();
+    options.env->newRandomAccessFile(fileName, &file);
+    yundb::SstableReader otherReader(otherOptions, file, builder.fileSize());
+    ASSERT_TRUE(otherReader.open());
+    std::string target("p001");
+    yundb::PutFixed64(&target, yundb::packSeqAndType(0, yundb::TypeForSeek));
+    EXPECT_TRUE(otherReader.prefixMayMatch(target));
+  }
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, readahead)
+{
+  yundb::SequenceNumber seq = 0;
+  for (int i = 0; 20000 > i; i++)
+  {
+    std::string key = "key" + std::to_string(100000 + i);
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable->add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  yundb::WritableFile* writeFile;
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(memTable.get());
+
+  struct Case
+  {
+    size_t maxAutoReadahead;
+    size_t readaheadSize;
+  };
+  // Block by block, adaptive and fixed
+  const Case cases[] = {{0, 0}, {256 * 1024, 0}, {0, 64 * 1024}};
+  int reads[3];
+  for (int c = 0; 3 > c; c++)
+  {
+    yundb::Options readOptions = options;
+    readOptions.max_auto_readahead_size = cases[c].maxAutoReadahead;
+    yundb::RandomAccessFile* file = nullptr;
+    options.env->newRandomAccessFile(fileName, &file);
+    CountingFile* countingFile = new CountingFile(file);
+    yundb::SstableReader reader(readOptions, countingFile, builder.fileSize());
+    ASSERT_TRUE(reader.open());
+    const int openReads = countingFile->reads;
+
+    yundb::ReadOptions iterOptions;
+    iterOptions.readahead_size = cases[c].readaheadSize;
+    std::unique_ptr<yundb::Iterator> iter(reader.newIterator(iterOptions));
+    auto kv = kvMap.begin();
+    for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+    {
+      ASSERT_NE(kvMap.end(), kv);
+      yundb::Slice userKey = iter->key();
+      userKey.removeTailfix(yundb::KeyTagSize);
+      ASSERT_EQ(kv->first, userKey.toString());
+      ASSERT_EQ(kv->second, iter->value().toString());
+    }
+    EXPECT_EQ(kvMap.end(), kv);
+    reads[c] = countingFile->reads - openReads;
+
+    // A backward scan reads each block alone, not a window past it
+    const uint64_t bytesBefore = countingFile->bytesRead;
+    auto rkv = kvMap.rbegin();
+    for (iter->seekToLast(); iter->valid(); iter->prev(), ++rkv)
+    {
+      ASSERT_NE(kvMap.rend(), rkv);
+      ASSERT_EQ(rkv->second, iter->value().toString());
+    }
+    EXPECT_EQ(kvMap.rend(), rkv);
+    EXPECT_GE(builder.fileSize(), countingFile->bytesRead - bytesBefore);
+
+    // Jumping around resets the adaptive readahead and still reads right
+    for (int i = 0; 20000 > i; i += 997)
+    {
+      std::string target = "key" + std::to_string(100000 + i);
+      yundb::PutFixed64(&target, yundb::packSeqAndType(0, yundb::TypeForSeek));
+      iter->seek(target);
+      ASSERT_TRUE(iter->valid());
+      EXPECT_EQ(kvMap["key" + std::to_string(100000 + i)], iter->value().toString());
+    }
+  }
+  EXPECT_LT(reads[1] * 10, reads[0]);
+  EXPECT_LT(reads[2] * 10, reads[0]);
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+TEST_F(SstableBuilderTest, mappedBlocksReadInPlace)
+{
+  yundb::SequenceNumber seq = 0;
+  for (int i = 0; 20000 > i; i++)
+  {
+    std::string key = "key" + std::to_string(100000 + i);
+    std::string value = generater.getRandString();
+    kvMap[key] = value;
+    memTable->add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  options.compression = yundb::NoCompression;
+  yundb::WritableFile* writeFile;
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(memTable.get());
+
+  yundb::RandomAccessFile* file = nullptr;
+  options.env->newRandomAccessFile(fileName, &file);
+  ASSERT_NE(nullptr, file);
+  if (!file->isMemoryMapped()) {
+    delete file;
+    options.env->removeFile(fileName);
+    GTEST_SKIP() << "table file is not memory mapped";
+  }
+
+  auto blockCache = std::make_shared<yundb::Cache>(4 * options.write_buffer_size);
+  yundb::TableCache tableCache(dbName, options,
+                               std::make_shared<yundb::Cache>(options.max_cache_size),
+                               blockCache);
+  ASSERT_TRUE(tableCache.insert(666666, file, builder.fileSize()));
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value, key = kv.first;
+    yundb::PutFixed64(&key, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    EXPECT_TRUE(tableCache.lookup(yundb::ReadOptions(), 666666, builder.fileSize(), key, &value));
+    EXPECT_EQ(kv.second, value);
+  }
+  // Uncompressed blocks are parsed in the mapping and never copied into
+  // the block cache
+  EXPECT_EQ(0u, blockCache->getUsage());
+
+  // Iterators read them in place too
+  std::unique_ptr<yundb::Iterator> iter(tableCache.newIterator(666666, builder.fileSize()));
+  auto kv = kvMap.begin();
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    EXPECT_EQ(kv->second, iter->value().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+  iter.reset();
+
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
@@ -0,0 +1,207 @@
+#include "yundb/table.h"
+#include "yundb/en.h"
+#include "yundb/comparator.h"
+#include "db/sstable_builder.h"
+#include "db/sstable_reader.h"
+#include "db/memtable.h"
+#include "db/dbformat.h"
+#include "util/file_name.h"
+#include "util/coding.h"
+#include "test_util.h"
+
+#include <gtest/gtest.h>
+#include <map>
+
+class TableTest : public testing::Test
+{
+ public:
+  TableTest();
+  ~TableTest();
+ protected:
+  static std::string userKey(const yundb::Slice& internalKey)
+  { return std::string(internalKey.data(), internalKey.size() - yundb::KeyTagSize); }
+
+  static std::string lookupKey(const std::string& key, yundb::SequenceNumber seq)
+  {
+    std::string result = key;
+    yundb::PutFixed64(&result, yundb::packSeqAndType(seq, yundb::ValueType::TypeValue));
+    return result;
+  }
+
+  yundb::Options options;
+  std::string fileName;
+  uint64_t fileSize;
+  yundb::SequenceNumber seq;
+  std::map<std::string, std::string> kvMap;
+  std::map<std::string, yundb::SequenceNumber> seqMap;
+  yundb::Table* table;
+};
+
+TableTest::TableTest()
+      : fileSize(0), seq(0), table(nullptr)
+{
+  options.comparator = yundb::BytewiseCmp();
+  options.write_buffer_size = 256 * 1024;
+  fileName = yundb::generateTableFileName(777777, TEST_TEMP_DIR);
+
+  auto arena = std::make_shared<yundb::Arena>();
+  yundb::MemTable memTable(arena, options);
+  StringGenerater generater;
+  while (memTable.getMemoryUsage() <= options.write_buffer_size)
+  {
+    std::string key = generater.getRandString();
+    std::string value = generater.getRandString();
+    if (kvMap.count(key) != 0) continue;
+    kvMap[key] = value;
+    seqMap[key] = seq;
+    memTable.add(seq++, yundb::ValueType::TypeValue, key, value);
+  }
+
+  yundb::WritableFile* writeFile = nullptr;
+  options.env->newWritableFile(fileName, &writeFile);
+  yundb::SstableBuilder builder(options, writeFile);
+  builder.build(&memTable);
+
+  yundb::RandomAccessFile* file = nullptr;
+  options.env->newRandomAccessFile(fileName, &file);
+  options.env->getFileSize(fileName, &fileSize);
+  yundb::Table::open(options, file, fileSize, &table);
+}
+
+TableTest::~TableTest()
+{
+  delete table;
+  if (options.env->fileExists(fileName)) {
+    options.env->removeFile(fileName);
+  }
+}
+
+// Fail every read once failing is set
+class FailingFile : public yundb::RandomAccessFile
+{
+ public:
+  explicit FailingFile(yundb::RandomAccessFile* file) : _file(file), failing(false) {}
+
+  bool read(uint64_t offset, yundb::Slice* str, char* scratch, uint64_t bytes) const override
+  {
+    if (failing) return false;
+    return _file->read(offset, str, scratch, bytes);
+  }
+
+  std::unique_ptr<yundb::RandomAccessFile> _file;
+  bool failing;
+};
+
+TEST_F(TableTest, iterate)
+{
+  ASSERT_NE(nullptr, table);
+  std::unique_ptr<yundb::Iterator> iter(table->newIterator(yundb::ReadOptions()));
+
+  auto kv = kvMap.begin();
+  for (iter->seekToFirst(); iter->valid(); iter->next(), ++kv)
+  {
+    ASSERT_NE(kvMap.end(), kv);
+    EXPECT_EQ(kv->first, userKey(iter->key()));
+    EXPECT_EQ(kv->second, iter->value().toString());
+  }
+  EXPECT_EQ(kvMap.end(), kv);
+
+  auto rkv = kvMap.rbegin();
+  for (iter->seekToLast(); iter->valid(); iter->prev(), ++rkv)
+  {
+    ASSERT_NE(kvMap.rend(), rkv);
+    EXPECT_EQ(rkv->first, userKey(iter->key()));
+    EXPECT_EQ(rkv->second, iter->value().toString());
+  }
+  EXPECT_EQ(kvMap.rend(), rkv);
+  EXPECT_TRUE(iter->status());
+}
+
+TEST_F(TableTest, readError)
+{
+  yundb::RandomAccessFile* file = nullptr;
+  options.env->newRandomAccessFile(fileName, &file);
+  FailingFile* failingFile = new FailingFile(file);
+  yundb::Table* failingTable = nullptr;
+  ASSERT_TRUE(yundb::Table::open(options, failingFile, fileSize, &failingTable));
+  std::unique_ptr<yundb::Table> owner(failingTable);
+
+  // An unreadable block ends the iteration with an error, not silently
+  failingFile->failing = true;
+  std::unique_ptr<yundb::Iterator> iter(failingTable->newIterator(yundb::ReadOptions()));
+  iter->seekToFirst();
+  EXPECT_FALSE(iter->valid());
+  EXPECT_FALSE(iter->status());
+}
+
+TEST_F(TableTest, seek)
+{
+  ASSERT_NE(nullptr, table);
+  std::unique_ptr<yundb::Iterator> iter(table->newIterator(yundb::ReadOptions()));
+
+  for (const auto& kv : kvMap)
+  {
+    iter->seek(lookupKey(kv.first, 0));
+    ASSERT_TRUE(iter->valid());
+    EXPECT_EQ(kv.first, userKey(iter->key()));
+    EXPECT_EQ(kv.second, iter->value().toString());
+  }
+
+  // Before the first key and after the last key
+  iter->seek(lookupKey("", 0));
+  ASSERT_TRUE(iter->valid());
+  EXPECT_EQ(kvMap.begin()->first, userKey(iter->key()));
+
+  iter->seek(lookupKey(kvMap.rbegin()->first + "z", 0));
+  EXPECT_FALSE(iter->valid());
+}
+
+static void saveValue(void* arg, const yundb::Slice& k, const yundb::Slice& v)
+{
+  (void)k;
+  static_cast<std::string*>(arg)->assign(v.data(), v.size());
+}
+
+TEST_F(TableTest, internalGet)
+{
+  yundb::RandomAccessFile* file = nullptr;
+  options.env->newRandomAccessFile(fileName, &file);
+  yundb::SstableReader reader(options, file, fileSize);
+  ASSERT_TRUE(reader.open());
+
+  for (const auto& kv : kvMap)
+  {
+    std::string value;
+    yundb::SequenceNumber keySeq = seqMap[kv.first];
+    EXPECT_TRUE(reader.internalGet(lookupKey(kv.first, keySeq), &value, saveValue));
+    EXPECT_EQ(kv.second, value);
+    // Not visible to an older sequence
+    if (keySeq > 0) {
+      EXPECT_FALSE(reader.internalGet(lookupKey(kv.first, keySeq - 1), &value, saveValue));
+    }
+  }
+}
+
+TEST_F(TableTest, approximateOffsetOf)
+{
+  ASSERT_NE(nullptr, table);
+
+  uint64_t last = 0;
+  for (const auto& kv : kvMap)
+  {
+    uint64_t offset = table->approximateOffsetOf(lookupKey(kv.first, seq));
+    EXPECT_LE(last, offset);
+    EXPECT_LT(offset, fileSize);
+    last = offset;
+  }
+  EXPECT_EQ(0u, table->approximateOffsetOf(lookupKey(kvMap.begin()->first, 0)));
+  EXPECT_LT(0u, last);
+
+  // Past the last key the whole last block is counted
+  const std::string& lastKey = kvMap.rbegin()->first;
+  uint64_t lastBlock = table->approximateOffsetOf(lookupKey(lastKey, seqMap[lastKey]));
+  uint64_t end = table->approximateOffsetOf(lookupKey(lastKey + "\xff", seq));
+  EXPECT_LT(lastBlock, end);
+  EXPECT_LE(last, end);
+  EXPECT_LT(end, fileSize);
+}
@@ -1,28 +1,99 @@
 #include "arena.h"
 #include "util/error_print.h"
 
+#include <sys/mman.h>
+#include <sched.h>
+
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <thread>
 
 namespace yundb
 {
 
-static constexpr size_t KBlockSize = 4096;
+static constexpr int Align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
+static_assert((Align & (Align - 1)) == 0, "Pointer size should be a power of 2");
+
+static constexpr size_t CacheLineSize = 64;
+
+constexpr size_t Arena::MinBlockSize;
+constexpr size_t Arena::MaxBlockSize;
+constexpr size_t Arena::HugePageSize;
+
+// Memory of one core for allocateAlignedConcurrent. Padded to two cache
+// lines, so the shards of different cores never share a line.
+struct Arena::Shard
+{
+  Shard() : allocPtr(nullptr), allocBytesRemaining(0) {}
+
+  sync::Mutex mutex;
+  char* allocPtr;
+  std::atomic<size_t> allocBytesRemaining;
+  char padding[2 * CacheLineSize - sizeof(sync::Mutex) - sizeof(char*) -
+               sizeof(std::atomic<size_t>)];
+};
 
-Arena::Arena()
-    : _available_block(nullptr), _pos(KBlockSize), _memory_usage(0) {} 
+static size_t roundBlockSize(size_t blockSize, bool hugePage)
+{
+  blockSize = std::max(blockSize, Arena::MinBlockSize);
+  blockSize = std::min(blockSize, Arena::MaxBlockSize);
+  const size_t unit = hugePage ? Arena::HugePageSize : static_cast<size_t>(Align);
+  return (blockSize + unit - 1) / unit * unit;
+}
+
+Arena::Arena(size_t blockSize, bool hugePage)
+    : _blockSize(roundBlockSize(blockSize, hugePage)),
+      _hugePage(hugePage),
+      _memory_usage(0),
+      _allocPtr(nullptr),
+      _allocBytesRemaining(0)
+{
+  // A shard takes small pieces of a block, so an idle core only keeps
+  // a little memory back
+  _shardBlockSize = std::min<size_t>(128 * 1024, _blockSize / 8);
+  _shardNum = std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency()));
+  _shards.reset(new Shard[_shardNum]);
+}
 
 Arena::~Arena()
 {
   size_t len = _block.size();
   for (size_t i = 0; len > i; i++)
     delete[] _block[i];
+  for (const auto& block : _mmapBlock)
+    munmap(block.first, block.second);
 }
 
 size_t Arena::getMemoryUsage()
-{return _memory_usage.load(std::memory_order_relaxed);}
+{
+  size_t unused = _allocBytesRemaining.load(std::memory_order_relaxed);
+  for (int i = 0; _shardNum > i; i++) {
+    unused += _shards[i].allocBytesRemaining.load(std::memory_order_relaxed);
+  }
+  // The counters are read one by one while others may allocate
+  size_t usage = _memory_usage.load(std::memory_order_relaxed);
+  return usage > unused ? usage - unused : 0;
+}
 
 char* Arena::allocateNewBlock(size_t bytes)
 {
+  if (_hugePage && bytes == _blockSize)
+  {
+    void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (block != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+      // Only a hint, the block works without huge pages too
+      madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+      _mmapBlock.emplace_back(static_cast<char*>(block), bytes);
+      _memory_usage.fetch_add(sizeof(char*) + bytes, std::memory_order_relaxed);
+      return static_cast<char*>(block);
+    }
+    printError("Arena: mmap huge page block fail");
+  }
+
   char* result = new char[bytes];
   if (result == nullptr) printError("Arena allocate fail");
   _block.push_back(result);
@@ -30,51 +101,101 @@ char* Arena::allocateNewBlock(size_t bytes)
   return result;
 }
 
+char* Arena::allocateFallback(size_t bytes)
+{
+  if (bytes > _blockSize / 4)
+  {
+    // Object is more than a quarter of our block size.  Allocate it
+    // separately to avoid wasting too much space in leftover bytes.
+    return allocateNewBlock(bytes);
+  }
+
+  // We waste the remaining space in the current block.
+  _allocPtr = allocateNewBlock(_blockSize);
+  _allocBytesRemaining.store(_blockSize, std::memory_order_relaxed);
+
+  char* result = _allocPtr;
+  _allocPtr += bytes;
+  _allocBytesRemaining.store(_blockSize - bytes, std::memory_order_relaxed);
+  return result;
+}
+
 char* Arena::allocate(size_t bytes)
 {
   if (bytes <= 0) printError("allocate bytes param error");
-  if (bytes > (KBlockSize / 4))
+  size_t remaining = _allocBytesRemaining.load(std::memory_order_relaxed);
+  if (bytes <= remaining)
   {
-    char* block = allocateNewBlock(bytes);
-    return block;
+    char* result = _allocPtr;
+    _allocPtr += bytes;
+    _allocBytesRemaining.store(remaining - bytes, std::memory_order_relaxed);
+    return result;
   }
+  return allocateFallback(bytes);
+}
+
+char* Arena::allocateAligned(size_t bytes)
+{
+  size_t current_mod = reinterpret_cast<uintptr_t>(_allocPtr) & (Align - 1);
+  size_t slop = (current_mod == 0 ? 0 : Align - current_mod);
+  size_t needed = bytes + slop;
+  size_t remaining = _allocBytesRemaining.load(std::memory_order_relaxed);
+  char* result;
 
-  if (KBlockSize - _pos < bytes)
+  if (needed <= remaining)
   {
-    char* block = allocateNewBlock(KBlockSize);
-    _available_block = block;
-    _pos = bytes;
-    return block;
+    result = _allocPtr + slop;
+    _allocPtr += needed;
+    _allocBytesRemaining.store(remaining - needed, std::memory_order_relaxed);
   }
   else
   {
-    _pos += bytes;
-    return _available_block + _pos;
+    // allocateFallback returns the start of a block, which is aligned
+    result = allocateFallback(bytes);
   }
+  assert((reinterpret_cast<uintptr_t>(result) & (Align - 1)) == 0);
+  return result;
 }
 
-char* Arena::allocateAligned(size_t bytes)
+Arena::Shard* Arena::currentShard()
 {
-  const int align = (sizeof(void*) > 8) ? sizeof(void*) : 8;
-  static_assert((align & (align - 1)) == 0,
-                "Pointer size should be a power of 2");
-  size_t current_mod = reinterpret_cast<uintptr_t>(_available_block + _pos) & (align - 1);
-  size_t slop = (current_mod == 0 ? 0 : align - current_mod);
-  size_t needed = bytes + slop;
-  char* result;
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if (cpu >= 0) return &_shards[cpu % _shardNum];
+#endif
+  size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+  return &_shards[id % _shardNum];
+}
 
-  if (needed <= KBlockSize - _pos)
+char* Arena::allocateAlignedConcurrent(size_t bytes)
+{
+  if (bytes > _shardBlockSize / 4)
   {
-    result = _available_block + _pos + slop;
-    _pos += needed;
+    sync::LockGuard<sync::Mutex> lock(_mutex);
+    return allocateAligned(bytes);
   }
-  else
+
+  Shard* shard = currentShard();
+  sync::LockGuard<sync::Mutex> shardLock(shard->mutex);
+  size_t current_mod = reinterpret_cast<uintptr_t>(shard->allocPtr) & (Align - 1);
+  size_t slop = (current_mod == 0 ? 0 : Align - current_mod);
+  size_t needed = bytes + slop;
+  size_t remaining = shard->allocBytesRemaining.load(std::memory_order_relaxed);
+  if (needed > remaining)
   {
-    result = allocateNewBlock(KBlockSize);
-    _available_block = result;
-    _pos = static_cast<int>(needed);
+    // The rest of the shard is wasted, take a fresh piece of a block
+    {
+      sync::LockGuard<sync::Mutex> lock(_mutex);
+      shard->allocPtr = allocateAligned(_shardBlockSize);
+    }
+    slop = 0;
+    needed = bytes;
+    remaining = _shardBlockSize;
   }
-  assert((reinterpret_cast<uintptr_t>(result) & (align - 1)) == 0);
+
+  char* result = shard->allocPtr + slop;
+  shard->allocPtr += needed;
+  shard->allocBytesRemaining.store(remaining - needed, std::memory_order_relaxed);
   return result;
 }
 
@@ -2,8 +2,12 @@
 #define YUNDB_UTIL_ARENA_H
 // Header guard standardized to YUNDB_UTIL_ARENA_H
 
+#include <cstddef>
 #include <vector>
 #include <atomic>
+#include <memory>
+
+#include "util/sync.h"
 
 /* Memory allocate class */
 namespace yundb
@@ -12,21 +16,56 @@ namespace yundb
 class Arena
 {
  public:
-  Arena();
+  static constexpr size_t MinBlockSize = 4096;
+  static constexpr size_t MaxBlockSize = 1024 * 1024 * 1024;
+  static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+  // blockSize is rounded into [MinBlockSize, MaxBlockSize]. With
+  // hugePage the blocks are mmaped in multiples of HugePageSize and
+  // advised to be backed by huge pages, falling back to the heap when
+  // the mapping fails.
+  explicit Arena(size_t blockSize = MinBlockSize, bool hugePage = false);
   ~Arena();
   Arena(Arena& other) = delete;
   Arena& operator=(Arena& other) = delete;
   char* allocate(size_t bytes);
   char* allocateAligned(size_t bytes);
+  // Same as allocateAligned, but may be called by several threads at
+  // the same time. Every core allocates from its own shard, which is
+  // refilled from the blocks. Must not overlap with the unlocked calls.
+  char* allocateAlignedConcurrent(size_t bytes);
+  // Bytes of the blocks that have been handed out, so unused tails of
+  // the blocks are not counted
   size_t getMemoryUsage();
+  size_t blockSize() const { return _blockSize; }
  private:
+  struct Shard;
+
+  char* allocateFallback(size_t bytes);
   char* allocateNewBlock(size_t bytes);
+  // Return the shard of the calling core
+  Shard* currentShard();
+
+  const size_t _blockSize;
+  const bool _hugePage;
+  // Blocks from new[]
   std::vector<char*> _block;
+  // Blocks from mmap with their length
+  std::vector<std::pair<char*, size_t>> _mmapBlock;
+  // Bytes of every block
   std::atomic<size_t> _memory_usage;
-  char* _available_block;
-  int _pos;
+  char* _allocPtr;
+  // Unused bytes at _allocPtr, atomic so getMemoryUsage can be called
+  // from any thread
+  std::atomic<size_t> _allocBytesRemaining;
+
+  // Serializes the shards when they take memory from the blocks
+  sync::Mutex _mutex;
+  size_t _shardBlockSize;
+  int _shardNum;
+  std::unique_ptr<Shard[]> _shards;
 };
 
 }
 
-#endif // YUNDB_UTIL_ARENA_H
\ No newline at end of file
+#endif // YUNDB_UTIL_ARENA_H
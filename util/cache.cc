@@ -17,9 +17,9 @@ static LRUHandle* newLRUHandle(const Slice& key, size_t hash, void* value, size_
 
 static void freeLRUHandle(LRUHandle* handle);
 
-Cache::Cache(size_t capacity)
+LRUCache::LRUCache()
     : _usage(0),
-      _capacity(capacity)
+      _capacity(0)
 {
   _lru.pre = &_lru;
   _lru.next = &_lru;
@@ -27,81 +27,116 @@ Cache::Cache(size_t capacity)
   _inUse.next = &_inUse;
 }
 
-Cache::~Cache() {}
+LRUCache::~LRUCache() {}
 
-void* Cache::lookup(const Slice& key)
+void LRUCache::setCapacity(size_t capacity)
 {
-  _mutex.Lock();
-  LRUHandle** handle = _hashTable.lookup(key, hash(key.data(), key.size(), HASHSEED));
+  sync::LockGuard<sync::Mutex> guard(_mutex);
+  _capacity = capacity;
+}
+
+void* LRUCache::lookup(const Slice& key, uint32_t hash)
+{
+  sync::LockGuard<sync::Mutex> guard(_mutex);
+  LRUHandle** handle = _hashTable.lookup(key, hash);
 
   if (handle == nullptr) return nullptr;
 
   ref(handle);
-  _mutex.unlock();
   return (*handle)->value;
 }
 
-void Cache::insert(const Slice& key, void* value, size_t charge,
-                   void (*deleter)(const Slice& key, void* value))
+void* LRUCache::insert(const Slice& key, uint32_t hash, void* value, size_t charge,
+                       void (*deleter)(const Slice& key, void* value))
 {
-
-  LRUHandle* handle = newLRUHandle(key, hash(key.data(), key.size(), HASHSEED),
-                                   value, charge, deleter);
   _mutex.Lock();
-  _hashTable.insert(handle);
-  _mutex.unlock();
+  LRUHandle** cached = _hashTable.lookup(key, hash);
+  if (cached != nullptr) {
+    // Keep the cached one, its users may still hold references
+    ref(cached);
+    void* cachedValue = (*cached)->value;
+    _mutex.unlock();
+    if (deleter != nullptr) deleter(key, value);
+    return cachedValue;
+  }
+
+  // One reference for the cache and one for the caller. The new entry
+  // starts on the in use list, so the eviction below never drops it
+  // even when its charge alone exceeds the capacity
+  LRUHandle* handle = newLRUHandle(key, hash, value, charge, deleter);
   handle->inCache = true;
-  handle->refs = 1;
+  handle->inUse = true;
+  handle->refs = 2;
+  _hashTable.insert(handle);
   _usage += charge;
-  _mutex.Lock();
-  LRUInsert(&handle);
+  inUseInsert(&handle);
 
+  // Unlink evicted entries under lock, run deleters after unlock
+  LRUHandle* evicted = nullptr;
   while (_usage > _capacity && _lru.next != &_lru)
   {
     LRUHandle* old = _lru.next;
     LRURemove(&old);
     _hashTable.remove(old->getHashValue(), old->getKey());
     _usage -= old->charge;
-    freeLRUHandle(old);
+    old->next = evicted;
+    evicted = old;
   }
   _mutex.unlock();
+
+  while (evicted != nullptr)
+  {
+    LRUHandle* next = evicted->next;
+    freeLRUHandle(evicted);
+    evicted = next;
+  }
+  return value;
 }
 
-void Cache::unRef(const Slice& key)
+void LRUCache::unRef(const Slice& key, uint32_t hash)
 {
-  _mutex.Lock();
-  LRUHandle** handle = _hashTable.lookup(key, hash(key.data(), key.size(), HASHSEED));
+  sync::LockGuard<sync::Mutex> guard(_mutex);
+  LRUHandle** handle = _hashTable.lookup(key, hash);
   if (handle != nullptr) unRef(handle);
-  _mutex.unlock();
 }
 
-void Cache::prune()
+void LRUCache::erase(const Slice& key, uint32_t hash)
 {
-  _mutex.Lock();
+  LRUHandle* handle = nullptr;
+  {
+    sync::LockGuard<sync::Mutex> guard(_mutex);
+    LRUHandle** ptr = _hashTable.lookup(key, hash);
+    if (ptr == nullptr || (*ptr)->inUse) return;
+    handle = *ptr;
+    LRURemove(&handle);
+    _hashTable.remove(hash, key);
+    _usage -= handle->charge;
+  }
+  freeLRUHandle(handle);
+}
+
+void LRUCache::prune()
+{
+  sync::LockGuard<sync::Mutex> guard(_mutex);
   LRUHandle* handle = _lru.next;
   while (handle != &_lru)
   {
     LRUHandle* next = handle->next;
     LRURemove(&handle);
     _hashTable.remove(handle->getHashValue(), handle->getKey());
+    _usage -= handle->charge;
     freeLRUHandle(handle);
     handle = next;
   }
-  _mutex.unlock();
 }
 
-void Cache::changeCpacity(size_t capacity)
-{ _capacity = capacity; }
-
-size_t Cache::getUsage() const
+size_t LRUCache::getUsage() const
 {
-  _mutex.Lock();
-  size_t usage = _usage;
-  _mutex.unlock();
-  return usage;
+  sync::LockGuard<sync::Mutex> guard(_mutex);
+  return _usage;
 }
 
-void Cache::LRUInsert(LRUHandle** handle)
+void LRUCache::LRUInsert(LRUHandle** handle)
 {
   _lru.pre->next = *handle;
   (*handle)->pre = _lru.pre;
@@ -109,13 +144,13 @@ void Cache::LRUInsert(LRUHandle** handle)
   (*handle)->next = &_lru;
 }
 
-void Cache::LRURemove(LRUHandle** handle)
+void LRUCache::LRURemove(LRUHandle** handle)
 {
   (*handle)->pre->next = (*handle)->next;
   (*handle)->next->pre = (*handle)->pre;
 }
 
-void Cache::inUseInsert(LRUHandle** handle)
+void LRUCache::inUseInsert(LRUHandle** handle)
 {
   _inUse.pre->next = *handle;
   (*handle)->pre = _inUse.pre;
@@ -123,22 +158,23 @@ void Cache::inUseInsert(LRUHandle** handle)
   (*handle)->next = &_inUse;
 }
 
-void Cache::inUseRemove(LRUHandle** handle)
+void LRUCache::inUseRemove(LRUHandle** handle)
 {
   (*handle)->pre->next = (*handle)->next;
   (*handle)->next->pre = (*handle)->pre;
 }
 
-void Cache::ref(LRUHandle** handle)
+void LRUCache::ref(LRUHandle** handle)
 {
   ++(*handle)->refs;
   if (!(*handle)->inUse && (*handle)->refs >= 2 && (*handle)->inCache) {
     (*handle)->inUse = true;
+    LRURemove(handle);
     inUseInsert(handle);
   }
 }
 
-void Cache::unRef(LRUHandle** handle)
+void LRUCache::unRef(LRUHandle** handle)
 {
   --(*handle)->refs;
   if ((*handle)->refs == 1 && (*handle)->inCache && (*handle)->inUse) {
@@ -157,8 +193,9 @@ LRUTable::~LRUTable()
     LRUHandle* handle = _buckets[i];
     while (handle != nullptr)
     {
+      LRUHandle* next = handle->nextHash;
       freeLRUHandle(handle);
-      handle = handle->nextHash;
+      handle = next;
     }
   }
 }
@@ -259,4 +296,74 @@ static void freeLRUHandle(LRUHandle* handle)
   delete[] reinterpret_cast<char*>(handle);
 }
 
-}
\ No newline at end of file
+// Clamp shardBits into [0, MaxCacheShardBits], it comes from the options
+static int checkShardBits(int shardBits)
+{
+  if (shardBits >= 0 && shardBits <= MaxCacheShardBits) return shardBits;
+  printError("Cache: shard bits out of range");
+  return shardBits < 0 ? 0 : MaxCacheShardBits;
+}
+
+Cache::Cache(size_t capacity, int shardBits)
+    : _shardBits(checkShardBits(shardBits)),
+      _shardNum(static_cast<size_t>(1) << _shardBits),
+      _shards(new LRUCache[_shardNum])
+{
+  changeCpacity(capacity);
+}
+
+Cache::~Cache() {}
+
+uint32_t Cache::hashSlice(const Slice& key)
+{ return hash(key.data(), key.size(), HASHSEED); }
+
+void* Cache::lookup(const Slice& key)
+{
+  const uint32_t h = hashSlice(key);
+  return shard(h).lookup(key, h);
+}
+
+void* Cache::insert(const Slice& key, void* value, size_t charge,
+                    void (*deleter)(const Slice& key, void* value))
+{
+  const uint32_t h = hashSlice(key);
+  return shard(h).insert(key, h, value, charge, deleter);
+}
+
+void Cache::unRef(const Slice& key)
+{
+  const uint32_t h = hashSlice(key);
+  shard(h).unRef(key, h);
+}
+
+void Cache::erase(const Slice& key)
+{
+  const uint32_t h = hashSlice(key);
+  shard(h).erase(key, h);
+}
+
+void Cache::prune()
+{
+  for (size_t i = 0; _shardNum > i; i++) {
+    _shards[i].prune();
+  }
+}
+
+void Cache::changeCpacity(size_t capacity)
+{
+  const size_t perShard = (capacity + _shardNum - 1) / _shardNum;
+  for (size_t i = 0; _shardNum > i; i++) {
+    _shards[i].setCapacity(perShard);
+  }
+}
+
+size_t Cache::getUsage() const
+{
+  size_t usage = 0;
+  for (size_t i = 0; _shardNum > i; i++) {
+    usage += _shards[i].getUsage();
+  }
+  return usage;
+}
+
+}
@@ -6,6 +6,8 @@
 #include "yundb/slice.h"
 #include "sync.h"
 
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -57,29 +59,31 @@ class LRUTable
   std::vector<LRUHandle*> _buckets;
 };
 
-class Cache
+// One shard of Cache, every operation holds the shard mutex
+class LRUCache
 {
  public:
-  Cache(const size_t capacity);
+  LRUCache();
 
-  ~Cache();
+  ~LRUCache();
 
-  // Find the value of key. If found, it will increase the reference count and
-  // return the value. If not found, it will return nullptr.
-  void* lookup(const Slice& key);
+  LRUCache(const LRUCache& other) = delete;
 
-  // Insert key-value pair into cache, charge is the memory usage of this key-value pair
-  // deleter is the function to delete this key-value pair when evicted from cache
-  void insert(const Slice& key, void* value, size_t charge,
-              void (*deleter)(const Slice& key, void* value));
+  LRUCache& operator=(const LRUCache& other) = delete;
 
-  // Decrease the reference count of key.
-  void unRef(const Slice& key);
+  void setCapacity(size_t capacity);
 
-  // Remove all cache entries that in lru list
-  void prune(); 
+  // Hash is the hash value of key, see Cache for the meaning of other methods
+  void* lookup(const Slice& key, uint32_t hash);
 
-  void changeCpacity(size_t capacity);
+  void* insert(const Slice& key, uint32_t hash, void* value, size_t charge,
+               void (*deleter)(const Slice& key, void* value));
+
+  void unRef(const Slice& key, uint32_t hash);
+
+  void erase(const Slice& key, uint32_t hash);
+
+  void prune(); 
 
   size_t getUsage() const;
 
@@ -96,7 +100,7 @@ class Cache
 
   void unRef(LRUHandle** handle);
 
-  mutable sync::Mutex _mutex;;
+  mutable sync::Mutex _mutex;
 
   // Current memory usage of the cache
   size_t _usage;
@@ -114,6 +118,62 @@ class Cache
   LRUHandle _inUse;
 };
 
+// Default Cache has 1 << 4 shards
+constexpr int DefaultCacheShardBits = 4;
+// Larger shard bits are clamped to this
+constexpr int MaxCacheShardBits = 16;
+
+// Cache is split into 1 << shardBits LRUCache shards by the top bits of
+// the key hash. Each shard has its own mutex, LRU list and in use list,
+// so lookups of different keys seldom wait for each other.
+class Cache
+{
+ public:
+  Cache(const size_t capacity, int shardBits = DefaultCacheShardBits);
+
+  ~Cache();
+
+  Cache(const Cache& other) = delete;
+
+  Cache& operator=(const Cache& other) = delete;
+
+  // Find the value of key. If found, it will increase the reference count and
+  // return the value. If not found, it will return nullptr.
+  void* lookup(const Slice& key);
+
+  // Insert key-value pair into cache, charge is the memory usage of this key-value pair
+  // deleter is the function to delete this key-value pair when evicted from cache.
+  // If key is already in cache the cached value is kept and value is deleted.
+  // Return the cached value with its reference count increased, like lookup,
+  // the caller must unRef the key when done with it.
+  void* insert(const Slice& key, void* value, size_t charge,
+               void (*deleter)(const Slice& key, void* value));
+
+  // Decrease the reference count of key.
+  void unRef(const Slice& key);
+
+  // Drop key from cache if nobody holds a reference to it. An entry that is
+  // still in use stays until it is released and aged out of the LRU list.
+  void erase(const Slice& key);
+
+  // Remove all cache entries that in lru list
+  void prune(); 
+
+  void changeCpacity(size_t capacity);
+
+  size_t getUsage() const;
+
+ private:
+  static uint32_t hashSlice(const Slice& key);
+
+  LRUCache& shard(uint32_t hash)
+  { return _shards[_shardBits == 0 ? 0 : hash >> (32 - _shardBits)]; }
+
+  const int _shardBits;
+  const size_t _shardNum;
+  std::unique_ptr<LRUCache[]> _shards;
+};
+
 }
 
 #endif // YUNDB_UTIL_CACHE_H
\ No newline at end of file
@@ -10,9 +10,16 @@
 #include <queue>
 #include <thread>
 #include <atomic>
+#include <algorithm>
 #include <limits>
 #include <memory>
 
+#if defined(YUNDB_HAVE_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
 #include "util/error_print.h"
 #include "util/sync.h"
 #include "yundb/en.h"
@@ -39,6 +46,21 @@ constexpr int OpenBaseFlags = 0;
 
 constexpr size_t PosixWritableBufferSize =  65536;
 
+// O_DIRECT transfers start, end and sit in memory at multiples of this,
+// it covers the logical block size of common devices
+constexpr size_t DirectIoAlignment = 4096;
+constexpr size_t PosixDirectBufferSize = 1024 * 1024;
+
+size_t alignUp(size_t n) { return (n + DirectIoAlignment - 1) / DirectIoAlignment * DirectIoAlignment; }
+
+// Memory for O_DIRECT transfers, null on failure. Free with ::free()
+char* allocateAligned(size_t size)
+{
+  void* buf = nullptr;
+  if (::posix_memalign(&buf, DirectIoAlignment, size) != 0) return nullptr;
+  return static_cast<char*>(buf);
+}
+
 // Limit the number of open file descriptors and the mmap file usage
 // so that we do not run out of file descriptors or virtual memory
 class ResourceLimiter
@@ -78,6 +100,187 @@ class ResourceLimiter
   std::atomic<int> _resource;
 };
 
+#if defined(YUNDB_HAVE_IO_URING) && defined(__NR_io_uring_setup)
+// Submission and completion rings of one io_uring instance, set up with
+// the raw system calls. Not thread-safe, every thread uses its own.
+class IoUring
+{
+ public:
+  static constexpr unsigned Depth = 64;
+
+  IoUring()
+      : _broken(false), _ringFd(-1), _sqRing(MAP_FAILED), _cqRing(MAP_FAILED),
+        _sqes(MAP_FAILED), _sqRingSize(0), _cqRingSize(0), _sqesSize(0)
+  {
+    struct io_uring_params params;
+    ::memset(&params, 0, sizeof(params));
+    _ringFd = static_cast<int>(::syscall(__NR_io_uring_setup, Depth, &params));
+    if (_ringFd < 0) return;
+
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    bool singleMmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+#endif
+
+    _sqRing = ::mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    if (_sqRing == MAP_FAILED) return;
+    _cqRing = singleMmap ? _sqRing
+                         : ::mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_CQ_RING);
+    if (_cqRing == MAP_FAILED) return;
+    _sqes = ::mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES);
+    if (_sqes == MAP_FAILED) return;
+
+    char* sq = static_cast<char*>(_sqRing);
+    _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(_cqRing);
+    _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~IoUring()
+  {
+    if (_sqes != MAP_FAILED) ::munmap(_sqes, _sqesSize);
+    if (_cqRing != MAP_FAILED && _cqRing != _sqRing) ::munmap(_cqRing, _cqRingSize);
+    if (_sqRing != MAP_FAILED) ::munmap(_sqRing, _sqRingSize);
+    if (_ringFd >= 0) ::close(_ringFd);
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  bool ok() const { return _sqes != MAP_FAILED && !_broken; }
+
+  // Read every request from fd with up to Depth reads in flight. Requests
+  // the ring could not complete are left with ok set to false
+  void readAll(int fd, ReadRequest* requests, int n)
+  {
+    std::vector<struct iovec> iovecs(n);
+    for (int i = 0; n > i; i++) requests[i].ok = false;
+
+    int prepared = 0;
+    // Entries in the submission ring the kernel has not consumed yet
+    int unconsumed = 0;
+    int inFlight = 0;
+    while (!_broken && (n > prepared || inFlight > 0))
+    {
+      unsigned tail = *_sqTail;
+      for (; n > prepared && Depth > static_cast<unsigned>(inFlight); prepared++, inFlight++)
+      {
+        ReadRequest& request = requests[prepared];
+        iovecs[prepared].iov_base = request.scratch;
+        iovecs[prepared].iov_len = request.bytes;
+
+        const unsigned index = tail & _sqMask;
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_sqes) + index;
+        ::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->off = request.offset;
+        sqe->addr = reinterpret_cast<uint64_t>(&iovecs[prepared]);
+        sqe->len = 1;
+        sqe->user_data = static_cast<uint64_t>(prepared);
+        _sqArray[index] = index;
+        tail++;
+        unconsumed++;
+      }
+      // Publish the entries before the kernel reads the tail
+      __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+
+      int consumed = static_cast<int>(::syscall(__NR_io_uring_enter, _ringFd, unconsumed, 1,
+                                                IORING_ENTER_GETEVENTS, nullptr, 0));
+      if (consumed >= 0) {
+        unconsumed -= consumed;
+      } else if (errno != EINTR) {
+        // The kernel may still write into the buffers of the reads it
+        // took, wait for them and never use this ring again
+        printError("IoUring: io_uring_enter fail");
+        _broken = true;
+        inFlight -= unconsumed;
+        while (inFlight > 0 &&
+               (::syscall(__NR_io_uring_enter, _ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+                          nullptr, 0) >= 0 || errno == EINTR)) {
+          inFlight -= reap(requests);
+        }
+        return;
+      }
+      inFlight -= reap(requests);
+    }
+  }
+
+ private:
+  // Pass the results in the completion ring to requests, return the
+  // number of completed reads
+  int reap(ReadRequest* requests)
+  {
+    int completed = 0;
+    unsigned head = *_cqHead;
+    const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++, completed++)
+    {
+      const struct io_uring_cqe& cqe = _cqes[head & _cqMask];
+      ReadRequest& request = requests[cqe.user_data];
+      if (cqe.res >= 0) {
+        request.result = Slice(request.scratch, static_cast<size_t>(cqe.res));
+        request.ok = true;
+      }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+    return completed;
+  }
+
+  bool _broken;
+  int _ringFd;
+  void* _sqRing;
+  void* _cqRing;
+  void* _sqes;
+  size_t _sqRingSize;
+  size_t _cqRingSize;
+  size_t _sqesSize;
+  unsigned* _sqTail;
+  unsigned _sqMask;
+  unsigned* _sqArray;
+  unsigned* _cqHead;
+  unsigned* _cqTail;
+  unsigned _cqMask;
+  struct io_uring_cqe* _cqes;
+};
+
+// Ring of the calling thread, null if the kernel refused to set one up
+// or it broke
+IoUring* threadIoUring()
+{
+  static thread_local std::unique_ptr<IoUring> ring;
+  static thread_local bool tried = false;
+  if (!tried)
+  {
+    tried = true;
+    ring.reset(new IoUring());
+    if (!ring->ok()) ring.reset();
+  }
+  // A broken ring is kept alive, so the kernel never writes into freed memory
+  return ring != nullptr && ring->ok() ? ring.get() : nullptr;
+}
+
+bool ioUringSupported()
+{
+  IoUring ring;
+  return ring.ok();
+}
+#else
+bool ioUringSupported() { return false; }
+#endif
+
 class SequentialPosixFile final : public SequentialFile
 {
  public:
@@ -130,7 +333,7 @@ class SequentialPosixFile final : public SequentialFile
         return false;
       }
       _offset += static_cast<off_t>(readSize);
-      *str = Slice(scratch, static_cast<size_t>(bytes));
+      *str = Slice(scratch, static_cast<size_t>(readSize));
       break;
     }
 
@@ -145,7 +348,7 @@ class SequentialPosixFile final : public SequentialFile
  private:
   std::shared_ptr<ResourceLimiter> _limiter;
   bool _permanentFd;
-  off_t _offset;
+  off_t _offset = 0;
   const int _fd;
   const std::string _filename;
 };
@@ -159,9 +362,10 @@ class RandomAccessPosixFile final : public RandomAccessFile
 {
  public:
   RandomAccessPosixFile(std::string fileName, int fd,
-                        std::shared_ptr<ResourceLimiter> limiter)
+                        std::shared_ptr<ResourceLimiter> limiter, bool useIoUring = false)
     :   _limiter(std::move(limiter)),
         _permanentFd(fd > 0),
+        _useIoUring(useIoUring),
         _fileName(std::move(fileName)),
         _fd(_permanentFd ? fd : -1) {}
 
@@ -202,6 +406,39 @@ class RandomAccessPosixFile final : public RandomAccessFile
 
     return result;
   }
+
+  void prefetch(uint64_t offset, uint64_t bytes) const override
+  {
+#if defined(POSIX_FADV_WILLNEED)
+    if (_permanentFd) {
+      ::posix_fadvise(_fd, static_cast<off_t>(offset), static_cast<off_t>(bytes),
+                      POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)offset;
+    (void)bytes;
+#endif
+  }
+
+  void multiRead(ReadRequest* requests, int n) const override
+  {
+#if defined(YUNDB_HAVE_IO_URING) && defined(__NR_io_uring_setup)
+    IoUring* ring = (_useIoUring && _permanentFd) ? threadIoUring() : nullptr;
+    if (ring != nullptr)
+    {
+      ring->readAll(_fd, requests, n);
+      // Retry the reads the ring failed with pread
+      for (int i = 0; n > i; i++) {
+        if (!requests[i].ok) {
+          requests[i].ok = read(requests[i].offset, &requests[i].result,
+                                requests[i].scratch, requests[i].bytes);
+        }
+      }
+      return;
+    }
+#endif
+    RandomAccessFile::multiRead(requests, n);
+  }
  private:
   bool doRead(int fd, off_t offset, Slice* str,
               char* scratch, uint64_t bytes) const
@@ -218,7 +455,7 @@ class RandomAccessPosixFile final : public RandomAccessFile
         }
         return false;
       }
-      *str = Slice(scratch, static_cast<size_t>(bytes));
+      *str = Slice(scratch, static_cast<size_t>(readSize));
       break;
     }
 
@@ -229,6 +466,8 @@ class RandomAccessPosixFile final : public RandomAccessFile
   // otherwise the file descriptor open on every read
   std::shared_ptr<ResourceLimiter> _limiter;
   bool _permanentFd;
+  // multiRead goes through the io_uring of the calling thread
+  const bool _useIoUring;
   const std::string _fileName;
   int _fd;
 };
@@ -275,34 +514,48 @@ class WritablePosixFile final : public WritableFile
   }
 
   // flush buf data to os
-  void flush() override {writeUnbuffer(_buf, _pos);}
+  void flush() override
+  {
+    writeUnbuffer(_buf, _pos);
+    _pos = 0;
+  }
 
   // close file
   void close() override
   {
+    if (_closed) return;
     flush();
-    if (!_closed)
+    if (_permanentFd)
     {
-      if (_permanentFd)
-      {
-        if (::close(_fd) == 0) {
-          _fd = -1;
-          _limiter->release();
-        } else {
-          printError("close file: ", _filename, " fail");
-          return;
-        }
+      if (::close(_fd) == 0) {
+        _fd = -1;
+        _limiter->release();
+      } else {
+        printError("close file: ", _filename, " fail");
+        return;
       }
-      _closed = true;
     }
+    _closed = true;
+  }
+
+  void preallocate(uint64_t bytes) override
+  {
+#if defined(YUNDB_HAVE_FALLOCATE)
+    // Only a hint, file systems without fallocate just grow the file
+    if (_permanentFd) {
+      ::fallocate(_fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(bytes));
+    }
+#else
+    (void)bytes;
+#endif
   }
 
   // Flush data to os and sysnc these data
   void sync() override
   {
-    writeUnbuffer(_buf, _pos);
+    flush();
     if (!_permanentFd) return;
-#if HAVE_PDATASYNC
+#if defined(YUNDB_HAVE_FDATASYNC)
     bool success = ::fdatasync(_fd) == 0;
 #else
     bool success = ::fsync(_fd) == 0;
@@ -364,6 +617,213 @@ class WritablePosixFile final : public WritableFile
   const std::string _filename;
   char _buf[PosixWritableBufferSize];
 };
+
+// Writes with O_DIRECT, so written tables do not push other files out
+// of the page cache. Data is staged in an aligned buffer and written in
+// whole aligned blocks. flush() writes the partial block at the tail
+// padded with zeros but keeps it in the buffer, so it is written again
+// once it fills up. sync() and close() truncate the padding away.
+class DirectWritablePosixFile final : public WritableFile
+{
+ public:
+  // Takes the ownership of fd and buf, buf holds PosixDirectBufferSize
+  // bytes aligned to DirectIoAlignment
+  DirectWritablePosixFile(std::string fileName, int fd, char* buf,
+                          std::shared_ptr<ResourceLimiter> limiter)
+      : _limiter(std::move(limiter)),
+        _closed(false),
+        _padded(false),
+        _fd(fd),
+        _buf(buf),
+        _pos(0),
+        _fileOffset(0),
+        _fileName(std::move(fileName)) {}
+
+  ~DirectWritablePosixFile() override
+  {
+    close();
+    ::free(_buf);
+  }
+
+  void append(const Slice& data) override
+  {
+    if (_closed)
+    {
+      printError("DirectWritablePosixFile: append file: ",
+                 _fileName, " fail, file already closed");
+      return;
+    }
+
+    const char* src = data.data();
+    size_t left = data.size();
+    while (left > 0)
+    {
+      size_t copySize = std::min(left, PosixDirectBufferSize - _pos);
+      ::memcpy(_buf + _pos, src, copySize);
+      _pos += copySize;
+      src += copySize;
+      left -= copySize;
+
+      if (_pos == PosixDirectBufferSize)
+      {
+        writeAligned(PosixDirectBufferSize);
+        _fileOffset += PosixDirectBufferSize;
+        _pos = 0;
+      }
+    }
+  }
+
+  void flush() override
+  {
+    if (_closed || _pos == 0) return;
+
+    const size_t paddedSize = alignUp(_pos);
+    ::memset(_buf + _pos, 0, paddedSize - _pos);
+    writeAligned(paddedSize);
+    _padded = paddedSize != _pos;
+
+    // Whole blocks are done, the partial one is rewritten later
+    const size_t done = _pos / DirectIoAlignment * DirectIoAlignment;
+    if (done > 0)
+    {
+      ::memmove(_buf, _buf + done, _pos - done);
+      _fileOffset += done;
+      _pos -= done;
+    }
+  }
+
+  void close() override
+  {
+    if (_closed) return;
+    flush();
+    truncate();
+    if (::close(_fd) != 0) {
+      printError("DirectWritablePosixFile: close file: ", _fileName, " fail");
+    }
+    if (_limiter != nullptr) _limiter->release();
+    _fd = -1;
+    _closed = true;
+  }
+
+  void sync() override
+  {
+    if (_closed) return;
+    flush();
+    truncate();
+#if defined(YUNDB_HAVE_FDATASYNC)
+    bool success = ::fdatasync(_fd) == 0;
+#else
+    bool success = ::fsync(_fd) == 0;
+#endif
+    if (!success) {
+      printError("DirectWritablePosixFile: sync file: ", _fileName, " fail");
+    }
+  }
+
+ private:
+  // Write the first size bytes of the buffer at _fileOffset
+  void writeAligned(size_t size)
+  {
+    const char* data = _buf;
+    off_t offset = static_cast<off_t>(_fileOffset);
+    while (size > 0)
+    {
+      ssize_t written = ::pwrite(_fd, data, size, offset);
+      if (written < 0)
+      {
+        if (errno == EINTR) continue;
+        printError("DirectWritablePosixFile: write file: ", _fileName, " fail");
+        return;
+      }
+      size -= written;
+      data += written;
+      offset += written;
+    }
+  }
+
+  // Cut the padding written by flush() off the end of the file
+  void truncate()
+  {
+    if (!_padded) return;
+    if (::ftruncate(_fd, static_cast<off_t>(_fileOffset + _pos)) != 0) {
+      printError("DirectWritablePosixFile: truncate file: ", _fileName, " fail");
+      return;
+    }
+    _padded = false;
+  }
+
+  std::shared_ptr<ResourceLimiter> _limiter;
+  bool _closed;
+  // The file is longer than the data because of padding
+  bool _padded;
+  int _fd;
+  char* const _buf;
+  // Bytes of the buffer that hold data, the buffer starts at _fileOffset
+  size_t _pos;
+  uint64_t _fileOffset;
+  const std::string _fileName;
+};
+
+// Implements random read access with O_DIRECT, reads bypass the page
+// cache. Every read is widened to aligned bounds in an aligned buffer
+// and the requested bytes are copied into scratch.
+//
+// Instances of this class are thread-safe, as required by the RandomAccessFile
+// API.
+class DirectRandomAccessPosixFile final : public RandomAccessFile
+{
+ public:
+  DirectRandomAccessPosixFile(std::string fileName, int fd,
+                              std::shared_ptr<ResourceLimiter> limiter)
+      : _limiter(std::move(limiter)),
+        _fileName(std::move(fileName)),
+        _fd(fd) {}
+
+  ~DirectRandomAccessPosixFile() override
+  {
+    if (::close(_fd) < 0) {
+      printError("DirectRandomAccessPosixFile: close file: ", _fileName, " fail");
+    }
+    if (_limiter != nullptr) _limiter->release();
+  }
+
+  bool read(uint64_t offset, Slice* str,
+            char* scratch, uint64_t bytes) const override
+  {
+    const uint64_t alignedStart = offset / DirectIoAlignment * DirectIoAlignment;
+    const size_t alignedSize = alignUp(static_cast<size_t>(offset + bytes - alignedStart));
+    std::unique_ptr<char, void (*)(void*)> buf(allocateAligned(alignedSize), ::free);
+    if (buf == nullptr)
+    {
+      printError("DirectRandomAccessPosixFile: allocate buffer fail");
+      return false;
+    }
+
+    ssize_t readSize;
+    while (true)
+    {
+      readSize = ::pread(_fd, buf.get(), alignedSize, static_cast<off_t>(alignedStart));
+      if (readSize >= 0) break;
+      if (errno == EINTR) continue;
+      printError("DirectRandomAccessPosixFile: read file: ", _fileName, " fail");
+      return false;
+    }
+
+    // Short at the end of the file
+    const uint64_t skip = offset - alignedStart;
+    const uint64_t available = static_cast<uint64_t>(readSize) > skip ? readSize - skip : 0;
+    const size_t n = static_cast<size_t>(std::min(bytes, available));
+    ::memcpy(scratch, buf.get() + skip, n);
+    *str = Slice(scratch, n);
+    return true;
+  }
+
+ private:
+  std::shared_ptr<ResourceLimiter> _limiter;
+  const std::string _fileName;
+  const int _fd;
+};
+
 // Limite virtual memory usage by mmap()
 
 // Implements random read access in a file using mmap().
@@ -409,6 +869,18 @@ class MmapReadablePosixFile final : public RandomAccessFile
     return true;
   }
 
+  bool isMemoryMapped() const override { return true; }
+
+  void prefetch(uint64_t offset, uint64_t bytes) const override
+  {
+    if (offset >= _length) return;
+    bytes = std::min<uint64_t>(bytes, _length - offset);
+    // madvise wants a page aligned start
+    const uint64_t pageSize = static_cast<uint64_t>(::getpagesize());
+    const uint64_t start = offset / pageSize * pageSize;
+    ::madvise(_mmapBase + start, bytes + offset - start, MADV_WILLNEED);
+  }
+
  private:
   char* const _mmapBase;
   const size_t _length;
@@ -462,6 +934,101 @@ class LockFileTable
   std::set<std::string> _lockedFiles;
 };
 
+// A pool of detached threads that share one FIFO queue, so whichever
+// worker is idle picks up the next work. Threads are started lazily by
+// schedule(), extra threads exit when the pool is shrunk.
+class PosixThreadPool
+{
+ public:
+  PosixThreadPool()
+      : _workCondVar(&_mu),
+        _targetThreads(1),
+        _liveThreads(0) {}
+
+  PosixThreadPool(const PosixThreadPool&) = delete;
+  PosixThreadPool& operator=(const PosixThreadPool&) = delete;
+
+  void schedule(void (*function)(void* arg), void* arg)
+  {
+    sync::LockGuard<sync::Mutex> guard(_mu);
+    _workQueue.emplace(function, arg);
+    startThreads();
+    _workCondVar.signal();
+  }
+
+  void setThreads(int number)
+  {
+    sync::LockGuard<sync::Mutex> guard(_mu);
+    _targetThreads = std::max(number, 1);
+    if (!_workQueue.empty()) startThreads();
+    // Let extra threads exit
+    _workCondVar.signalAll();
+  }
+
+  int getThreads()
+  {
+    sync::LockGuard<sync::Mutex> guard(_mu);
+    return _targetThreads;
+  }
+
+  int getQueueLen()
+  {
+    sync::LockGuard<sync::Mutex> guard(_mu);
+    return static_cast<int>(_workQueue.size());
+  }
+
+ private:
+  struct BackgroundWork
+  {
+    BackgroundWork(void (*function)(void* arg), void* arg)
+        : function(function), arg(arg) {}
+    void (*function)(void* arg);
+    void* arg;
+  };
+
+  // REQUIRES: _mu is held
+  void startThreads()
+  {
+    while (_liveThreads < _targetThreads)
+    {
+      _liveThreads++;
+      std::thread worker(&PosixThreadPool::threadEntry, this);
+      worker.detach();
+    }
+  }
+
+  void threadEntry()
+  {
+    _mu.Lock();
+    while (true)
+    {
+      while (_workQueue.empty() && _liveThreads <= _targetThreads)
+      {
+        _workCondVar.wait();
+      }
+
+      if (_liveThreads > _targetThreads) {
+        // The pool was shrunk
+        _liveThreads--;
+        break;
+      }
+
+      BackgroundWork work = _workQueue.front();
+      _workQueue.pop();
+      _mu.unlock();
+      work.function(work.arg);
+      _mu.Lock();
+    }
+    _mu.unlock();
+  }
+
+  sync::Mutex _mu;
+  sync::CondVar _workCondVar;                   // Protected by _mu.
+  int _targetThreads;                           // Protected by _mu.
+  int _liveThreads;                             // Protected by _mu.
+  std::queue<BackgroundWork> _workQueue;        // Protected by _mu.
+};
+
 int getMaxMmapUsage();
 int getMaxOpenFile();
 int LockOrUnlock(int fd, bool lock);
@@ -473,10 +1040,9 @@ class PosixEnv : public Env
 {
  public:
   PosixEnv()
-      : _backGroundWorkCondVar(&_backGroundWorkMutex),
-        _startedBackgroundWork(false),
-        _fdNumberLimiter(std::make_shared<ResourceLimiter>(getMaxOpenFile())),
-        _mmapLimiter(std::make_shared<ResourceLimiter>(getMaxMmapUsage())) {}
+      : _fdNumberLimiter(std::make_shared<ResourceLimiter>(getMaxOpenFile())),
+        _mmapLimiter(std::make_shared<ResourceLimiter>(getMaxMmapUsage())),
+        _useIoUring(false) {}
   ~PosixEnv() override
   {
     printError("PosixEnv: PosixEnv destructor");
@@ -486,7 +1052,7 @@ class PosixEnv : public Env
   void newWritableFile(const std::string& fileName, WritableFile** result) override
   {
     int fd = ::open(fileName.c_str(),
-                    O_WRONLY | O_CREAT | OpenBaseFlags, 0644);
+                    O_TRUNC | O_WRONLY | O_CREAT | OpenBaseFlags, 0644);
     if (fd < 0)
     {
       printError("PosixEnv: open file: ", fileName, " fail");
@@ -555,7 +1121,8 @@ class PosixEnv : public Env
       return;
     }
 
-    if (_mmapLimiter->acquire())
+    const bool useIoUring = _useIoUring.load(std::memory_order_relaxed);
+    if (!useIoUring && _mmapLimiter->acquire())
     {
       uint64_t fileSize;
       if (getFileSize(fileName, &fileSize)) {
@@ -571,7 +1138,7 @@ class PosixEnv : public Env
     }
 
     if(_fdNumberLimiter->acquire()) {
-      *result = new RandomAccessPosixFile(fileName, fd, _fdNumberLimiter);
+      *result = new RandomAccessPosixFile(fileName, fd, _fdNumberLimiter, useIoUring);
     } else {
       *result = new RandomAccessPosixFile(fileName, -1, _fdNumberLimiter);
       if (::close(fd) < 0) {
@@ -580,6 +1147,65 @@ class PosixEnv : public Env
     }
   }
 
+  void reuseWritableFile(const std::string& oldFileName,
+                         const std::string& fileName, WritableFile** result) override
+  {
+    if (!renameFile(oldFileName, fileName)) {
+      *result = nullptr;
+      return;
+    }
+
+    int fd = ::open(fileName.c_str(), O_WRONLY | OpenBaseFlags);
+    if (fd >= 0 && _fdNumberLimiter->acquire()) {
+      *result = new WritablePosixFile(fileName, fd, _fdNumberLimiter);
+      return;
+    }
+    // Without a permanent fd every write appends, start from an empty file
+    if (fd >= 0) ::close(fd);
+    newWritableFile(fileName, result);
+  }
+
+  void newDirectWritableFile(const std::string& fileName, WritableFile** result) override
+  {
+#if defined(O_DIRECT)
+    int fd = ::open(fileName.c_str(),
+                    O_TRUNC | O_WRONLY | O_CREAT | O_DIRECT | OpenBaseFlags, 0644);
+    char* buf = fd >= 0 ? allocateAligned(PosixDirectBufferSize) : nullptr;
+    if (buf != nullptr && _fdNumberLimiter->acquire()) {
+      *result = new DirectWritablePosixFile(fileName, fd, buf, _fdNumberLimiter);
+      return;
+    }
+    ::free(buf);
+    if (fd >= 0) ::close(fd);
+#endif
+    // The file system does not take O_DIRECT
+    newWritableFile(fileName, result);
+  }
+
+  void newDirectRandomAccessFile(const std::string& fileName,
+                                 RandomAccessFile** result) override
+  {
+#if defined(O_DIRECT)
+    int fd = ::open(fileName.c_str(), O_RDONLY | O_DIRECT | OpenBaseFlags);
+    if (fd >= 0 && _fdNumberLimiter->acquire()) {
+      *result = new DirectRandomAccessPosixFile(fileName, fd, _fdNumberLimiter);
+      return;
+    }
+    if (fd >= 0) ::close(fd);
+#endif
+    newRandomAccessFile(fileName, result);
+  }
+
+  bool setUseIoUring(bool use) override
+  {
+    if (use && !ioUringSupported()) {
+      _useIoUring.store(false, std::memory_order_relaxed);
+      return false;
+    }
+    _useIoUring.store(use, std::memory_order_relaxed);
+    return true;
+  }
+
   bool fileExists(const std::string& fileName) override {
     return ::access(fileName.c_str(), F_OK) == 0;
   }
@@ -709,18 +1335,17 @@ class PosixEnv : public Env
     return true;
   }
 
-  void schedule(void (*function)(void* arg), void* arg) override
-  {
-    _backGroundWorkMutex.Lock();
-    if (!_startedBackgroundWork)
-    {
-      _startedBackgroundWork = true;
-      std::thread backThread(&PosixEnv::threadEntry, this);
-    }
-    _backgroundWorkQueue.emplace(function, arg);
-    _backGroundWorkCondVar.signal();
-    _backGroundWorkMutex.unlock();
-  }
+  void schedule(void (*function)(void* arg), void* arg, Priority pri) override
+  { _threadPools[pri].schedule(function, arg); }
+
+  void setBackgroundThreads(int number, Priority pri) override
+  { _threadPools[pri].setThreads(number); }
+
+  int getBackgroundThreads(Priority pri) override
+  { return _threadPools[pri].getThreads(); }
+
+  int getThreadPoolQueueLen(Priority pri) override
+  { return _threadPools[pri].getQueueLen(); }
 
   void startThread(void (*function)(void* arg), void* arg) override
   {
@@ -730,38 +1355,11 @@ class PosixEnv : public Env
 
   static Env* Default();
  private:
-  class BackgroundWork
-  {
-   public:
-    BackgroundWork(void (*function)(void* arg), void* arg)
-        : function(function), arg(arg) {}
-    void (*function)(void* arg);
-    void* arg;
-  };
-
-  void threadEntry()
-  {
-    while (true)
-    {
-      _backGroundWorkMutex.Lock();
-
-      while (_backgroundWorkQueue.empty())
-      _backGroundWorkCondVar.wait();
-
-      BackgroundWork work = _backgroundWorkQueue.front();
-      _backgroundWorkQueue.pop();
-      _backGroundWorkMutex.unlock();
-      work.function(work.arg);
-    }
-  }
-
-  sync::Mutex _backGroundWorkMutex;
-  sync::CondVar _backGroundWorkCondVar; // Protected by _backgroundWorkMutex.
-  bool _startedBackgroundWork; // protected by _backgroundWorkMutex.
-  std::queue<BackgroundWork> _backgroundWorkQueue; // Protected by _backgroundWorkMutex.
+  PosixThreadPool _threadPools[PriorityNum];        // Thread-safe.
   std::shared_ptr<ResourceLimiter> _fdNumberLimiter; // Thread-safe.
   std::shared_ptr<ResourceLimiter> _mmapLimiter;     // Thread-safe.
   LockFileTable _lockFileTable;                      // Thread-safe.
+  std::atomic<bool> _useIoUring;
 };
 
 
@@ -842,6 +1440,40 @@ Env::Env() = default;
 
 Env::~Env() = default;
 
+void Env::reuseWritableFile(const std::string& oldFileName,
+                            const std::string& fileName, WritableFile** result)
+{
+  if (!renameFile(oldFileName, fileName)) {
+    *result = nullptr;
+    return;
+  }
+  newWritableFile(fileName, result);
+}
+
+void Env::newDirectWritableFile(const std::string& fileName, WritableFile** result)
+{
+  newWritableFile(fileName, result);
+}
+
+void Env::newDirectRandomAccessFile(const std::string& fileName, RandomAccessFile** result)
+{
+  newRandomAccessFile(fileName, result);
+}
+
+bool Env::setUseIoUring(bool use)
+{
+  (void)use;
+  return false;
+}
+
+void RandomAccessFile::multiRead(ReadRequest* requests, int n) const
+{
+  for (int i = 0; n > i; i++) {
+    requests[i].ok = read(requests[i].offset, &requests[i].result,
+                          requests[i].scratch, requests[i].bytes);
+  }
+}
+
 static bool doWriteStringToFile(Env* env, const Slice& data, const std::string& fname, bool sync)
 {
   if (env ==nullptr) {
@@ -887,7 +1519,7 @@ bool readFileToString(Env* env, const std::string& fileName, std::string* data)
   char scratch[65536];
   Slice readResult;
   data->clear();
-  while (file->read(&readResult, scratch, sizeof(scratch))) {
+  while (file->read(&readResult, scratch, sizeof(scratch)) && !readResult.empty()) {
     data->append(readResult.data(), readResult.size());
   }
   delete file;
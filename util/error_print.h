@@ -21,7 +21,7 @@ inline bool initializeErrorPrint()
 
   OriginalCerrBuffer = std::cerr.rdbuf();
   ErrorFileStream.open(ErrorFilePath, std::ios::out | std::ios::app);
-  assert(ErrorFileStream.is_open() == false);
+  assert(ErrorFileStream.is_open());
   std::cerr.rdbuf(ErrorFileStream.rdbuf());
   return true;
 }
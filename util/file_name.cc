@@ -21,8 +21,10 @@ bool parseFileName(const std::string fileName, uint64_t* number,
     printError("ParseFileName: nullptr");
   }
 
+  // Name may be relative to db dir
   size_t pos = fileName.find_last_of("/");
-  Slice name(fileName.data(), fileName.size() - pos);  
+  size_t start = (pos == std::string::npos) ? 0 : pos + 1;
+  Slice name(fileName.data() + start, fileName.size() - start);
 
   if (name == "CURRENT") {
     *fileType = FileType::CurrentFile;
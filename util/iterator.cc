@@ -0,0 +1,73 @@
+#include "yundb/iterator.h"
+
+namespace yundb
+{
+
+Iterator::Iterator()
+{
+  cleanup_head_.function = nullptr;
+  cleanup_head_.next = nullptr;
+}
+
+Iterator::~Iterator()
+{
+  if (!cleanup_head_.isEmpty())
+  {
+    cleanup_head_.run();
+    for (CleanupNode* node = cleanup_head_.next; node != nullptr;)
+    {
+      node->run();
+      CleanupNode* next = node->next;
+      delete node;
+      node = next;
+    }
+  }
+}
+
+void Iterator::registerCleanup(CleanupFunction func, void* arg1, void* arg2)
+{
+  assert(func != nullptr);
+  CleanupNode* node;
+  if (cleanup_head_.isEmpty()) {
+    node = &cleanup_head_;
+  } else {
+    node = new CleanupNode();
+    node->next = cleanup_head_.next;
+    cleanup_head_.next = node;
+  }
+  node->function = func;
+  node->arg1 = arg1;
+  node->arg2 = arg2;
+}
+
+class EmptyIterator : public Iterator
+{
+ public:
+  explicit EmptyIterator(bool ok) : _ok(ok) {}
+  bool valid() const override { return false; }
+  void seekToFirst() override {}
+  void seekToLast() override {}
+  void seek(const Slice& target) override { (void)target; }
+  void next() override { assert(false); }
+  void prev() override { assert(false); }
+  Slice key() const override
+  {
+    assert(false);
+    return Slice();
+  }
+  Slice value() const override
+  {
+    assert(false);
+    return Slice();
+  }
+  bool status() const override { return _ok; }
+
+ private:
+  const bool _ok;
+};
+
+Iterator* newEmptyIterator() { return new EmptyIterator(true); }
+
+Iterator* newErrorIterator() { return new EmptyIterator(false); }
+
+}
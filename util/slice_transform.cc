@@ -0,0 +1,72 @@
+#include "yundb/slice_transform.h"
+
+#include <string>
+
+namespace yundb
+{
+
+class FixedPrefixTransform : public SliceTransform
+{
+ public:
+  explicit FixedPrefixTransform(size_t len)
+        : _len(len),
+          _name("yundb.FixedPrefix." + std::to_string(len)) {}
+
+  const char* name() const override { return _name.c_str(); }
+
+  Slice transform(const Slice& key) const override
+  { return Slice(key.data(), _len); }
+
+  bool inDomain(const Slice& key) const override
+  { return key.size() >= _len; }
+
+ private:
+  const size_t _len;
+  const std::string _name;
+};
+
+class DelimitedPrefixTransform : public SliceTransform
+{
+ public:
+  DelimitedPrefixTransform(char delim, int fields)
+        : _delim(delim),
+          _fields(fields),
+          _name("yundb.DelimitedPrefix." + std::to_string(static_cast<int>(delim)) +
+                "." + std::to_string(fields)) {}
+
+  const char* name() const override { return _name.c_str(); }
+
+  Slice transform(const Slice& key) const override
+  { return Slice(key.data(), prefixLength(key)); }
+
+  bool inDomain(const Slice& key) const override
+  { return prefixLength(key) != 0; }
+
+ private:
+  // Length of the prefix of key, 0 if key has too few delimiters
+  size_t prefixLength(const Slice& key) const
+  {
+    int seen = 0;
+    for (size_t i = 0; key.size() > i; i++)
+    {
+      if (key[i] == _delim && ++seen == _fields) return i + 1;
+    }
+    return 0;
+  }
+
+  const char _delim;
+  const int _fields;
+  const std::string _name;
+};
+
+SliceTransform* newFixedPrefixTransform(size_t len)
+{
+  return new FixedPrefixTransform(len);
+}
+
+SliceTransform* newDelimitedPrefixTransform(char delim, int fields)
+{
+  return new DelimitedPrefixTransform(delim, fields);
+}
+
+}
@@ -1,25 +1,68 @@
 #include "yundb/table.h"
 #include "yundb/en.h"
 #include "yundb/options.h"
-#include "db/table_format.h"
-#include "db/filter_block_reader.h"
+#include "db/sstable_reader.h"
+#include "util/error_print.h"
 
+#include <memory>
 
 namespace yundb
 {
 
 struct Table::Rep
 {
- public:
-   Rep(const Options& options, RandomAccessFile* file, uint64_t file_size)
-       : options(options), file(file), file_size(file_size), filter(nullptr, Slice()), metaindex_handle(), index_handle() {}
- private:
-  Options options;
-  RandomAccessFile* file;
-  uint64_t file_size;
-  FilterBlockReader filter;
-  BlockHandle metaindex_handle;  // Handle to metaindex block (offset,size)
-  BlockHandle index_handle;      // Handle to index block (offset,size)
+  explicit Rep(SstableReader* reader) : reader(reader) {}
+
+  // Parsed footer, filter block and index block, owns the file
+  std::unique_ptr<SstableReader> reader;
 };
 
-}
\ No newline at end of file
+bool Table::open(const Options& options, RandomAccessFile* file,
+                 uint64_t file_size, Table** table)
+{
+  if (table == nullptr) {
+    printError("Table: None table ptr");
+    delete file;
+    return false;
+  }
+
+  *table = nullptr;
+  if (file == nullptr) {
+    printError("Table: None file ptr");
+    return false;
+  }
+
+  SstableReader* reader = new SstableReader(options, file, file_size);
+  if (!reader->open()) {
+    printError("Table: open table error");
+    delete reader;
+    return false;
+  }
+
+  *table = new Table(new Rep(reader));
+  return true;
+}
+
+Table::~Table() { delete rep_; }
+
+Iterator* Table::newIterator(const ReadOptions& options) const
+{
+  // Data blocks are not cached by a standalone table
+  (void)options;
+  return rep_->reader->newIterator();
+}
+
+uint64_t Table::approximateOffsetOf(const Slice& key) const
+{
+  return rep_->reader->approximateOffsetOf(key);
+}
+
+bool Table::internalGet(const ReadOptions& options, const Slice& key, void* arg,
+                        void (*handle_result)(void* arg, const Slice& k,
+                                              const Slice& v))
+{
+  (void)options;
+  return rep_->reader->internalGet(key, arg, handle_result);
+}
+
+}